@@ -0,0 +1,678 @@
+// Headless benchmark of the PNG decoder and the modules' process(), built against the Rack stand-ins in bench/stub
+// by `make bench`.
+//
+// Usage: bench [samples] [scratch directory] [filter]
+// The PNG cases decode a generated corpus with the vendored lodepng and check the pixels. Each module case configures
+// a fresh module the way a patch would, runs a tenth of the samples to warm up, then times the rest. Prints
+// nanoseconds per sample and, where the kernel lets us open a hardware counter, cycles per sample.
+#include "plugin.hpp"
+#include "lodepng.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+void init(Plugin* p);
+
+// CPU cycles spent by this thread, from perf_event_open. Unavailable (containers, perf_event_paranoid, other
+// platforms) leaves it closed and read() returning 0.
+struct CycleCounter {
+	int fd = -1;
+
+	CycleCounter() {
+#ifdef __linux__
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CPU_CYCLES;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+	}
+
+	~CycleCounter() {
+#ifdef __linux__
+		if (fd >= 0)
+			close(fd);
+#endif
+	}
+
+	bool available() const {
+		return fd >= 0;
+	}
+
+	void start() {
+#ifdef __linux__
+		if (fd < 0)
+			return;
+		ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+	}
+
+	uint64_t stop() {
+		uint64_t cycles = 0;
+#ifdef __linux__
+		if (fd < 0)
+			return 0;
+		ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(fd, &cycles, sizeof(cycles)) != sizeof(cycles))
+			cycles = 0;
+#endif
+		return cycles;
+	}
+};
+
+struct Bench {
+	long samples = 2000000;
+	float sampleRate = 44100.f;
+	// Only cases whose name contains this run.
+	std::string filter;
+	CycleCounter counter;
+	// Sink for an output voltage per sample so the work can't be optimised away.
+	volatile float sink = 0.f;
+
+	bool selected(const std::string& name) const {
+		return name.find(filter) != std::string::npos;
+	}
+
+	// Times `samples` calls of process() after a warm-up, calling drive(module, sample) before each to move the inputs.
+	// Returns the nanoseconds per sample, or 0 when the filter skipped the case.
+	template <class Drive>
+	double run(const char* name, Module* module, Drive drive) {
+		if (!selected(name)) {
+			delete module;
+			return 0.;
+		}
+		Module::ProcessArgs args{sampleRate, 1.f / sampleRate};
+		const long warmup = samples / 10;
+		for (long i = 0; i < warmup; i++) {
+			drive(module, i);
+			module->process(args);
+		}
+
+		counter.start();
+		const auto begin = std::chrono::steady_clock::now();
+		for (long i = 0; i < samples; i++) {
+			drive(module, warmup + i);
+			module->process(args);
+			sink += module->outputs[0].getVoltage(0);
+		}
+		const auto end = std::chrono::steady_clock::now();
+		const uint64_t cycles = counter.stop();
+
+		const double ns = std::chrono::duration<double, std::nano>(end - begin).count() / samples;
+		if (counter.available())
+			std::printf("%-44s %9.1f ns/sample %9.1f cycles/sample\n", name, ns, (double)cycles / samples);
+		else
+			std::printf("%-44s %9.1f ns/sample\n", name, ns);
+		std::fflush(stdout);
+		delete module;
+		return ns;
+	}
+
+	double run(const char* name, Module* module) {
+		return run(name, module, [](Module*, long) {});
+	}
+
+	// Times `chunks` runs of `length` samples after a warm-up and returns the fastest one's nanoseconds per sample,
+	// which other load on the machine inflates far less than the mean.
+	double fastest(Module* module, long length, int chunks) {
+		Module::ProcessArgs args{sampleRate, 1.f / sampleRate};
+		for (long i = 0; i < length; i++) {
+			module->process(args);
+		}
+		double best = 0.;
+		for (int c = 0; c < chunks; c++) {
+			const auto begin = std::chrono::steady_clock::now();
+			for (long i = 0; i < length; i++) {
+				module->process(args);
+				sink += module->outputs[0].getVoltage(0);
+			}
+			const auto end = std::chrono::steady_clock::now();
+			const double ns = std::chrono::duration<double, std::nano>(end - begin).count() / length;
+			if (c == 0 || ns < best)
+				best = ns;
+		}
+		delete module;
+		return best;
+	}
+};
+
+// Every output patched, as the modules skip work for unpatched jacks.
+static Module* createPatched(Model* model) {
+	Module* module = model->createModule();
+	for (Output& output : module->outputs) {
+		output.channels = 1;
+	}
+	return module;
+}
+
+// Calls step repeatedly for about half a second and returns the seconds per call. step returns false on a wrong
+// result, which clears match.
+template <typename F>
+static double timeRepeated(F step, bool& match) {
+	long calls = 0;
+	double seconds = 0.;
+	const auto begin = std::chrono::steady_clock::now();
+	while (calls < 3 || seconds < 0.5) {
+		if (!step())
+			match = false;
+		calls++;
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	}
+	return seconds / calls;
+}
+
+// A 256x256 image with smooth gradients and some noise, so TEX's hue and saturation branches all get taken.
+static bool writeTexImage(const std::string& path) {
+	const unsigned size = 256;
+	std::vector<unsigned char> image(size * size * 3);
+	uint32_t seed = 1;
+	for (unsigned y = 0; y < size; y++) {
+		for (unsigned x = 0; x < size; x++) {
+			seed = seed * 1664525u + 1013904223u;
+			unsigned char* pixel = &image[(y * size + x) * 3];
+			pixel[0] = (unsigned char)(x + (seed >> 28));
+			pixel[1] = (unsigned char)(y + (seed >> 24 & 15));
+			pixel[2] = (unsigned char)((x * y) >> 8);
+		}
+	}
+	return lodepng::encode(path, image, size, size, LCT_RGB) == 0;
+}
+
+static void benchTex(Bench& bench, const std::string& imagePath) {
+	auto load = [&](Module* module, bool autoMode) {
+		json_t* rootJ = json_object();
+		json_object_set_new(rootJ, "lastImagePath", json_string(imagePath.c_str()));
+		json_object_set_new(rootJ, "autoMode", json_integer(autoMode));
+		module->dataFromJson(rootJ);
+		json_decref(rootJ);
+	};
+	auto create = [&](bool autoMode) {
+		Module* module = createPatched(modelTex);
+		load(module, autoMode);
+		return module;
+	};
+
+	// Loading the image again and again, as a patch does when it's reopened, with lodepng's buffers coming from the
+	// module's arena.
+	if (bench.selected("TEX load")) {
+		Module* module = create(true);
+		bool match = true;
+		const double seconds = timeRepeated([&]() {
+			load(module, true);
+			return true;
+		}, match);
+		std::printf("%-44s %9.2f ms/load\n", "TEX load", seconds * 1e3);
+		std::fflush(stdout);
+		delete module;
+	}
+
+	bench.run("TEX auto", create(true));
+
+	// Auto mode stepped by a square wave on the trigger input (input 2).
+	{
+		Module* module = create(true);
+		module->inputs[2].channels = 1;
+		bench.run("TEX auto, clocked", module, [](Module* m, long i) {
+			m->inputs[2].setVoltage((i & 64) ? 10.f : 0.f);
+		});
+	}
+
+	// Manual mode, every channel's x and y (inputs 0 and 1) sweeping the image at its own rate.
+	for (int channels : {1, 4, 16}) {
+		Module* module = create(false);
+		module->inputs[0].channels = channels;
+		module->inputs[1].channels = channels;
+		bench.run(string::f("TEX manual, %d channel%s", channels, (channels == 1) ? "" : "s").c_str(), module, [channels](Module* m, long i) {
+			for (int c = 0; c < channels; c++) {
+				m->inputs[0].setVoltage((float)((i * (c + 1)) & 1023) * (10.f / 1024.f), c);
+				m->inputs[1].setVoltage((float)((i * (c + 3) >> 6) & 1023) * (10.f / 1024.f), c);
+			}
+		});
+	}
+}
+
+// A fixed corpus for the PNG decoder, generated so every run decodes the same bytes: a photo-like image of smooth
+// shapes and grain, gradients with alpha, flat colour blocks (long matches) and noise (nearly all literals).
+struct PngImage {
+	const char* name;
+	unsigned width;
+	unsigned height;
+	LodePNGColorType colorType;
+	std::vector<unsigned char> pixels;
+	std::vector<unsigned char> png;
+};
+
+static std::vector<PngImage> makePngCorpus() {
+	std::vector<PngImage> corpus;
+	uint32_t seed = 7;
+	auto noise = [&seed]() {
+		seed = seed * 1664525u + 1013904223u;
+		return seed >> 24;
+	};
+
+	PngImage photo = {"photo 1024x1024 RGB", 1024, 1024, LCT_RGB, {}, {}};
+	PngImage gradient = {"gradient 1024x1024 RGBA", 1024, 1024, LCT_RGBA, {}, {}};
+	PngImage blocks = {"blocks 1024x1024 RGB", 1024, 1024, LCT_RGB, {}, {}};
+	PngImage grain = {"noise 512x512 RGB", 512, 512, LCT_RGB, {}, {}};
+	for (unsigned y = 0; y < 1024; y++) {
+		for (unsigned x = 0; x < 1024; x++) {
+			const float fx = x / 1024.f;
+			const float fy = y / 1024.f;
+			const float shade = 0.5f + 0.25f * std::sin(fx * 9.f + std::sin(fy * 7.f) * 2.f) + 0.2f * std::cos(fy * 13.f - fx * 5.f);
+			for (int c = 0; c < 3; c++) {
+				const float v = shade * (0.7f + 0.15f * c) * 255.f + (float)(noise() & 7);
+				photo.pixels.push_back((unsigned char)clamp(v, 0.f, 255.f));
+			}
+			gradient.pixels.push_back((unsigned char)(x >> 2));
+			gradient.pixels.push_back((unsigned char)(y >> 2));
+			gradient.pixels.push_back((unsigned char)((x + y) >> 3));
+			gradient.pixels.push_back((unsigned char)(255 - (y >> 2)));
+			const unsigned block = ((x >> 6) * 37 + (y >> 5) * 11) & 255;
+			blocks.pixels.push_back((unsigned char)block);
+			blocks.pixels.push_back((unsigned char)(block * 3));
+			blocks.pixels.push_back((unsigned char)(block * 7));
+		}
+	}
+	for (unsigned i = 0; i < 512 * 512 * 3; i++) {
+		grain.pixels.push_back((unsigned char)noise());
+	}
+	corpus.push_back(photo);
+	corpus.push_back(gradient);
+	corpus.push_back(blocks);
+	corpus.push_back(grain);
+
+	for (PngImage& image : corpus) {
+		lodepng::encode(image.png, image.pixels, image.width, image.height, image.colorType);
+	}
+	return corpus;
+}
+
+// The zlib stream of a PNG: its IDAT chunks' data joined together.
+static std::vector<unsigned char> pngIdat(const std::vector<unsigned char>& png) {
+	std::vector<unsigned char> idat;
+	const unsigned char* end = png.data() + png.size();
+	for (const unsigned char* chunk = png.data() + 8; chunk + 12 <= end; chunk = lodepng_chunk_next_const(chunk, end)) {
+		if (lodepng_chunk_type_equals(chunk, "IDAT")) {
+			const unsigned char* data = lodepng_chunk_data_const(chunk);
+			idat.insert(idat.end(), data, data + lodepng_chunk_length(chunk));
+		}
+		if (lodepng_chunk_type_equals(chunk, "IEND"))
+			break;
+	}
+	return idat;
+}
+
+static void printPng(const char* stage, const PngImage& image, double seconds, size_t bytes, size_t input, bool match) {
+	std::printf("PNG %-7s %-32s %9.2f ms/decode %8.1f MB/s (%zu KB)%s\n", stage, image.name, seconds * 1e3,
+		bytes / seconds / 1e6, input / 1024, match ? "" : " MISMATCH");
+	std::fflush(stdout);
+}
+
+// The top left 256x256 pixels of an image, which TEX reads.
+static std::vector<unsigned char> pngCorner(const PngImage& image) {
+	const size_t pixelBytes = image.pixels.size() / ((size_t)image.width * image.height);
+	std::vector<unsigned char> corner;
+	for (unsigned y = 0; y < std::min(256u, image.height); y++) {
+		auto row = image.pixels.begin() + (size_t)y * image.width * pixelBytes;
+		corner.insert(corner.end(), row, row + std::min(256u, image.width) * pixelBytes);
+	}
+	return corner;
+}
+
+// lodepng's parallel_for, running the band tasks on one thread per core, the calling thread included.
+static void parallelFor(void* context, unsigned count, void (*task)(void* taskData, unsigned index), void* taskData) {
+	std::atomic<unsigned> next(0);
+	auto work = [&]() {
+		for (unsigned index = next++; index < count; index = next++)
+			task(taskData, index);
+	};
+	const unsigned threads = std::min(count, std::max(std::thread::hardware_concurrency(), 1u));
+	std::vector<std::thread> workers;
+	for (unsigned i = 1; i < threads; i++)
+		workers.push_back(std::thread(work));
+	work();
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+// Decodes each corpus image repeatedly and checks the result against the source pixels: whole, (as TEX does) only
+// its top left 256x256 pixels, from memory, from a file in the scratch directory and as float planes, and row by
+// row from the streaming decoder. The banded case re-encodes the image in bands of 64 rows and decodes them on all
+// cores. The inflate cases time decompressing the image's zlib stream alone (checking only its size), so the entropy
+// decoder can be compared on its own.
+static void benchPng(Bench& bench, const std::string& scratch) {
+	const std::vector<PngImage> corpus = makePngCorpus();
+	for (const PngImage& image : corpus) {
+		if (bench.selected(string::f("PNG decode %s", image.name))) {
+			std::vector<unsigned char> decoded;
+			bool match = true;
+			const double seconds = timeRepeated([&]() {
+				unsigned width = 0;
+				unsigned height = 0;
+				decoded.clear();
+				unsigned error = lodepng::decode(decoded, width, height, image.png, image.colorType);
+				return !error && decoded == image.pixels;
+			}, match);
+			printPng("decode", image, seconds, image.pixels.size(), image.png.size(), match);
+		}
+		if (bench.selected(string::f("PNG region %s", image.name))) {
+			// TEX's case: the top left 256x256 pixels.
+			const unsigned regionWidth = std::min(256u, image.width);
+			const unsigned regionHeight = std::min(256u, image.height);
+			const std::vector<unsigned char> expected = pngCorner(image);
+			std::vector<unsigned char> decoded;
+			bool match = true;
+			const double seconds = timeRepeated([&]() {
+				unsigned width = 0;
+				unsigned height = 0;
+				lodepng::State state;
+				state.info_raw.colortype = image.colorType;
+				decoded.clear();
+				unsigned error = lodepng::decode_region(decoded, width, height, state, image.png, 0, 0, 256, 256);
+				return !error && width == regionWidth && height == regionHeight && decoded == expected;
+			}, match);
+			printPng("region", image, seconds, expected.size(), image.png.size(), match);
+		}
+		if (bench.selected(string::f("PNG file %s", image.name))) {
+			// The same region read from a file, which lodepng maps into memory rather than copying.
+			const std::string path = scratch + "/bench-png.png";
+			const std::vector<unsigned char> expected = pngCorner(image);
+			std::vector<unsigned char> decoded;
+			bool match = lodepng::save_file(image.png, path) == 0;
+			const double seconds = timeRepeated([&]() {
+				unsigned width = 0;
+				unsigned height = 0;
+				decoded.clear();
+				unsigned error = lodepng::decode_region(decoded, width, height, path, 0, 0, 256, 256, image.colorType);
+				return !error && decoded == expected;
+			}, match);
+			printPng("file", image, seconds, expected.size(), image.png.size(), match);
+		}
+		if (bench.selected(string::f("PNG planar %s", image.name))) {
+			// TEX's case again, decoded into a float plane per channel as TEX holds its pixels.
+			const unsigned regionWidth = std::min(256u, image.width);
+			const unsigned regionHeight = std::min(256u, image.height);
+			const size_t pixelBytes = image.pixels.size() / ((size_t)image.width * image.height);
+			const float scale = 10.f / 255;
+			std::vector<float> planes[4];
+			LodePNGPlanes out = {};
+			for (unsigned c = 0; c < pixelBytes; c++) {
+				planes[c].resize(256 * 256);
+				out.planes[c] = planes[c].data();
+			}
+			out.floats = 1;
+			out.scale = scale;
+			out.stride = 256;
+			// Grey comes out alike in the red, green and blue planes, so only red is checked, and alpha after it.
+			if (pixelBytes < 3)
+				std::swap(out.planes[1], out.planes[3]);
+			bool match = true;
+			const double seconds = timeRepeated([&]() {
+				unsigned width = 0;
+				unsigned height = 0;
+				lodepng::State state;
+				unsigned error = lodepng_decode_planar(&out, &width, &height, &state, image.png.data(), image.png.size(),
+					0, 0, 256, 256);
+				if (error || width != regionWidth || height != regionHeight)
+					return false;
+				for (unsigned c = 0; c < pixelBytes; c++) {
+					for (unsigned y = 0; y < regionHeight; y++) {
+						for (unsigned x = 0; x < regionWidth; x++) {
+							const unsigned char v = image.pixels[((size_t)y * image.width + x) * pixelBytes + c];
+							if (planes[c][y * 256 + x] != v * scale)
+								return false;
+						}
+					}
+				}
+				return true;
+			}, match);
+			printPng("planar", image, seconds, (size_t)regionWidth * regionHeight * pixelBytes * sizeof(float),
+				image.png.size(), match);
+		}
+		if (bench.selected(string::f("PNG stream %s", image.name))) {
+			// Fed 64 KB at a time, as if read from a file, with each row copied out as it arrives.
+			struct Rows {
+				std::vector<unsigned char> pixels;
+				size_t rowBytes;
+			} rows;
+			rows.pixels.resize(image.pixels.size());
+			rows.rowBytes = image.pixels.size() / image.height;
+			auto onRow = [](void* user, const unsigned char* row, unsigned y, unsigned w, unsigned h) -> unsigned {
+				Rows* rows = (Rows*)user;
+				std::copy_n(row, rows->rowBytes, rows->pixels.begin() + y * rows->rowBytes);
+				return 0;
+			};
+			bool match = true;
+			const double seconds = timeRepeated([&]() {
+				lodepng::State state;
+				state.info_raw.colortype = image.colorType;
+				LodePNGStreamDecoder* decoder = lodepng_stream_decoder_new(&state, onRow, &rows);
+				unsigned error = 0;
+				for (size_t pos = 0; pos < image.png.size() && !error; pos += 65536)
+					error = lodepng_stream_decoder_feed(decoder, &image.png[pos], std::min<size_t>(65536, image.png.size() - pos));
+				if (!error)
+					error = lodepng_stream_decoder_finish(decoder);
+				lodepng_stream_decoder_delete(decoder);
+				return !error && rows.pixels == image.pixels;
+			}, match);
+			printPng("stream", image, seconds, image.pixels.size(), image.png.size(), match);
+		}
+		if (bench.selected(string::f("PNG banded %s", image.name))) {
+			lodepng::State encoder;
+			encoder.info_raw.colortype = image.colorType;
+			encoder.encoder.band_rows = 64;
+			std::vector<unsigned char> png;
+			std::vector<unsigned char> decoded;
+			bool match = lodepng::encode(png, image.pixels, image.width, image.height, encoder) == 0;
+			const double seconds = timeRepeated([&]() {
+				unsigned width = 0;
+				unsigned height = 0;
+				lodepng::State state;
+				state.info_raw.colortype = image.colorType;
+				state.decoder.parallel_for = parallelFor;
+				decoded.clear();
+				unsigned error = lodepng::decode(decoded, width, height, state, png);
+				return !error && decoded == image.pixels;
+			}, match);
+			printPng("banded", image, seconds, image.pixels.size(), png.size(), match);
+		}
+		if (bench.selected(string::f("PNG inflate %s", image.name))) {
+			const std::vector<unsigned char> idat = pngIdat(image.png);
+			// The encoder picks the colour type it stores, so the scanlines' size comes from the header.
+			lodepng::State state;
+			unsigned width = 0;
+			unsigned height = 0;
+			lodepng_inspect(&width, &height, &state, image.png.data(), image.png.size());
+			const size_t scanlines = (size_t)height * (1 + (width * lodepng_get_bpp(&state.info_png.color) + 7) / 8);
+			std::vector<unsigned char> inflated;
+			bool match = true;
+			const double seconds = timeRepeated([&]() {
+				inflated.clear();
+				unsigned error = lodepng::decompress(inflated, idat);
+				return !error && inflated.size() == scanlines;
+			}, match);
+			printPng("inflate", image, seconds, scanlines, idat.size(), match);
+		}
+	}
+}
+
+// Round-trips random small images through the encoder, which filters with plain C, and the decoder, whose unfilters
+// have SIMD versions: every filter type on random rows, every pixel size from 1 to 8 bytes, with and without
+// interlacing (which unfilters in place). Any pixel that comes back different is a mismatch.
+static void checkPngFilters(Bench& bench) {
+	if (!bench.selected("PNG filters"))
+		return;
+	struct PixelFormat {
+		LodePNGColorType colorType;
+		unsigned bitDepth;
+	};
+	const PixelFormat formats[] = {
+		{LCT_GREY, 8}, {LCT_GREY, 16}, {LCT_GREY_ALPHA, 8}, {LCT_RGB, 8},
+		{LCT_RGBA, 8}, {LCT_GREY_ALPHA, 16}, {LCT_RGB, 16}, {LCT_RGBA, 16},
+	};
+	const int images = 2000;
+	uint32_t seed = 11;
+	auto random = [&seed]() {
+		seed = seed * 1664525u + 1013904223u;
+		return seed >> 8;
+	};
+	int mismatches = 0;
+	for (int n = 0; n < images; n++) {
+		const PixelFormat& format = formats[random() % 8];
+		const unsigned width = 1 + random() % 80;
+		const unsigned height = 1 + random() % 24;
+		lodepng::State state;
+		state.info_raw.colortype = format.colorType;
+		state.info_raw.bitdepth = format.bitDepth;
+		lodepng_color_mode_copy(&state.info_png.color, &state.info_raw);
+		state.info_png.interlace_method = random() % 2;
+		state.encoder.auto_convert = 0;
+		// Interlaced images filter each pass's rows in turn, so there are at most twice as many.
+		std::vector<unsigned char> filters(2 * height + 16);
+		for (unsigned char& filter : filters)
+			filter = random() % 5;
+		state.encoder.filter_strategy = LFS_PREDEFINED;
+		state.encoder.predefined_filters = filters.data();
+
+		// Noise, ramps or nearly flat rows, so the predictors see large, small and equal differences.
+		std::vector<unsigned char> pixels(lodepng_get_raw_size(width, height, &state.info_raw));
+		const int texture = random() % 3;
+		for (size_t i = 0; i < pixels.size(); i++) {
+			const unsigned r = random();
+			pixels[i] = (unsigned char)(texture == 0 ? r : texture == 1 ? i * 7 + (r & 3) : (r % 8 ? 255 : 0));
+		}
+
+		std::vector<unsigned char> png;
+		std::vector<unsigned char> decoded;
+		unsigned decodedWidth = 0;
+		unsigned decodedHeight = 0;
+		lodepng::State decoder;
+		lodepng_color_mode_copy(&decoder.info_raw, &state.info_raw);
+		if (lodepng::encode(png, pixels, width, height, state)
+			|| lodepng::decode(decoded, decodedWidth, decodedHeight, decoder, png) || decoded != pixels)
+			mismatches++;
+	}
+	std::printf("PNG filters: %d random images, %d mismatched\n", images, mismatches);
+	std::fflush(stdout);
+}
+
+struct ChaosCase {
+	const char* name;
+	int system;
+	int rateMode;
+	int integrator;
+	int links;
+	int divider;
+	int oversample;
+	int voices;
+};
+
+// A single 1x oscillator voice's budget, in nanoseconds per sample: two thirds of a percent of a core at 44.1kHz,
+// and well under the control-rate RK4 stepped every sample, which the oscillator used to cost as much as.
+static const double OSCILLATOR_BUDGET_NS = 150.;
+
+// A CHAOS configured as the case describes, every output patched.
+static Module* createChaos(const ChaosCase& c) {
+	Module* module = createPatched(modelChaos);
+	json_t* rootJ = json_object();
+	json_object_set_new(rootJ, "system", json_integer(c.system));
+	json_object_set_new(rootJ, "rate_mode", json_integer(c.rateMode));
+	json_object_set_new(rootJ, "mode", json_integer(c.integrator));
+	json_object_set_new(rootJ, "links", json_integer(c.links));
+	json_object_set_new(rootJ, "rate_divider", json_integer(c.divider));
+	json_object_set_new(rootJ, "oversample", json_integer(c.oversample));
+	module->dataFromJson(rootJ);
+	json_decref(rootJ);
+	module->onSampleRateChange();
+
+	// A polyphonic timewarp cable (input 0), a slightly different speed per voice.
+	if (c.voices > 1) {
+		module->inputs[0].channels = c.voices;
+		for (int v = 0; v < c.voices; v++) {
+			module->inputs[0].setVoltage(v * 0.1f, v);
+		}
+	}
+	return module;
+}
+
+// Returns false when a single oscillator voice is over OSCILLATOR_BUDGET_NS.
+static bool benchChaos(Bench& bench) {
+	// system: 0 pendulum, 1 Lorenz; rate mode: 0 LFO, 1 oscillator; integrator: 0 RK4, 1 Euler. The divider is the
+	// LFO's samples per control tick; a divider of 1 steps the LFO as often as the 1x oscillator. The oscillator's
+	// chain always steps with symplectic Euler, so the integrator only matters to its attractors.
+	const ChaosCase cases[] = {
+		{"CHAOS LFO, RK4, 2 links", 0, 0, 0, 2, 4, 1, 1},
+		{"CHAOS LFO, RK4, 2 links, divider 1", 0, 0, 0, 2, 1, 1, 1},
+		{"CHAOS LFO, Euler, 2 links", 0, 0, 1, 2, 4, 1, 1},
+		{"CHAOS LFO, RK4, 8 links", 0, 0, 0, 8, 4, 1, 1},
+		{"CHAOS LFO, Euler, 8 links", 0, 0, 1, 8, 4, 1, 1},
+		{"CHAOS LFO, RK4, 3 links, 4 voices", 0, 0, 0, 3, 4, 1, 4},
+		{"CHAOS LFO, RK4, 3 links, 16 voices", 0, 0, 0, 3, 4, 1, 16},
+		{"CHAOS LFO, RK4, Lorenz", 1, 0, 0, 2, 4, 1, 1},
+		{"CHAOS oscillator, 2 links", 0, 1, 0, 2, 4, 1, 1},
+		{"CHAOS oscillator, 2 links, 4x", 0, 1, 0, 2, 4, 4, 1},
+		{"CHAOS oscillator, 2 links, 16 voices", 0, 1, 0, 2, 4, 1, 16},
+		{"CHAOS oscillator, RK4, Lorenz", 1, 1, 0, 2, 4, 1, 1},
+	};
+
+	bool withinBudget = true;
+	for (const ChaosCase& c : cases) {
+		const double ns = bench.run(c.name, createChaos(c));
+
+		// The oscillator's budget is one voice's share of a core: the time per sample against the sample period.
+		// Per integrator step it is directly comparable with the LFO at divider 1.
+		if (ns > 0. && c.rateMode == 1 && c.voices == 1) {
+			std::printf("%-44s %9.1f ns/step %8.2f%% of a core at %g Hz\n", "  one voice", ns / c.oversample,
+				100. * ns * 1e-9 * bench.sampleRate, bench.sampleRate);
+			std::fflush(stdout);
+		}
+
+		// The 1x chain is held to its budget, timed again as the fastest of short runs.
+		if (ns > 0. && c.system == 0 && c.rateMode == 1 && c.oversample == 1 && c.voices == 1) {
+			const double best = bench.fastest(createChaos(c), 2000, 500);
+			withinBudget = best <= OSCILLATOR_BUDGET_NS;
+			std::printf("%-44s %9.1f ns/sample, budget %g: %s\n", "  one voice, fastest run", best, OSCILLATOR_BUDGET_NS,
+				withinBudget ? "ok" : "OVER BUDGET");
+			std::fflush(stdout);
+		}
+	}
+	return withinBudget;
+}
+
+int main(int argc, char** argv) {
+	Plugin* plugin = new Plugin;
+	init(plugin);
+
+	Bench bench;
+	if (argc > 1)
+		bench.samples = std::max(1L, std::atol(argv[1]));
+	const std::string scratch = (argc > 2) ? argv[2] : ".";
+	if (argc > 3)
+		bench.filter = argv[3];
+	APP->engine->sampleRate = bench.sampleRate;
+
+	std::printf("%ld samples per case at %g Hz%s\n", bench.samples, bench.sampleRate,
+		bench.counter.available() ? "" : " (no cycle counter)");
+
+	checkPngFilters(bench);
+	benchPng(bench, scratch);
+
+	const std::string imagePath = scratch + "/bench-tex.png";
+	if (writeTexImage(imagePath))
+		benchTex(bench, imagePath);
+	else
+		std::printf("TEX skipped: could not write %s\n", imagePath.c_str());
+	return benchChaos(bench) ? 0 : 1;
+}
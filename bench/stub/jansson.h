@@ -0,0 +1,53 @@
+#pragma once
+// Minimal in-memory subset of the jansson API used by module dataToJson/dataFromJson.
+#include <map>
+#include <string>
+#include <cstddef>
+
+struct json_t {
+	enum Type { OBJECT, INTEGER, REAL, STRING, BOOL_TRUE, BOOL_FALSE } type;
+	long long i = 0;
+	double r = 0.0;
+	std::string s;
+	std::map<std::string, json_t*> o;
+	explicit json_t(Type t) : type(t) {}
+	~json_t() {
+		for (auto& kv : o)
+			delete kv.second;
+	}
+};
+
+inline json_t* json_object() { return new json_t(json_t::OBJECT); }
+inline json_t* json_integer(long long v) { json_t* j = new json_t(json_t::INTEGER); j->i = v; return j; }
+inline json_t* json_real(double v) { json_t* j = new json_t(json_t::REAL); j->r = v; return j; }
+inline json_t* json_string(const char* v) { json_t* j = new json_t(json_t::STRING); j->s = v ? v : ""; return j; }
+inline json_t* json_boolean(bool v) { return new json_t(v ? json_t::BOOL_TRUE : json_t::BOOL_FALSE); }
+inline json_t* json_true() { return json_boolean(true); }
+inline json_t* json_false() { return json_boolean(false); }
+
+inline int json_object_set_new(json_t* obj, const char* key, json_t* value) {
+	auto it = obj->o.find(key);
+	if (it != obj->o.end())
+		delete it->second;
+	obj->o[key] = value;
+	return 0;
+}
+inline json_t* json_object_get(const json_t* obj, const char* key) {
+	if (!obj || obj->type != json_t::OBJECT)
+		return NULL;
+	auto it = obj->o.find(key);
+	return (it == obj->o.end()) ? NULL : it->second;
+}
+inline long long json_integer_value(const json_t* j) {
+	if (!j) return 0;
+	return (j->type == json_t::REAL) ? (long long)j->r : j->i;
+}
+inline double json_real_value(const json_t* j) {
+	if (!j) return 0.0;
+	return (j->type == json_t::INTEGER) ? (double)j->i : j->r;
+}
+inline double json_number_value(const json_t* j) { return json_real_value(j); }
+inline const char* json_string_value(const json_t* j) { return j ? j->s.c_str() : NULL; }
+inline bool json_is_true(const json_t* j) { return j && j->type == json_t::BOOL_TRUE; }
+inline bool json_boolean_value(const json_t* j) { return json_is_true(j); }
+inline void json_decref(json_t* j) { delete j; }
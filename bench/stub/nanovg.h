@@ -0,0 +1,42 @@
+#pragma once
+// No-op subset of nanovg so widget code compiles headless.
+
+struct NVGcontext {};
+struct NVGcolor { float r, g, b, a; };
+struct NVGpaint { float xform[6]; float extent[2]; float radius, feather; NVGcolor innerColor, outerColor; int image; };
+
+enum NVGlineCap { NVG_BUTT, NVG_ROUND, NVG_SQUARE, NVG_BEVEL, NVG_MITER };
+enum NVGimageFlags { NVG_IMAGE_GENERATE_MIPMAPS = 1, NVG_IMAGE_REPEATX = 2, NVG_IMAGE_REPEATY = 4, NVG_IMAGE_FLIPY = 8, NVG_IMAGE_PREMULTIPLIED = 16, NVG_IMAGE_NEAREST = 32 };
+
+inline NVGcolor nvgRGBA(unsigned char r, unsigned char g, unsigned char b, unsigned char a) { return NVGcolor{r / 255.f, g / 255.f, b / 255.f, a / 255.f}; }
+inline NVGcolor nvgRGB(unsigned char r, unsigned char g, unsigned char b) { return nvgRGBA(r, g, b, 255); }
+inline NVGcolor nvgRGBAf(float r, float g, float b, float a) { return NVGcolor{r, g, b, a}; }
+inline NVGcolor nvgTransRGBA(NVGcolor c, unsigned char a) { c.a = a / 255.f; return c; }
+inline NVGcolor nvgTransRGBAf(NVGcolor c, float a) { c.a = a; return c; }
+
+inline void nvgSave(NVGcontext*) {}
+inline void nvgRestore(NVGcontext*) {}
+inline void nvgBeginPath(NVGcontext*) {}
+inline void nvgClosePath(NVGcontext*) {}
+inline void nvgMoveTo(NVGcontext*, float, float) {}
+inline void nvgLineTo(NVGcontext*, float, float) {}
+inline void nvgCircle(NVGcontext*, float, float, float) {}
+inline void nvgRect(NVGcontext*, float, float, float, float) {}
+inline void nvgStroke(NVGcontext*) {}
+inline void nvgFill(NVGcontext*) {}
+inline void nvgStrokeWidth(NVGcontext*, float) {}
+inline void nvgStrokeColor(NVGcontext*, NVGcolor) {}
+inline void nvgFillColor(NVGcontext*, NVGcolor) {}
+inline void nvgFillPaint(NVGcontext*, NVGpaint) {}
+inline void nvgLineCap(NVGcontext*, int) {}
+inline void nvgGlobalAlpha(NVGcontext*, float) {}
+inline void nvgScissor(NVGcontext*, float, float, float, float) {}
+inline void nvgResetScissor(NVGcontext*) {}
+inline void nvgScale(NVGcontext*, float, float) {}
+inline void nvgTranslate(NVGcontext*, float, float) {}
+inline int nvgCreateImage(NVGcontext*, const char*, int) { return 0; }
+inline int nvgCreateImageRGBA(NVGcontext*, int, int, int, const unsigned char*) { return 0; }
+inline void nvgUpdateImage(NVGcontext*, int, const unsigned char*) {}
+inline void nvgDeleteImage(NVGcontext*, int) {}
+inline void nvgImageSize(NVGcontext*, int, int* w, int* h) { *w = 0; *h = 0; }
+inline NVGpaint nvgImagePattern(NVGcontext*, float, float, float, float, float, int image, float) { NVGpaint p = NVGpaint(); p.image = image; return p; }
@@ -0,0 +1,8 @@
+#pragma once
+// Headless stand-in for osdialog: every dialog is cancelled.
+#include <cstddef>
+
+typedef enum { OSDIALOG_OPEN, OSDIALOG_OPEN_DIR, OSDIALOG_SAVE } osdialog_file_action;
+typedef struct osdialog_filters osdialog_filters;
+
+inline char* osdialog_file(osdialog_file_action action, const char* path, const char* filename, osdialog_filters* filters) { return NULL; }
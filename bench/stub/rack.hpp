@@ -0,0 +1,868 @@
+#pragma once
+// Minimal headless subset of the VCV Rack v1 SDK, for `make bench`.
+//
+// Only what the Loco modules touch is declared here. The engine types keep
+// their real layout and semantics (polyphonic ports, expander message
+// flipping, ODE steppers, SIMD vectors) so process() runs the same code it
+// runs inside Rack; every widget and drawing call is a no-op.
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <list>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <pmmintrin.h>
+
+#include "jansson.h"
+#include "nanovg.h"
+
+#define GLFW_MOUSE_BUTTON_LEFT 0
+#define GLFW_MOUSE_BUTTON_RIGHT 1
+#define GLFW_RELEASE 0
+#define GLFW_PRESS 1
+#define GLFW_MOD_SHIFT 0x0001
+#define GLFW_MOD_CONTROL 0x0002
+
+#define RACK_GRID_WIDTH 15
+#define RACK_GRID_HEIGHT 380
+#define CHECKMARK_STRING "\xE2\x9C\x94"
+#define CHECKMARK(_cond) ((_cond) ? CHECKMARK_STRING : "")
+#define RIGHT_ARROW "\xE2\x96\xB8"
+
+#define INFO(format, ...) std::fprintf(stderr, "[info] " format "\n", ##__VA_ARGS__)
+#define WARN(format, ...) std::fprintf(stderr, "[warn] " format "\n", ##__VA_ARGS__)
+#define DEBUG(format, ...) std::fprintf(stderr, "[debug] " format "\n", ##__VA_ARGS__)
+
+namespace rack {
+
+template <typename T, typename... Args>
+T* construct() {
+	return new T;
+}
+
+template <typename T, typename F, typename V, typename... Args>
+T* construct(F f, V v, Args... args) {
+	T* o = construct<T>(args...);
+	o->*f = v;
+	return o;
+}
+
+namespace math {
+
+inline int clamp(int x, int a, int b) { return std::max(std::min(x, b), a); }
+inline float clamp(float x, float a, float b) { return std::fmax(std::fmin(x, b), a); }
+inline float rescale(float x, float xMin, float xMax, float yMin, float yMax) { return yMin + (x - xMin) / (xMax - xMin) * (yMax - yMin); }
+inline float crossfade(float a, float b, float p) { return a + (b - a) * p; }
+inline float eucMod(float a, float base) {
+	float mod = std::fmod(a, base);
+	return (mod >= 0.f) ? mod : mod + base;
+}
+inline int eucMod(int a, int base) {
+	int mod = a % base;
+	return (mod >= 0) ? mod : mod + base;
+}
+inline bool isPow2(int n) { return n > 0 && (n & (n - 1)) == 0; }
+
+struct Vec {
+	float x = 0.f;
+	float y = 0.f;
+	Vec() {}
+	Vec(float x, float y) : x(x), y(y) {}
+	Vec plus(Vec b) const { return Vec(x + b.x, y + b.y); }
+	Vec minus(Vec b) const { return Vec(x - b.x, y - b.y); }
+	Vec mult(float s) const { return Vec(x * s, y * s); }
+	Vec div(float s) const { return Vec(x / s, y / s); }
+};
+
+struct Rect {
+	Vec pos;
+	Vec size;
+	Rect() {}
+	Rect(Vec pos, Vec size) : pos(pos), size(size) {}
+	bool isContaining(Vec v) const { return pos.x <= v.x && v.x < pos.x + size.x && pos.y <= v.y && v.y < pos.y + size.y; }
+};
+
+} // namespace math
+
+namespace simd {
+
+template <typename T, int N>
+struct Vector;
+
+template <>
+struct Vector<float, 4> {
+	union {
+		__m128 v;
+		float s[4];
+	};
+	Vector() = default;
+	Vector(__m128 v) : v(v) {}
+	Vector(float x) { v = _mm_set1_ps(x); }
+	Vector(float x1, float x2, float x3, float x4) { v = _mm_setr_ps(x1, x2, x3, x4); }
+	static Vector zero() { return Vector(_mm_setzero_ps()); }
+	static Vector mask() { return Vector(_mm_castsi128_ps(_mm_set1_epi32(-1))); }
+	static Vector load(const float* x) { return Vector(_mm_loadu_ps(x)); }
+	void store(float* x) { _mm_storeu_ps(x, v); }
+	float& operator[](int i) { return s[i]; }
+	const float& operator[](int i) const { return s[i]; }
+};
+
+typedef Vector<float, 4> float_4;
+
+#define SIMD_BINOP(op, intrin) \
+	inline float_4 operator op(const float_4& a, const float_4& b) { return float_4(intrin(a.v, b.v)); } \
+	inline float_4 operator op(const float_4& a, float b) { return float_4(intrin(a.v, _mm_set1_ps(b))); } \
+	inline float_4 operator op(float a, const float_4& b) { return float_4(intrin(_mm_set1_ps(a), b.v)); } \
+	inline float_4& operator op##=(float_4& a, const float_4& b) { a = a op b; return a; } \
+	inline float_4& operator op##=(float_4& a, float b) { a = a op b; return a; }
+
+SIMD_BINOP(+, _mm_add_ps)
+SIMD_BINOP(-, _mm_sub_ps)
+SIMD_BINOP(*, _mm_mul_ps)
+SIMD_BINOP(/, _mm_div_ps)
+SIMD_BINOP(&, _mm_and_ps)
+SIMD_BINOP(|, _mm_or_ps)
+SIMD_BINOP(^, _mm_xor_ps)
+#undef SIMD_BINOP
+
+#define SIMD_CMPOP(op, intrin) \
+	inline float_4 operator op(const float_4& a, const float_4& b) { return float_4(intrin(a.v, b.v)); } \
+	inline float_4 operator op(const float_4& a, float b) { return float_4(intrin(a.v, _mm_set1_ps(b))); } \
+	inline float_4 operator op(float a, const float_4& b) { return float_4(intrin(_mm_set1_ps(a), b.v)); }
+
+SIMD_CMPOP(==, _mm_cmpeq_ps)
+SIMD_CMPOP(!=, _mm_cmpneq_ps)
+SIMD_CMPOP(<, _mm_cmplt_ps)
+SIMD_CMPOP(<=, _mm_cmple_ps)
+SIMD_CMPOP(>, _mm_cmpgt_ps)
+SIMD_CMPOP(>=, _mm_cmpge_ps)
+#undef SIMD_CMPOP
+
+inline float_4 operator-(const float_4& a) { return 0.f - a; }
+inline float_4 operator~(const float_4& a) { return float_4(_mm_andnot_ps(a.v, float_4::mask().v)); }
+
+inline float_4 ifelse(float_4 mask, float_4 a, float_4 b) { return (mask & a) | float_4(_mm_andnot_ps(mask.v, b.v)); }
+template <typename T>
+T ifelse(bool cond, T a, T b) { return cond ? a : b; }
+inline int movemask(float_4 a) { return _mm_movemask_ps(a.v); }
+
+inline float_4 fmax(float_4 a, float_4 b) { return float_4(_mm_max_ps(a.v, b.v)); }
+inline float_4 fmin(float_4 a, float_4 b) { return float_4(_mm_min_ps(a.v, b.v)); }
+inline float_4 sqrt(float_4 a) { return float_4(_mm_sqrt_ps(a.v)); }
+inline float_4 fabs(float_4 a) { return float_4(_mm_andnot_ps(_mm_set1_ps(-0.f), a.v)); }
+inline float_4 clamp(float_4 x, float_4 a, float_4 b) { return fmin(fmax(x, a), b); }
+
+#define SIMD_UNARY(name) \
+	inline float_4 name(float_4 a) { return float_4(std::name(a[0]), std::name(a[1]), std::name(a[2]), std::name(a[3])); }
+SIMD_UNARY(sin)
+SIMD_UNARY(cos)
+SIMD_UNARY(floor)
+SIMD_UNARY(trunc)
+SIMD_UNARY(round)
+SIMD_UNARY(exp)
+SIMD_UNARY(exp2)
+SIMD_UNARY(log)
+SIMD_UNARY(log2)
+#undef SIMD_UNARY
+
+inline float_4 fmod(float_4 a, float_4 b) { return a - trunc(a / b) * b; }
+inline float_4 pow(float_4 a, float_4 b) { return exp2(b * log2(a)); }
+inline float_4 pow(float a, float_4 b) { return exp2(b * std::log2(a)); }
+inline float_4 rescale(float_4 x, float_4 xMin, float_4 xMax, float_4 yMin, float_4 yMax) { return yMin + (x - xMin) / (xMax - xMin) * (yMax - yMin); }
+inline float_4 crossfade(float_4 a, float_4 b, float_4 p) { return a + (b - a) * p; }
+
+using std::sin;
+using std::cos;
+using std::sqrt;
+using std::fabs;
+using std::floor;
+using std::trunc;
+using std::round;
+using std::fmod;
+using std::fmax;
+using std::fmin;
+using std::exp;
+using std::exp2;
+using std::log;
+using std::log2;
+using std::pow;
+using math::clamp;
+using math::rescale;
+using math::crossfade;
+
+} // namespace simd
+
+namespace random {
+
+inline std::mt19937& engine() {
+	static std::mt19937 e(0x10c0);
+	return e;
+}
+inline uint32_t u32() { return engine()(); }
+inline float uniform() { return std::uniform_real_distribution<float>(0.f, 1.f)(engine()); }
+inline float normal() { return std::normal_distribution<float>(0.f, 1.f)(engine()); }
+
+} // namespace random
+
+namespace string {
+inline std::string directory(const std::string& path) {
+	size_t pos = path.find_last_of('/');
+	return (pos == std::string::npos) ? std::string(".") : path.substr(0, pos);
+}
+inline std::string f(const char* format, ...) {
+	char buf[1024];
+	va_list args;
+	va_start(args, format);
+	std::vsnprintf(buf, sizeof(buf), format, args);
+	va_end(args);
+	return buf;
+}
+} // namespace string
+
+namespace dsp {
+
+static const float FREQ_C4 = 261.6256f;
+
+/** Returns 2^x with a 5th order polynomial on the fractional part. */
+inline float approxExp2_taylor5(float x) {
+	float xi = std::floor(x);
+	float xf = x - xi;
+	float y = 1.f + xf * (0.6931471805599453f + xf * (0.2402265069591007f + xf * (0.05550410866482158f + xf * (0.009618129107628477f + xf * 0.0013333558146428443f))));
+	return std::ldexp(y, (int)xi);
+}
+inline simd::float_4 approxExp2_taylor5(simd::float_4 x) {
+	return simd::float_4(approxExp2_taylor5(x[0]), approxExp2_taylor5(x[1]), approxExp2_taylor5(x[2]), approxExp2_taylor5(x[3]));
+}
+
+template <typename T, typename F>
+T stepEuler(T t, T dt, T x[], int len, F f) {
+	T k[len];
+	f(t, x, k);
+	for (int i = 0; i < len; i++)
+		x[i] += dt * k[i];
+	return t + dt;
+}
+
+template <typename T, typename F>
+T stepRK4(T t, T dt, T x[], int len, F f) {
+	T k1[len];
+	T k2[len];
+	T k3[len];
+	T k4[len];
+	T yi[len];
+
+	f(t, x, k1);
+	for (int i = 0; i < len; i++)
+		yi[i] = x[i] + k1[i] * dt / T(2);
+	f(t + dt / T(2), yi, k2);
+	for (int i = 0; i < len; i++)
+		yi[i] = x[i] + k2[i] * dt / T(2);
+	f(t + dt / T(2), yi, k3);
+	for (int i = 0; i < len; i++)
+		yi[i] = x[i] + k3[i] * dt;
+	f(t + dt, yi, k4);
+	for (int i = 0; i < len; i++)
+		x[i] += dt * (k1[i] + T(2) * k2[i] + T(2) * k3[i] + k4[i]) / T(6);
+	return t + dt;
+}
+
+struct SchmittTrigger {
+	bool state = true;
+	void reset() { state = true; }
+	bool process(float in) {
+		if (state) {
+			if (in <= 0.f)
+				state = false;
+		}
+		else if (in >= 1.f) {
+			state = true;
+			return true;
+		}
+		return false;
+	}
+	bool isHigh() { return state; }
+};
+
+struct BooleanTrigger {
+	bool state = true;
+	void reset() { state = true; }
+	bool process(bool state) {
+		bool triggered = (state && !this->state);
+		this->state = state;
+		return triggered;
+	}
+};
+
+struct PulseGenerator {
+	float remaining = 0.f;
+	void reset() { remaining = 0.f; }
+	bool process(float deltaTime) {
+		if (remaining > 0.f) {
+			remaining -= deltaTime;
+			return true;
+		}
+		return false;
+	}
+	void trigger(float duration = 1e-3f) {
+		if (duration > remaining)
+			remaining = duration;
+	}
+};
+
+/** Lock-free queue with fixed size buffer and fixed size.
+Not thread-safe, unless pushing and shifting is done in different threads.
+*/
+template <typename T, size_t S>
+struct RingBuffer {
+	std::atomic<size_t> start{0};
+	std::atomic<size_t> end{0};
+	T data[S];
+
+	void push(T t) {
+		size_t i = end % S;
+		data[i] = t;
+		end++;
+	}
+	T shift() {
+		size_t i = start % S;
+		T t = data[i];
+		start++;
+		return t;
+	}
+	void clear() { start = end.load(); }
+	bool empty() const { return start == end; }
+	bool full() const { return end - start == S; }
+	size_t size() const { return end - start; }
+	size_t capacity() const { return S - size(); }
+};
+
+inline float sinc(float x) {
+	if (x == 0.f)
+		return 1.f;
+	x *= M_PI;
+	return std::sin(x) / x;
+}
+
+inline void blackmanHarrisWindow(float* x, int len) {
+	const float a0 = 0.35875f, a1 = 0.48829f, a2 = 0.14128f, a3 = 0.01168f;
+	float factor = 2 * M_PI / (len - 1);
+	for (int i = 0; i < len; i++) {
+		x[i] *= a0 - a1 * std::cos(1 * factor * i) + a2 * std::cos(2 * factor * i) - a3 * std::cos(3 * factor * i);
+	}
+}
+
+inline void boxcarLowpassIR(float* out, int len, float cutoff = 0.5f) {
+	for (int i = 0; i < len; i++) {
+		float t = i - (len - 1) / 2.f;
+		out[i] = 2 * cutoff * sinc(2 * cutoff * t);
+	}
+}
+
+template <int OVERSAMPLE, int QUALITY, typename T = float>
+struct Decimator {
+	T inBuffer[OVERSAMPLE * QUALITY];
+	float kernel[OVERSAMPLE * QUALITY];
+	int inIndex;
+
+	Decimator(float cutoff = 0.9f) {
+		boxcarLowpassIR(kernel, OVERSAMPLE * QUALITY, cutoff * 0.5f / OVERSAMPLE);
+		blackmanHarrisWindow(kernel, OVERSAMPLE * QUALITY);
+		reset();
+	}
+	void reset() {
+		inIndex = 0;
+		for (int i = 0; i < OVERSAMPLE * QUALITY; i++)
+			inBuffer[i] = 0.f;
+	}
+	T process(T* in) {
+		std::memcpy(&inBuffer[inIndex], in, OVERSAMPLE * sizeof(T));
+		inIndex += OVERSAMPLE;
+		inIndex %= OVERSAMPLE * QUALITY;
+		T out = 0.f;
+		for (int i = 0; i < OVERSAMPLE * QUALITY; i++) {
+			int index = inIndex - 1 - i;
+			index = (index + OVERSAMPLE * QUALITY) % (OVERSAMPLE * QUALITY);
+			out += kernel[i] * inBuffer[index];
+		}
+		return out;
+	}
+};
+
+} // namespace dsp
+
+namespace plugin {
+struct Model;
+struct Plugin;
+} // namespace plugin
+
+namespace engine {
+
+static const int PORT_MAX_CHANNELS = 16;
+
+struct Param {
+	float value = 0.f;
+	float getValue() { return value; }
+	void setValue(float value) { this->value = value; }
+};
+
+struct ParamQuantity {
+	float minValue = 0.f;
+	float maxValue = 1.f;
+	float defaultValue = 0.f;
+	std::string label;
+	std::string unit;
+	std::string description;
+	bool snapEnabled = false;
+};
+
+struct Port {
+	union {
+		float voltages[PORT_MAX_CHANNELS] = {};
+		float value;
+	};
+	uint8_t channels = 0;
+
+	void setVoltage(float voltage, int channel = 0) { voltages[channel] = voltage; }
+	float getVoltage(int channel = 0) { return voltages[channel]; }
+	float getPolyVoltage(int channel) { return isMonophonic() ? getVoltage(0) : getVoltage(channel); }
+	float getNormalVoltage(float normalVoltage, int channel = 0) { return isConnected() ? getVoltage(channel) : normalVoltage; }
+	float getNormalPolyVoltage(float normalVoltage, int channel) { return isConnected() ? getPolyVoltage(channel) : normalVoltage; }
+	float* getVoltages(int firstChannel = 0) { return &voltages[firstChannel]; }
+	float getVoltageSum() {
+		float sum = 0.f;
+		for (int c = 0; c < channels; c++)
+			sum += voltages[c];
+		return sum;
+	}
+	template <typename T>
+	T getVoltageSimd(int firstChannel) { return T::load(&voltages[firstChannel]); }
+	template <typename T>
+	T getPolyVoltageSimd(int firstChannel) { return isMonophonic() ? T(getVoltage(0)) : getVoltageSimd<T>(firstChannel); }
+	template <typename T>
+	void setVoltageSimd(T voltage, int firstChannel) { voltage.store(&voltages[firstChannel]); }
+	void setChannels(int channels) {
+		// If disconnected, keep the number of channels at 0.
+		if (this->channels == 0)
+			return;
+		if (channels == 0)
+			channels = 1;
+		this->channels = channels;
+	}
+	int getChannels() { return channels; }
+	bool isConnected() { return channels > 0; }
+	bool isMonophonic() { return channels == 1; }
+	bool isPolyphonic() { return channels > 1; }
+};
+
+struct Output : Port {};
+struct Input : Port {};
+
+struct Light {
+	float value = 0.f;
+	void setBrightness(float brightness) { value = brightness; }
+	float getBrightness() { return value; }
+	void setBrightnessSmooth(float brightness, float deltaTime, float lambda = 30.f) { value += (brightness - value) * lambda * deltaTime; }
+};
+
+struct Module {
+	int id = -1;
+	plugin::Model* model = NULL;
+	std::vector<Param> params;
+	std::vector<Input> inputs;
+	std::vector<Output> outputs;
+	std::vector<Light> lights;
+	std::vector<ParamQuantity*> paramQuantities;
+
+	/** Represents a message-passing channel for an adjacent module. */
+	struct Expander {
+		int moduleId = -1;
+		Module* module = NULL;
+		void* producerMessage = NULL;
+		void* consumerMessage = NULL;
+		bool messageFlipRequested = false;
+	};
+	Expander leftExpander;
+	Expander rightExpander;
+	bool bypass = false;
+
+	Module() {}
+	virtual ~Module() {
+		for (ParamQuantity* pq : paramQuantities)
+			delete pq;
+	}
+
+	void config(int numParams, int numInputs, int numOutputs, int numLights = 0) {
+		params.resize(numParams);
+		inputs.resize(numInputs);
+		outputs.resize(numOutputs);
+		lights.resize(numLights);
+		paramQuantities.resize(numParams);
+		for (int i = 0; i < numParams; i++)
+			paramQuantities[i] = new ParamQuantity;
+	}
+
+	template <class TParamQuantity = ParamQuantity>
+	void configParam(int paramId, float minValue, float maxValue, float defaultValue, std::string label = "", std::string unit = "", float displayBase = 0.f, float displayMultiplier = 1.f, float displayOffset = 0.f) {
+		params[paramId].value = defaultValue;
+		ParamQuantity* q = paramQuantities[paramId];
+		q->minValue = minValue;
+		q->maxValue = maxValue;
+		q->defaultValue = defaultValue;
+		q->label = label;
+		q->unit = unit;
+	}
+
+	struct ProcessArgs {
+		float sampleRate;
+		float sampleTime;
+	};
+
+	virtual void process(const ProcessArgs& args) {}
+	virtual json_t* dataToJson() { return NULL; }
+	virtual void dataFromJson(json_t* rootJ) {}
+	virtual void onAdd() {}
+	virtual void onRemove() {}
+	virtual void onReset() {}
+	virtual void onRandomize() {}
+	virtual void onSampleRateChange() {}
+};
+
+struct Engine {
+	float sampleRate = 44100.f;
+	float getSampleRate() { return sampleRate; }
+	float getSampleTime() { return 1.f / sampleRate; }
+};
+
+} // namespace engine
+
+namespace widget {
+
+struct Widget;
+
+} // namespace widget
+
+namespace event {
+
+struct Base {
+	widget::Widget* consumed = NULL;
+	void consume(widget::Widget* w) const { const_cast<Base*>(this)->consumed = w; }
+	bool isConsumed() const { return consumed != NULL; }
+};
+struct PositionBase { math::Vec pos; };
+struct Action : Base {};
+struct Change : Base {};
+struct Hover : Base, PositionBase { math::Vec mouseDelta; };
+struct Button : Base, PositionBase { int button = 0; int action = 0; int mods = 0; };
+struct DragStart : Base { int button = 0; };
+struct DragMove : Base { int button = 0; math::Vec mouseDelta; };
+struct DragEnd : Base { int button = 0; };
+
+} // namespace event
+
+struct Svg {};
+
+namespace widget {
+
+struct Widget {
+	math::Rect box;
+	Widget* parent = NULL;
+	std::list<Widget*> children;
+	bool visible = true;
+
+	struct DrawArgs {
+		NVGcontext* vg = NULL;
+		math::Rect clipBox;
+	};
+
+	virtual ~Widget() {
+		for (Widget* child : children)
+			delete child;
+	}
+	void addChild(Widget* child) {
+		if (!child)
+			return;
+		child->parent = this;
+		children.push_back(child);
+	}
+	virtual void step() {}
+	virtual void draw(const DrawArgs& args) {}
+	virtual void onHover(const event::Hover& e) {}
+	virtual void onButton(const event::Button& e) {}
+	virtual void onDragStart(const event::DragStart& e) {}
+	virtual void onDragMove(const event::DragMove& e) {}
+	virtual void onDragEnd(const event::DragEnd& e) {}
+	virtual void onAction(const event::Action& e) {}
+	virtual void onChange(const event::Change& e) {}
+};
+
+struct OpaqueWidget : Widget {
+	void onButton(const event::Button& e) override { e.consume(this); }
+};
+struct TransparentWidget : Widget {};
+
+struct FramebufferWidget : Widget {
+	bool dirty = true;
+};
+
+} // namespace widget
+
+namespace ui {
+
+struct Quantity {
+	virtual ~Quantity() {}
+	virtual void setValue(float value) {}
+	virtual float getValue() { return 0.f; }
+	virtual float getMinValue() { return 0.f; }
+	virtual float getMaxValue() { return 1.f; }
+	virtual float getDefaultValue() { return 0.f; }
+	virtual std::string getLabel() { return ""; }
+	virtual std::string getUnit() { return ""; }
+	virtual int getDisplayPrecision() { return 5; }
+};
+
+struct Menu : widget::OpaqueWidget {};
+
+struct MenuEntry : widget::OpaqueWidget {};
+
+struct MenuLabel : MenuEntry {
+	std::string text;
+};
+
+struct MenuSeparator : MenuEntry {};
+
+struct MenuItem : MenuEntry {
+	std::string text;
+	std::string rightText;
+	bool disabled = false;
+	virtual Menu* createChildMenu() { return NULL; }
+	void onAction(const event::Action& e) override {}
+};
+
+struct Slider : widget::OpaqueWidget {
+	Quantity* quantity = NULL;
+};
+
+} // namespace ui
+
+namespace app {
+
+struct ParamWidget : widget::OpaqueWidget {
+	engine::Module* module = NULL;
+	int paramId = 0;
+};
+struct PortWidget : widget::OpaqueWidget {
+	engine::Module* module = NULL;
+	int portId = 0;
+};
+struct ModuleLightWidget : widget::Widget {
+	engine::Module* module = NULL;
+	int firstLightId = 0;
+};
+
+struct ModuleWidget : widget::OpaqueWidget {
+	plugin::Model* model = NULL;
+	engine::Module* module = NULL;
+
+	ModuleWidget() { box.size = math::Vec(RACK_GRID_WIDTH * 15, RACK_GRID_HEIGHT); }
+	void setModule(engine::Module* module) { this->module = module; }
+	void setPanel(std::shared_ptr<Svg> svg) {}
+	void addParam(ParamWidget* param) { addChild(param); }
+	void addInput(PortWidget* input) { addChild(input); }
+	void addOutput(PortWidget* output) { addChild(output); }
+	virtual void appendContextMenu(ui::Menu* menu) {}
+};
+
+struct Window {
+	NVGcontext* vg = NULL;
+	std::shared_ptr<Svg> loadSvg(const std::string& filename) { return std::make_shared<Svg>(); }
+};
+
+struct Context {
+	engine::Engine* engine = NULL;
+	Window* window = NULL;
+};
+
+inline Context* appGet() {
+	static engine::Engine engine;
+	static Window window;
+	static Context context;
+	context.engine = &engine;
+	context.window = &window;
+	return &context;
+}
+
+} // namespace app
+
+#define APP rack::app::appGet()
+
+namespace plugin {
+
+struct Model {
+	Plugin* plugin = NULL;
+	std::string slug;
+	virtual ~Model() {}
+	virtual engine::Module* createModule() = 0;
+	virtual app::ModuleWidget* createModuleWidget() = 0;
+};
+
+struct Plugin {
+	std::vector<Model*> models;
+	std::string slug;
+	void addModel(Model* model) {
+		model->plugin = this;
+		models.push_back(model);
+	}
+};
+
+} // namespace plugin
+
+namespace asset {
+inline std::string plugin(plugin::Plugin* plugin, std::string filename) { return filename; }
+inline std::string user(std::string filename) { return filename; }
+inline std::string system(std::string filename) { return filename; }
+} // namespace asset
+
+namespace componentlibrary {
+
+struct ScrewSilver : widget::Widget {};
+struct RoundKnob : app::ParamWidget {};
+struct RoundBlackKnob : RoundKnob {};
+struct RoundSmallBlackKnob : RoundKnob {};
+struct RoundBlackSnapKnob : RoundKnob {};
+struct Trimpot : RoundKnob {};
+struct CKD6 : app::ParamWidget {};
+struct CKSS : app::ParamWidget {};
+struct CKSSThree : app::ParamWidget {};
+struct TL1105 : app::ParamWidget {};
+struct PJ301MPort : app::PortWidget {};
+struct GrayModuleLightWidget : app::ModuleLightWidget {};
+struct GreenLight : GrayModuleLightWidget {};
+struct RedLight : GrayModuleLightWidget {};
+struct YellowLight : GrayModuleLightWidget {};
+struct BlueLight : GrayModuleLightWidget {};
+template <typename TBase>
+struct SmallLight : TBase {};
+template <typename TBase>
+struct MediumLight : TBase {};
+template <typename TBase>
+struct TinyLight : TBase {};
+
+} // namespace componentlibrary
+
+template <class TWidget>
+TWidget* createWidget(math::Vec pos) {
+	TWidget* o = new TWidget;
+	o->box.pos = pos;
+	return o;
+}
+
+template <class TWidget>
+TWidget* createWidgetCentered(math::Vec pos) {
+	return createWidget<TWidget>(pos);
+}
+
+template <class TParamWidget>
+TParamWidget* createParam(math::Vec pos, engine::Module* module, int paramId) {
+	TParamWidget* o = createWidget<TParamWidget>(pos);
+	o->module = module;
+	o->paramId = paramId;
+	return o;
+}
+
+template <class TParamWidget>
+TParamWidget* createParamCentered(math::Vec pos, engine::Module* module, int paramId) {
+	return createParam<TParamWidget>(pos, module, paramId);
+}
+
+template <class TPortWidget>
+TPortWidget* createInput(math::Vec pos, engine::Module* module, int inputId) {
+	TPortWidget* o = createWidget<TPortWidget>(pos);
+	o->module = module;
+	o->portId = inputId;
+	return o;
+}
+
+template <class TPortWidget>
+TPortWidget* createInputCentered(math::Vec pos, engine::Module* module, int inputId) {
+	return createInput<TPortWidget>(pos, module, inputId);
+}
+
+template <class TPortWidget>
+TPortWidget* createOutput(math::Vec pos, engine::Module* module, int outputId) {
+	return createInput<TPortWidget>(pos, module, outputId);
+}
+
+template <class TPortWidget>
+TPortWidget* createOutputCentered(math::Vec pos, engine::Module* module, int outputId) {
+	return createOutput<TPortWidget>(pos, module, outputId);
+}
+
+template <class TModuleLightWidget>
+TModuleLightWidget* createLight(math::Vec pos, engine::Module* module, int firstLightId) {
+	TModuleLightWidget* o = createWidget<TModuleLightWidget>(pos);
+	o->module = module;
+	o->firstLightId = firstLightId;
+	return o;
+}
+
+template <class TModuleLightWidget>
+TModuleLightWidget* createLightCentered(math::Vec pos, engine::Module* module, int firstLightId) {
+	return createLight<TModuleLightWidget>(pos, module, firstLightId);
+}
+
+template <class TMenuItem = ui::MenuItem>
+TMenuItem* createMenuItem(std::string text, std::string rightText = "") {
+	TMenuItem* o = new TMenuItem;
+	o->text = text;
+	o->rightText = rightText;
+	return o;
+}
+
+template <class TMenuLabel = ui::MenuLabel>
+TMenuLabel* createMenuLabel(std::string text) {
+	TMenuLabel* o = new TMenuLabel;
+	o->text = text;
+	return o;
+}
+
+template <class TModule, class TModuleWidget>
+plugin::Model* createModel(std::string slug) {
+	struct TModel : plugin::Model {
+		engine::Module* createModule() override {
+			engine::Module* m = new TModule;
+			m->model = this;
+			return m;
+		}
+		app::ModuleWidget* createModuleWidget() override {
+			TModule* m = new TModule;
+			m->model = this;
+			TModuleWidget* mw = new TModuleWidget(m);
+			mw->model = this;
+			return mw;
+		}
+	};
+	plugin::Model* o = new TModel;
+	o->slug = slug;
+	return o;
+}
+
+using namespace math;
+using namespace widget;
+using namespace ui;
+using namespace app;
+using plugin::Plugin;
+using plugin::Model;
+using namespace engine;
+using namespace componentlibrary;
+
+} // namespace rack
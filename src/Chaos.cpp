@@ -1,19 +1,67 @@
 #include "plugin.hpp"
+#include "chaos.hpp"
+#include "ode.hpp"
 #include "osdialog.h"
 #include <vector>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #define VOLT_MAX 10.f
 #define VOLT_FIVE 5.f
 #define POLY_CHANNELS 16
 #define PI 3.14159265359
 #define INV_SQRT2 0.7071067812
+#define NUM_CHAOS_CHANNELS 7
+#define DEFAULT_RATE_DIVIDER 4
+#define MAX_RATE_DIVIDER 64
+// Sample rate the control-rate dividers are counted at. Other rates scale the count so ticks come just as often.
+#define DIVIDER_SAMPLE_RATE 44100.f
+#define MAX_OVERSAMPLE 8
+#define DECIMATOR_QUALITY 8
+#define MIN_LINKS 2
+#define DEFAULT_LINKS 2
+// Slow normal-mode frequency in Hz of the double pendulum for small swings at the default ratio. Audio rate maps this to C4.
+#define SMALL_SWING_FREQ 0.5396f
+// Largest simulation step the audio-rate integrators stay stable at; pitch stops rising beyond it.
+#define MAX_AUDIO_DT 0.015f
+// Viscous damping coefficient at full dampen, per second of simulation time.
+#define MAX_DAMPING 2.f
+// Samples between pose snapshots sent to the display, and how many of them the trail keeps.
+#define POSE_INTERVAL 256
+#define TRAIL_LENGTH 256
+#define NUM_DIAGNOSTIC_CHANNELS 3
+// Lyapunov estimate: the shadow trajectory's starting distance, how far it may grow before renormalising, and how
+// many main-loop cycles the running estimate averages over.
+#define SHADOW_SEPARATION 1e-3f
+#define SHADOW_GROWTH 10.f
+#define LYAPUNOV_CYCLES 10.f
+#define SECTION_PULSE 1e-3f
+// Flip-time map: pixels per side, pixels per work chunk, coarsest refinement stride, the longest time followed (in
+// small-swing cycles), integrator steps per cycle, the most worker threads it takes, and the frames new link lengths
+// must hold before it starts again for them.
+#define MAP_SIZE 256
+#define MAP_CHUNK 16
+#define MAP_COARSEST 16
+#define MAP_MAX_CYCLES 16.f
+#define MAP_STEPS_PER_CYCLE 64
+#define MAP_THREADS 4
+#define MAP_SETTLE_FRAMES 15
+// Trajectory recorder: the most frames it takes per second, the longest take it has room for at the classic seven
+// channels, and the length it starts at.
+#define RECORD_RATE 1000.f
+#define MAX_RECORD_SECONDS 60
+#define DEFAULT_RECORD_SECONDS 10
+// How much further each voice's first link starts turned than the last voice's, so voices set alike drift apart.
+#define VOICE_SPREAD 1e-3f
 
 typedef unsigned int uint;
 typedef unsigned char uchar;
 
 struct ChaosModule : Module {
 	uint frameIndex = 0;
-	uint channelCount = 1;
+	uint channelCount = NUM_CHAOS_CHANNELS;
 	
 	dsp::SchmittTrigger kickTrigger;
 
@@ -29,10 +77,12 @@ struct ChaosModule : Module {
 		RATIO_IN,
 		DAMPING_IN,
 		KICK_TRIG_IN,
+		SCRUB_IN,
 		NUM_INPUTS
 	};
 	enum OutputIds {
 		POLY_CHAOS_OUTPUT,
+		SECTION_TRIG_OUTPUT,
 		NUM_OUTPUTS
 	};
 	enum LightIds {
@@ -49,6 +99,54 @@ struct ChaosModule : Module {
 		ClearVelocity
 	};
 
+	enum RateMode {
+		ControlRate,
+		AudioRate
+	};
+
+	enum SystemType {
+		PendulumSystem,
+		LorenzSystem,
+		RosslerSystem,
+		ChuaSystem,
+		ThomasSystem,
+		NUM_SYSTEMS
+	};
+
+	enum RecorderMode {
+		RecorderOff,
+		RecorderRecording,
+		RecorderPlaying
+	};
+
+	// Which crossings of a Poincaré section fire its trigger.
+	enum SectionDirection {
+		SectionUpward,
+		SectionDownward,
+		SectionBothWays
+	};
+
+	// The one channel each voice puts on POLY_CHAOS_OUTPUT in per-voice mode.
+	enum VoiceOutput {
+		VoiceTipX,
+		VoiceTipY,
+		VoiceTipDistance,
+		VoiceFirstAngle,
+		VoiceLastAngle
+	};
+
+	// Channel layout of POLY_CHAOS_OUTPUT.
+	enum OutputLayout {
+		// Tip x, tip y, link 1 angle, link 2 angle, link 1 velocity, link 2 velocity, tip distance.
+		// Attractors: x, y, z, their velocities, distance from the centre.
+		ClassicLayout,
+		// Every link's angle, then every link's angular velocity. Attractors: x, y, z and their velocities.
+		AngleLayout,
+		// x and y of every link's bob. Attractors: x, y, z.
+		PositionLayout
+	};
+
+	// One link of the chain: a massless rod with a point mass at its end.
 	struct Pendulum {
 		float theta = 0.0f;
 		float length = 0.5f;
@@ -58,228 +156,2503 @@ struct ChaosModule : Module {
 		float x, y = 0.f;
 	};
 
-	Pendulum p0;
-	Pendulum p1;
-	int frame = 0;
-	IntegrationMode integrationMode;
-	KickMode kickMode;
+	// Per-link constants of the chain's equations of motion. They depend only on the link lengths, so they are
+	// rebuilt when the ratio or link count changes rather than divided out on every derivative evaluation.
+	struct ChainConstants {
+		float length[MAX_LINKS];
+		float invLength[MAX_LINKS];
+		float invMass[MAX_LINKS];
+		// Viscous drag on each link's swing. Not part of set(); it follows the dampen control instead.
+		float damping = 0.f;
+
+		void set(const Pendulum* links, int n) {
+			for (int i = 0; i < n; i++) {
+				length[i] = links[i].length;
+				invLength[i] = 1.f / links[i].length;
+				invMass[i] = 1.f / links[i].mass;
+			}
+		}
+	};
+
+	// Cubic Hermite segment between two control ticks, evaluated for t in [0, 1).
+	struct HermiteSegment {
+		float c0 = 0.f;
+		float c1 = 0.f;
+		float c2 = 0.f;
+		float c3 = 0.f;
+
+		void set(float y0, float m0, float y1, float m1) {
+			c0 = y0;
+			c1 = m0;
+			c2 = -3.f * y0 - 2.f * m0 + 3.f * y1 - m1;
+			c3 = 2.f * y0 + m0 - 2.f * y1 + m1;
+		}
+
+		float eval(float t) const {
+			return ((c3 * t + c2) * t + c1) * t + c0;
+		}
+	};
+
+	// One SECTION_TRIG_OUTPUT channel: the section's signed distance and its rate at the last step, and the
+	// crossing waiting to be played out, in samples from now.
+	struct SectionTrigger {
+		float value = 0.f;
+		float rate = 0.f;
+		float pending = -1.f;
+		dsp::PulseGenerator pulse;
+	};
+
+	// Pose snapshot passed from the audio thread to the display. Attractors send one point, their projected state.
+	// The link lengths let the flip-time map follow the chain without reading it.
+	struct PendulumPose {
+		float x[MAX_LINKS];
+		float y[MAX_LINKS];
+		float length[MAX_LINKS];
+		float mass[MAX_LINKS];
+		int numLinks;
+		bool isChain;
+	};
+
+	// A kick asked for by the UI, passed the other way, from the widgets to the audio thread: a click on the flip-time
+	// map with its starting angles, or the menu's kick.
+	struct KickRequest {
+		bool toAngles;
+		float theta1;
+		float theta2;
+	};
+
+	// The chain as an ode system: link angles, then angular velocities.
+	// FAST_TRIG selects the polynomial sine and cosine used at audio rate.
+	template <bool FAST_TRIG>
+	struct Chain {
+		static const int MAX_SIZE = 2 * MAX_LINKS;
+		const ChaosModule* module;
+		int n;
+
+		int size() const {
+			return 2 * n;
+		}
+
+		void derivative(const float* x, float* dxdt) const {
+			float sinTheta[MAX_LINKS] = {};
+			float cosTheta[MAX_LINKS] = {};
+			for (int i = 0; i < n; i++) {
+				if (FAST_TRIG) {
+					fastSinCos(x[i], sinTheta[i], cosTheta[i]);
+				} else {
+					sinTheta[i] = std::sin(x[i]);
+					cosTheta[i] = std::cos(x[i]);
+				}
+				dxdt[i] = x[n + i];
+			}
+			module->Derivative(n, sinTheta, cosTheta, &x[n], &dxdt[n]);
+		}
+	};
+
+	// ChainConstants for four chains at once, one per lane.
+	struct VoiceConstants {
+		simd::float_4 length[MAX_LINKS];
+		simd::float_4 invLength[MAX_LINKS];
+		simd::float_4 invMass[MAX_LINKS];
+		simd::float_4 damping = 0.f;
+	};
+
+	// Four voices of the per-voice mode, one per lane. Each has its own lengths, timewarp and damping from its channel
+	// of the CV inputs; all of them share the link count and integrator.
+	struct VoiceBatch {
+		simd::float_4 theta[MAX_LINKS];
+		simd::float_4 vel[MAX_LINKS];
+		VoiceConstants constants;
+		// Clamped ratio and link count the constants were last built from.
+		simd::float_4 ratio = -1.f;
+		int numLinks = -1;
+		simd::float_4 shortestLength = 0.5f;
+		// Each lane's speed relative to the step the batch is integrated with.
+		simd::float_4 timescale = 1.f;
+		// Energy each lane is held at, and a lane mask of those holding it.
+		simd::float_4 targetEnergy = 0.f;
+		simd::float_4 holdEnergy = 0.f;
+	};
+
+	// Four chains on the same links, one per lane, for the flip-time map.
+	struct ChainBatch {
+		static const int MAX_SIZE = 2 * MAX_LINKS;
+		const ChainConstants* constants;
+		int n;
+
+		int size() const {
+			return 2 * n;
+		}
+
+		void derivative(const simd::float_4* x, simd::float_4* dxdt) const {
+			simd::float_4 sinTheta[MAX_LINKS] = {};
+			simd::float_4 cosTheta[MAX_LINKS] = {};
+			for (int i = 0; i < n; i++) {
+				fastSinCos(x[i], sinTheta[i], cosTheta[i]);
+				dxdt[i] = x[n + i];
+			}
+			chainDerivative(n, *constants, sinTheta, cosTheta, &x[n], &dxdt[n]);
+		}
+	};
+
+	// A VoiceBatch as an ode system: link angles, then angular velocities. Each lane's derivative is scaled by its
+	// timescale, which runs that voice faster or slower than the step the batch shares.
+	struct VoiceChain {
+		static const int MAX_SIZE = 2 * MAX_LINKS;
+		const VoiceBatch* batch;
+		int n;
+
+		int size() const {
+			return 2 * n;
+		}
+
+		void derivative(const simd::float_4* x, simd::float_4* dxdt) const {
+			simd::float_4 sinTheta[MAX_LINKS] = {};
+			simd::float_4 cosTheta[MAX_LINKS] = {};
+			for (int i = 0; i < n; i++) {
+				fastSinCos(x[i], sinTheta[i], cosTheta[i]);
+			}
+			chainDerivative(n, batch->constants, sinTheta, cosTheta, &x[n], &dxdt[n]);
+			for (int i = 0; i < n; i++) {
+				dxdt[i] = x[n + i] * batch->timescale;
+				dxdt[n + i] *= batch->timescale;
+			}
+		}
+	};
+
+	// The first lane of a VoiceChain on its own, for the shadow trajectory that follows the first voice.
+	struct FirstVoiceChain {
+		static const int MAX_SIZE = 2 * MAX_LINKS;
+		const VoiceBatch* batch;
+		int n;
+
+		int size() const {
+			return 2 * n;
+		}
+
+		void derivative(const float* x, float* dxdt) const {
+			simd::float_4 lanes[MAX_SIZE] = {};
+			simd::float_4 laneDxdt[MAX_SIZE] = {};
+			for (int i = 0; i < 2 * n; i++) {
+				lanes[i] = x[i];
+			}
+			const VoiceChain chain = {batch, n};
+			chain.derivative(lanes, laneDxdt);
+			for (int i = 0; i < 2 * n; i++) {
+				dxdt[i] = laneDxdt[i][0];
+			}
+		}
+	};
+
+	// The three-variable attractors. Each takes the ratio control (0.1 to 0.9) as its bifurcation parameter,
+	// with 0.5 giving the textbook value where there is one.
+
+	// Lorenz's convection model; ratio sweeps rho from 25 to 31.
+	struct Lorenz {
+		static const int MAX_SIZE = ATTRACTOR_SIZE;
+		float rho;
+
+		explicit Lorenz(float ratio) : rho(28.f + (ratio - 0.5f) * 7.5f) {}
+
+		int size() const {
+			return ATTRACTOR_SIZE;
+		}
+
+		void derivative(const float* x, float* dxdt) const {
+			dxdt[0] = 10.f * (x[1] - x[0]);
+			dxdt[1] = x[0] * (rho - x[2]) - x[1];
+			dxdt[2] = x[0] * x[1] - (8.f / 3.f) * x[2];
+		}
+	};
+
+	// Rössler's single-scroll attractor; ratio sweeps c from 4 to 7.4.
+	struct Rossler {
+		static const int MAX_SIZE = ATTRACTOR_SIZE;
+		float c;
+
+		explicit Rossler(float ratio) : c(5.7f + (ratio - 0.5f) * 4.25f) {}
+
+		int size() const {
+			return ATTRACTOR_SIZE;
+		}
+
+		void derivative(const float* x, float* dxdt) const {
+			dxdt[0] = -x[1] - x[2];
+			dxdt[1] = x[0] + 0.2f * x[1];
+			dxdt[2] = 0.2f + x[2] * (x[0] - c);
+		}
+	};
+
+	// Chua's circuit with its piecewise-linear diode, the double scroll; ratio sweeps alpha from 14.6 to 16.6.
+	struct Chua {
+		static const int MAX_SIZE = ATTRACTOR_SIZE;
+		float alpha;
+
+		explicit Chua(float ratio) : alpha(15.6f + (ratio - 0.5f) * 2.5f) {}
+
+		int size() const {
+			return ATTRACTOR_SIZE;
+		}
+
+		void derivative(const float* x, float* dxdt) const {
+			const float m0 = -1.143f;
+			const float m1 = -0.714f;
+			const float diode = m1 * x[0] + 0.5f * (m0 - m1) * (std::abs(x[0] + 1.f) - std::abs(x[0] - 1.f));
+			dxdt[0] = alpha * (x[1] - x[0] - diode);
+			dxdt[1] = x[0] - x[1] + x[2];
+			dxdt[2] = -28.f * x[1];
+		}
+	};
+
+	// Thomas' cyclically symmetric attractor; ratio sweeps the friction b from 0.1 to 0.26. Above about 0.21 it
+	// settles into cycles, so the middle of the range sits at 0.18 rather than the oft-quoted edge of chaos.
+	struct Thomas {
+		static const int MAX_SIZE = ATTRACTOR_SIZE;
+		float b;
+
+		explicit Thomas(float ratio) : b(0.18f + (ratio - 0.5f) * 0.2f) {}
+
+		int size() const {
+			return ATTRACTOR_SIZE;
+		}
+
+		void derivative(const float* x, float* dxdt) const {
+			float sinX, sinY, sinZ, unused;
+			fastSinCos(x[0], sinX, unused);
+			fastSinCos(x[1], sinY, unused);
+			fastSinCos(x[2], sinZ, unused);
+			dxdt[0] = sinY - b * x[0];
+			dxdt[1] = sinZ - b * x[1];
+			dxdt[2] = sinX - b * x[2];
+		}
+	};
+
+	// How to scale an attractor's variables to +/-5V, the frequency of its main loop (which audio rate maps to C4,
+	// as the pendulum's slow swing is), the largest step Euler survives across the ratio range with some margin, and
+	// which two variables the display plots.
+	struct AttractorInfo {
+		float center[ATTRACTOR_SIZE];
+		float scale[ATTRACTOR_SIZE];
+		float frequency;
+		float maxDt;
+		int axisX;
+		int axisY;
+	};
+
+	static const AttractorInfo& attractorInfo(SystemType type) {
+		static const AttractorInfo info[] = {
+			{{0.f, 0.f, 27.f}, {20.f, 27.f, 25.f}, 1.33f, 0.01f, 0, 2},
+			{{1.f, -1.5f, 11.5f}, {11.f, 10.f, 12.f}, 0.171f, 0.04f, 0, 1},
+			{{0.f, 0.f, 0.f}, {2.3f, 0.4f, 3.7f}, 0.683f, 0.008f, 0, 2},
+			{{0.f, 0.f, 0.f}, {4.5f, 4.5f, 4.5f}, 0.033f, 0.4f, 0, 1},
+		};
+		return info[type - LorenzSystem];
+	}
+
+	SystemType systemType = PendulumSystem;
+	SystemType lastSystemType = PendulumSystem;
+	Pendulum links[MAX_LINKS];
+	int numLinks = DEFAULT_LINKS;
+	// Just off the origin, from where every attractor here finds its way onto itself.
+	float attractor[ATTRACTOR_SIZE] = {0.1f, 0.f, 0.f};
+	// Clamped ratio control, read once per step.
+	float ratio = 0.5f;
+	float shortestLength = 0.5f;
+	ChainConstants chainConstants;
+	// Clamped ratio (0.1 to 0.9) and link count the lengths and chainConstants were last built from.
+	float lastLengthRatio = -1.f;
+	int lastNumLinks = -1;
+	// Samples per control tick at the engine's rate, its reciprocal and the tick's length in seconds, worked out by
+	// updateTickRate for the rateDivider and sample rate that follow.
+	int tickDivider = DEFAULT_RATE_DIVIDER;
+	float tickFraction = 1.f / DEFAULT_RATE_DIVIDER;
+	float tickSeconds = DEFAULT_RATE_DIVIDER / DIVIDER_SAMPLE_RATE;
+	int tickRateDivider = -1;
+	float tickSampleRate = 0.f;
+	// Control-rate step and the raw timewarp control, tick length and system it was worked out for.
+	float controlDt = 0.f;
+	float lastTimewarp = -1.f;
+	float lastTickSeconds = 0.f;
+	SystemType lastTickSystem = PendulumSystem;
+	// Opt-in from the menu: rescales the chain's velocities every step so its energy stays where the last kick, load or
+	// control change left it. Off by default, since the correction also bends the dynamics it keeps bounded.
+	bool energyHold = false;
+	// Energy the chain is held at, and whether one has been taken yet.
+	float targetEnergy = 0.f;
+	bool holdEnergy = false;
+	// Energy, angular momentum and Lyapunov channels appended to POLY_CHAOS_OUTPUT. None of them, nor the shadow
+	// trajectory behind the Lyapunov estimate, is computed while this is off.
+	bool diagnostics = false;
+	float energy = 0.f;
+	float momentum = 0.f;
+	float lyapunov = 0.f;
+	float shadow[2 * MAX_LINKS] = {};
+	bool shadowValid = false;
+	float shadowTime = 0.f;
+	// Poincaré sections, one trigger channel each. Only tracked while SECTION_TRIG_OUTPUT is patched or a CHAOS X listens.
+	SectionTrigger sections[MAX_SECTIONS];
+	int sectionCount = 0;
+	bool sectionsValid = false;
+	SectionDirection sectionDirection = SectionDirection::SectionUpward;
+	// Per-voice mode: a polyphonic timewarp, ratio or dampen cable runs one chain per channel (the pendulum only).
+	// The first voice is the chain the display, the flip map and patch storage see; links follows it every step.
+	VoiceBatch voices[POLY_CHANNELS / 4];
+	int numVoices = 1;
+	bool voicesSeeded = false;
+	VoiceOutput voiceOutput = VoiceOutput::VoiceTipX;
+	// Expander bus: events since the last message, and the link angles it carried, to spot flips against.
+	// busAttached is whether a CHAOS X sat beside the module last sample.
+	uint32_t busSectionEvents = 0;
+	bool busKicked = false;
+	bool busAttached = false;
+	float busTheta[MAX_LINKS] = {};
+	// Shows the flip-time map behind the chain; the map itself is computed by the display.
+	bool showMap = false;
+	// Trajectory recorder, LFO mode only. Each frame holds every output channel's value, then its rate per second.
+	// The buffer is allocated once, from the UI thread, the first time recording is armed; the audio thread only
+	// touches it while recording or playing. The menu never sets recorderMode itself: it stores the mode it wants in
+	// recorderRequest (-1 for none), which the audio thread takes between samples. Publishing the request with release
+	// and taking it with acquire makes a freshly allocated buffer visible before the first frame is written to it.
+	std::vector<float> recordBuffer;
+	std::atomic<RecorderMode> recorderMode{RecorderMode::RecorderOff};
+	std::atomic<int> recorderRequest{-1};
+	std::atomic<int> recordSeconds{DEFAULT_RECORD_SECONDS};
+	bool recordRestart = true;
+	int recordChannels = 0;
+	int recordAngleLink[POLY_CHANNELS] = {};
+	int recordCapacity = 0;
+	int recordWrite = 0;
+	int recordFrames = 0;
+	int recordTicksPerFrame = 1;
+	int recordTick = 0;
+	float recordTickSeconds = 0.f;
+	float recordFrameSeconds = 0.f;
+	float playPosition = 0.f;
+	// Curves between the frames at playIndex and the next, rebuilt only when playback moves on to another pair.
+	HermiteSegment playSegments[POLY_CHANNELS];
+	int playIndex = -1;
+	int frame = 0;
+	int poseFrame = 0;
+	// Single producer (audio thread), single consumer (PendulumWidget); neither side locks or allocates.
+	dsp::RingBuffer<PendulumPose, TRAIL_LENGTH> poseBuffer;
+	// Single producer (UI thread), single consumer (audio thread), drained at the start of each tick.
+	dsp::RingBuffer<KickRequest, 4> kickRequests;
+	// A link count picked from the menu, or -1. The UI thread only stores it; the audio thread takes it at the start of
+	// a tick, as it does the kicks, so the chain never changes size partway through a step.
+	std::atomic<int> linksRequest{-1};
+	// Likewise a system picked from the menu, or -1.
+	std::atomic<int> systemRequest{-1};
+	int rateDivider = DEFAULT_RATE_DIVIDER;
+	int oversample = 1;
+	IntegrationMode integrationMode;
+	KickMode kickMode;
+	RateMode rateMode;
+	OutputLayout outputLayout;
+
+	dsp::Decimator<2, DECIMATOR_QUALITY, simd::float_4> decimator2[POLY_CHANNELS / 4];
+	dsp::Decimator<4, DECIMATOR_QUALITY, simd::float_4> decimator4[POLY_CHANNELS / 4];
+	dsp::Decimator<8, DECIMATOR_QUALITY, simd::float_4> decimator8[POLY_CHANNELS / 4];
+
+	// Output values and their rates of change (per unit of simulation time) at the last tick.
+	float tickValue[POLY_CHANNELS] = {};
+	float tickRate[POLY_CHANNELS] = {};
+	int tickAngleLink[POLY_CHANNELS] = {};
+	HermiteSegment segments[POLY_CHANNELS];
+
+	// Angular accelerations of an n-link chain from the sines/cosines of its angles and its angular velocities.
+	// Each rod's tension is coupled only to its neighbours, so the rod constraints form a tridiagonal system that the
+	// Thomas algorithm solves in O(n); no mass matrix is built or inverted. With n = 2 this is the textbook double pendulum.
+	// Damping is a viscous drag on each link's angular velocity. Being part of the equations of motion rather than a
+	// per-step factor, its decay is the same whatever the step, divider, sample rate or integrator.
+	void Derivative(int n, const float* sinTheta, const float* cosTheta, const float* vel, float* out_acc) const {
+		chainDerivative(n, chainConstants, sinTheta, cosTheta, vel, out_acc);
+	}
+
+	// Derivative for any chain of links; T is float, or simd::float_4 for four sets of angles on the same links
+	// (ChainConstants) or on four sets of links (VoiceConstants).
+	template <typename T, class Constants>
+	static void chainDerivative(int n, const Constants& chain, const T* sinTheta, const T* cosTheta, const T* vel, T* out_acc) {
+		const float g = 9.81f;
+		T upper[MAX_LINKS];
+		T rhs[MAX_LINKS] = {};
+		T tension[MAX_LINKS];
+
+		// Forward sweep. Row i: (1/m[i] + 1/m[i-1]) T[i] - cos(a[i-1] - a[i]) / m[i-1] T[i-1] - cos(a[i] - a[i+1]) / m[i] T[i+1] = l[i] w[i]^2,
+		// plus gravity on the first row. The pivot doesn't move, which is a link above the chain with no inverse mass.
+		T invMassAbove = 0.f;
+		T lowerTimesUpper = 0.f;
+		T lowerTimesRhs = 0.f;
+		for (int i = 0; i < n; i++) {
+			const T invMass = chain.invMass[i];
+			T b = chain.length[i] * vel[i] * vel[i];
+			if (i == 0)
+				b += g * cosTheta[0];
+			const T denominator = invMass + invMassAbove - lowerTimesUpper;
+			T cosBelow = 0.f;
+			if (i + 1 < n)
+				cosBelow = cosTheta[i] * cosTheta[i + 1] + sinTheta[i] * sinTheta[i + 1];
+			upper[i] = -cosBelow * invMass / denominator;
+			rhs[i] = (b - lowerTimesRhs) / denominator;
+			// The next row's sub-diagonal is this row's coupling seen from below.
+			const T lowerBelow = -cosBelow * invMass;
+			lowerTimesUpper = lowerBelow * upper[i];
+			lowerTimesRhs = lowerBelow * rhs[i];
+			invMassAbove = invMass;
+		}
+
+		tension[n - 1] = rhs[n - 1];
+		for (int i = n - 2; i >= 0; i--) {
+			tension[i] = rhs[i] - upper[i] * tension[i + 1];
+		}
+
+		// Tangential acceleration of each bob relative to the one above it.
+		for (int i = 0; i < n; i++) {
+			T tangential = 0.f;
+			if (i + 1 < n)
+				tangential += tension[i + 1] * (sinTheta[i + 1] * cosTheta[i] - cosTheta[i + 1] * sinTheta[i]) * chain.invMass[i];
+			if (i > 0)
+				tangential += tension[i - 1] * (sinTheta[i - 1] * cosTheta[i] - cosTheta[i - 1] * sinTheta[i]) * chain.invMass[i - 1];
+			else
+				tangential -= g * sinTheta[0];
+			out_acc[i] = tangential * chain.invLength[i] - chain.damping * vel[i];
+		}
+	}
+
+	// Polynomial sine and cosine for the audio-rate path, accurate to ~4e-6 after folding into [-PI/2, PI/2].
+	static void fastSinCos(float theta, float& out_sin, float& out_cos) {
+		float x = theta - (float)(PI * 2) * std::round(theta * (float)(0.5 / PI));
+		float sign = 1.f;
+		if (x > (float)(PI * 0.5)) {
+			x = (float)PI - x;
+			sign = -1.f;
+		} else if (x < (float)(-PI * 0.5)) {
+			x = (float)(-PI) - x;
+			sign = -1.f;
+		}
+		const float x2 = x * x;
+		out_sin = x * (1.f + x2 * (-1.f / 6.f + x2 * (1.f / 120.f + x2 * (-1.f / 5040.f + x2 * (1.f / 362880.f)))));
+		out_cos = sign * (1.f + x2 * (-0.5f + x2 * (1.f / 24.f + x2 * (-1.f / 720.f + x2 * (1.f / 40320.f + x2 * (-1.f / 3628800.f))))));
+	}
+
+	// The same four lanes at a time, folding with masks instead of branches.
+	static void fastSinCos(simd::float_4 theta, simd::float_4& out_sin, simd::float_4& out_cos) {
+		simd::float_4 x = theta - (float)(PI * 2) * simd::round(theta * (float)(0.5 / PI));
+		const simd::float_4 fold = simd::ifelse(x > (float)(PI * 0.5), (float)PI, simd::ifelse(x < (float)(-PI * 0.5), (float)(-PI), 0.f));
+		const simd::float_4 folded = (fold != 0.f);
+		x = simd::ifelse(folded, fold - x, x);
+		const simd::float_4 sign = simd::ifelse(folded, -1.f, 1.f);
+		const simd::float_4 x2 = x * x;
+		out_sin = x * (1.f + x2 * (-1.f / 6.f + x2 * (1.f / 120.f + x2 * (-1.f / 5040.f + x2 * (1.f / 362880.f)))));
+		out_cos = sign * (1.f + x2 * (-0.5f + x2 * (1.f / 24.f + x2 * (-1.f / 720.f + x2 * (1.f / 40320.f + x2 * (-1.f / 3628800.f))))));
+	}
+
+	ChaosModule() {
+		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+		configParam(GRAVITY_PARAM, 0.01f, 6.f, 1.0f, "timewarp", "x");
+		configParam(LENGTH_RATIO_PARAM, 0.1f, 1.0f - 0.1f, 0.5f, "ratio", "");
+		configParam(DAMPING_PARAM, 0.0f, 1.f, 0.0f, "dampen", "%", 0.f, 100.f);
+		configParam(KICK_PARAM, 0.f, 1.f, 0.f);
+		integrationMode = IntegrationMode::RK4;
+		kickMode = KickMode::ClearVelocity;
+		rateMode = RateMode::ControlRate;
+		outputLayout = OutputLayout::ClassicLayout;
+	}
+
+	void onReset() override {
+		Module::onReset();
+		for (int i = 0; i < MAX_LINKS; i++) {
+			links[i] = Pendulum{};
+		}
+		numLinks = DEFAULT_LINKS;
+		// The lengths were just cleared, so the next tick rebuilds them whatever the ratio.
+		lastNumLinks = -1;
+		systemType = PendulumSystem;
+		rateDivider = DEFAULT_RATE_DIVIDER;
+		oversample = 1;
+		integrationMode = IntegrationMode::RK4;
+		kickMode = KickMode::ClearVelocity;
+		rateMode = RateMode::ControlRate;
+		outputLayout = OutputLayout::ClassicLayout;
+		sectionDirection = SectionDirection::SectionUpward;
+		voiceOutput = VoiceOutput::VoiceTipX;
+		restartTracking();
+		voicesSeeded = false;
+	}
+
+	void onRandomize() override {
+		Module::onRandomize();
+		for (int i = 0; i < MAX_LINKS; i++) {
+			links[i].theta = random::uniform() * PI * 2.f;
+			links[i].vel = (random::uniform() - 0.5f) * 5.f;
+		}
+		restartTracking();
+		voicesSeeded = false;
+		if (systemType != PendulumSystem)
+			kickAttractor();
+	}
+
+	json_t *dataToJson() override {
+		json_t *obj = json_object();
+		json_object_set_new(obj, "mode", json_integer(integrationMode));
+		json_object_set_new(obj, "kick_mode", json_integer(kickMode));
+		json_object_set_new(obj, "rate_divider", json_integer(rateDivider));
+		json_object_set_new(obj, "rate_mode", json_integer(rateMode));
+		json_object_set_new(obj, "oversample", json_integer(oversample));
+		json_object_set_new(obj, "links", json_integer(numLinks));
+		json_object_set_new(obj, "output_layout", json_integer(outputLayout));
+		json_object_set_new(obj, "system", json_integer(systemType));
+		json_object_set_new(obj, "diagnostics", json_boolean(diagnostics));
+		json_object_set_new(obj, "hold_energy", json_boolean(energyHold));
+		json_object_set_new(obj, "section_direction", json_integer(sectionDirection));
+		json_object_set_new(obj, "display_map", json_boolean(showMap));
+		json_object_set_new(obj, "record_seconds", json_integer(recordSeconds));
+		json_object_set_new(obj, "voice_output", json_integer(voiceOutput));
+		for (int i = 0; i < numLinks; i++) {
+			json_object_set_new(obj, string::f("p%d_theta", i).c_str(), json_real(links[i].theta));
+			json_object_set_new(obj, string::f("p%d_vel", i).c_str(), json_real(links[i].vel));
+		}
+		for (int i = 0; i < ATTRACTOR_SIZE; i++) {
+			json_object_set_new(obj, string::f("attractor%d", i).c_str(), json_real(attractor[i]));
+		}
+		return obj;
+	}
+
+	void dataFromJson(json_t *rootJ) override {
+		json_t* modeJ = json_object_get(rootJ, "mode");
+		if (modeJ) integrationMode = (IntegrationMode)json_integer_value(modeJ);
+
+		json_t* kickmodeJ = json_object_get(rootJ, "kick_mode");
+		if (kickmodeJ) kickMode = (KickMode)json_integer_value(kickmodeJ);
+
+		json_t* rateDividerJ = json_object_get(rootJ, "rate_divider");
+		if (rateDividerJ) rateDivider = clamp((int)json_integer_value(rateDividerJ), 1, MAX_RATE_DIVIDER);
+
+		json_t* rateModeJ = json_object_get(rootJ, "rate_mode");
+		if (rateModeJ) rateMode = (RateMode)json_integer_value(rateModeJ);
+
+		json_t* oversampleJ = json_object_get(rootJ, "oversample");
+		if (oversampleJ) oversample = clamp((int)json_integer_value(oversampleJ), 1, MAX_OVERSAMPLE);
+
+		json_t* linksJ = json_object_get(rootJ, "links");
+		if (linksJ) numLinks = clamp((int)json_integer_value(linksJ), MIN_LINKS, MAX_LINKS);
+
+		json_t* layoutJ = json_object_get(rootJ, "output_layout");
+		if (layoutJ) outputLayout = (OutputLayout)json_integer_value(layoutJ);
+
+		json_t* systemJ = json_object_get(rootJ, "system");
+		if (systemJ) systemType = (SystemType)clamp((int)json_integer_value(systemJ), 0, NUM_SYSTEMS - 1);
+
+		json_t* diagnosticsJ = json_object_get(rootJ, "diagnostics");
+		if (diagnosticsJ) diagnostics = json_is_true(diagnosticsJ);
+		json_t* holdEnergyJ = json_object_get(rootJ, "hold_energy");
+		if (holdEnergyJ) energyHold = json_is_true(holdEnergyJ);
+
+		json_t* sectionDirectionJ = json_object_get(rootJ, "section_direction");
+		if (sectionDirectionJ) sectionDirection = (SectionDirection)json_integer_value(sectionDirectionJ);
+
+		json_t* showMapJ = json_object_get(rootJ, "display_map");
+		if (showMapJ) showMap = json_is_true(showMapJ);
+
+		json_t* recordSecondsJ = json_object_get(rootJ, "record_seconds");
+		if (recordSecondsJ) recordSeconds = clamp((int)json_integer_value(recordSecondsJ), 1, MAX_RECORD_SECONDS);
+
+		json_t* voiceOutputJ = json_object_get(rootJ, "voice_output");
+		if (voiceOutputJ) voiceOutput = (VoiceOutput)clamp((int)json_integer_value(voiceOutputJ), 0, VoiceLastAngle);
+
+		for (int i = 0; i < ATTRACTOR_SIZE; i++) {
+			json_t* attractorJ = json_object_get(rootJ, string::f("attractor%d", i).c_str());
+			if (attractorJ) attractor[i] = (float)json_real_value(attractorJ);
+		}
+		lastSystemType = systemType;
+
+		for (int i = 0; i < MAX_LINKS; i++) {
+			json_t* thetaJ = json_object_get(rootJ, string::f("p%d_theta", i).c_str());
+			if (thetaJ) links[i].theta = (float)json_real_value(thetaJ);
+
+			json_t* velJ = json_object_get(rootJ, string::f("p%d_vel", i).c_str());
+			if (velJ) links[i].vel = (float)json_real_value(velJ);
+		}
+		restartTracking();
+		voicesSeeded = false;
+	}
+
+	float pixelToVoltage(uchar pixel) {
+		return ((float)pixel / 255) * VOLT_MAX;
+	}
+
+	void kick() {
+		busKicked = true;
+		if (systemType == PendulumSystem)
+			kickPendulums();
+		else
+			kickAttractor();
+	}
+
+	// Restarts the attractor from a random point near its centre. Much further out, Chua's circuit can escape.
+	void kickAttractor() {
+		const AttractorInfo& info = attractorInfo(systemType);
+		for (int i = 0; i < ATTRACTOR_SIZE; i++) {
+			attractor[i] = info.center[i] + (random::uniform() - 0.5f) * 0.5f * info.scale[i];
+		}
+		restartTracking();
+	}
+
+	// The state just jumped: the held energy, the Lyapunov shadow and the section crossings all start over from it.
+	void restartTracking() {
+		holdEnergy = false;
+		shadowValid = false;
+		sectionsValid = false;
+	}
+
+	// Drops the chain from rest with the first link at theta1 and the rest lined up at theta2, as the map does.
+	// Audio thread only; the display asks for it through kickRequests.
+	void kickTo(float theta1, float theta2) {
+		for (int i = 0; i < MAX_LINKS; i++) {
+			links[i].theta = (i == 0) ? theta1 : theta2;
+			links[i].vel = 0.f;
+			links[i].acc = 0.f;
+		}
+		restartTracking();
+		voicesSeeded = false;
+		busKicked = true;
+	}
+
+	void kickPendulums() {
+		links[0].theta = (PI*0.5f) + (random::uniform() * PI);
+		for (int i = 1; i < MAX_LINKS; i++) {
+			links[i].theta = 0.0f + (random::uniform() * PI * 2);
+		}
+		if (kickMode == KickMode::ClearVelocity) {
+			for (int i = 0; i < MAX_LINKS; i++) {
+				links[i].vel = 0;
+				links[i].acc = 0;
+			}
+		}
+		restartTracking();
+		if (numVoices > 1)
+			kickVoices();
+	}
+
+	// The first voice follows the chain just kicked; every other voice gets a random start of its own.
+	void kickVoices() {
+		for (int v = 0; v < POLY_CHANNELS; v++) {
+			VoiceBatch& batch = voices[v / 4];
+			const int lane = v % 4;
+			for (int i = 0; i < MAX_LINKS; i++) {
+				if (v == 0)
+					batch.theta[i][lane] = links[i].theta;
+				else if (i == 0)
+					batch.theta[i][lane] = (PI*0.5f) + (random::uniform() * PI);
+				else
+					batch.theta[i][lane] = random::uniform() * PI * 2;
+				if (v == 0)
+					batch.vel[i][lane] = links[i].vel;
+				else if (kickMode == KickMode::ClearVelocity)
+					batch.vel[i][lane] = 0.f;
+			}
+			batch.holdEnergy[lane] = 0.f;
+		}
+	}
+
+	// Starts voices first onwards from the chain's state, each with its first link turned VOICE_SPREAD further.
+	void seedVoices(int first) {
+		for (int v = first; v < POLY_CHANNELS; v++) {
+			VoiceBatch& batch = voices[v / 4];
+			const int lane = v % 4;
+			for (int i = 0; i < MAX_LINKS; i++) {
+				batch.theta[i][lane] = links[i].theta + ((i == 0) ? v * VOICE_SPREAD : 0.f);
+				batch.vel[i][lane] = links[i].vel;
+			}
+			batch.holdEnergy[lane] = 0.f;
+		}
+	}
+
+	// Voices follow the most channels on the timewarp, ratio and dampen inputs. Voices that appear start from the
+	// first; leaving per-voice mode hands the chain back where the first voice left it.
+	void updateVoiceCount() {
+		int count = 1;
+		if (systemType == PendulumSystem) {
+			count = std::max(count, inputs[GRAVITY_IN].getChannels());
+			count = std::max(count, inputs[RATIO_IN].getChannels());
+			count = std::max(count, inputs[DAMPING_IN].getChannels());
+		}
+		if (count > 1 && !voicesSeeded) {
+			seedVoices(0);
+			voicesSeeded = true;
+			restartTracking();
+		} else if (count > numVoices) {
+			seedVoices(numVoices);
+		} else if (count == 1 && numVoices > 1) {
+			voicesSeeded = false;
+			restartTracking();
+		}
+		numVoices = count;
+	}
+
+	// An input's voltage for the single chain or attractor: the sum of its channels, or the first voice's channel.
+	float controlVoltage(int input) {
+		return (numVoices > 1) ? inputs[input].getVoltage(0) : inputs[input].getVoltageSum();
+	}
+
+	// Wraps an angle output back into +/-5V after interpolating across the seam.
+	float wrapAngleVoltage(float v) {
+		return v - 2.f * VOLT_FIVE * std::floor((v + VOLT_FIVE) / (2.f * VOLT_FIVE));
+	}
+
+	// Reads the ratio, dampen and kick controls shared by both rate modes and returns the damping coefficient.
+	// The link lengths and chain constants are only rebuilt when the ratio or link count actually changes.
+	float updateControls() {
+		float length_ratio = params[LENGTH_RATIO_PARAM].getValue() + (controlVoltage(RATIO_IN) / VOLT_MAX);
+		length_ratio = clamp(length_ratio, 0.1f , 0.9f);
+		const float damping_in = clamp(params[DAMPING_PARAM].getValue() + controlVoltage(DAMPING_IN) / VOLT_MAX, 0.f, 1.f);
+		// Squared, so the slow decays near zero get most of the knob's travel.
+		const float damping = MAX_DAMPING * damping_in * damping_in;
+		chainConstants.damping = damping;
+
+		if (kickTrigger.process(inputs[KICK_TRIG_IN].getVoltage() + params[KICK_PARAM].getValue()))
+		{
+			kick();
+		}
+		while (!kickRequests.empty()) {
+			const KickRequest request = kickRequests.shift();
+			if (request.toAngles)
+				kickTo(request.theta1, request.theta2);
+			else
+				kick();
+		}
+		// Requests are looked at before being taken: the exchange is a locked instruction, and at audio rate this runs
+		// every sample.
+		if (linksRequest.load(std::memory_order_relaxed) >= 0)
+			numLinks = linksRequest.exchange(-1);
+		if (systemRequest.load(std::memory_order_relaxed) >= 0)
+			systemType = (SystemType)systemRequest.exchange(-1);
+		ratio = length_ratio;
+
+		// A newly selected attractor starts on itself rather than wherever the last one left off.
+		if (systemType != lastSystemType) {
+			lastSystemType = systemType;
+			restartTracking();
+			if (systemType != PendulumSystem)
+				kickAttractor();
+		}
+
+		// New lengths change the chain's energy, so it takes a fresh target.
+		if (length_ratio != lastLengthRatio || numLinks != lastNumLinks) {
+			lastLengthRatio = length_ratio;
+			lastNumLinks = numLinks;
+			updateLengths(length_ratio);
+			restartTracking();
+		}
+		return damping;
+	}
+
+	// Link lengths taper linearly from 1 to (1 - ratio) / ratio and are normalised to sum to 1, which for two links
+	// is ratio and 1 - ratio. A linear taper keeps the shortest link (and so the stiffest mode) sane at eight links.
+	void updateLengths(float length_ratio) {
+		const float taper = (1.0f - length_ratio) / length_ratio;
+		float totalLength = 0.f;
+		for (int i = 0; i < numLinks; i++) {
+			links[i].length = 1.f + (taper - 1.f) * i / (numLinks - 1);
+			totalLength += links[i].length;
+		}
+		shortestLength = 1.f;
+		for (int i = 0; i < numLinks; i++) {
+			links[i].length /= totalLength;
+			links[i].mass = links[i].length * 10.f;
+			shortestLength = std::min(shortestLength, links[i].length);
+		}
+		chainConstants.set(links, numLinks);
+	}
+
+	// Bob positions relative to the pivot, with y pointing down.
+	void updatePositions(int n, const float* sinTheta, const float* cosTheta) {
+		float x = 0.f;
+		float y = 0.f;
+		for (int i = 0; i < n; i++) {
+			x += links[i].length * sinTheta[i];
+			y += links[i].length * cosTheta[i];
+			links[i].x = x;
+			links[i].y = y;
+		}
+	}
+
+	// Kinetic and potential energy of the chain, and for the diagnostic channels its angular momentum. Needs
+	// updatePositions first.
+	void measureEnergy(int n, const float* sinTheta, const float* cosTheta, float& kinetic, float& potential, float& angular) {
+		const float g = 9.81f;
+		kinetic = 0.f;
+		potential = 0.f;
+		angular = 0.f;
+		float vx = 0.f;
+		float vy = 0.f;
+		for (int i = 0; i < n; i++) {
+			vx += links[i].length * cosTheta[i] * links[i].vel;
+			vy -= links[i].length * sinTheta[i] * links[i].vel;
+			kinetic += 0.5f * links[i].mass * (vx * vx + vy * vy);
+			potential -= links[i].mass * g * links[i].y;
+			if (diagnostics)
+				angular += links[i].mass * (links[i].x * vy - links[i].y * vx);
+		}
+	}
+
+	// The energy is only needed for the hold, the diagnostic channels and a CHAOS X.
+	bool measuresEnergy() const {
+		return energyHold || diagnostics || busAttached;
+	}
+
+	// With energyHold on, rescales the angular velocities so kinetic plus potential energy stays at the target and
+	// returns the factor; explicit integrators slowly pump energy in, over a long run enough to blow a long chain
+	// apart. Also measures the energy, and for the diagnostic channels the angular momentum, when anything reads them.
+	// Needs updatePositions first.
+	float conserveEnergy(int n, const float* sinTheta, const float* cosTheta, float damping) {
+		if (!measuresEnergy()) {
+			holdEnergy = false;
+			return 1.f;
+		}
+		float kinetic;
+		float potential;
+		float angular;
+		measureEnergy(n, sinTheta, cosTheta, kinetic, potential, angular);
+
+		float scale = 1.f;
+		// Dampening is meant to drain energy, so nothing is held while it's on.
+		if (damping > 0.f || !energyHold) {
+			holdEnergy = false;
+		} else if (!holdEnergy) {
+			targetEnergy = kinetic + potential;
+			holdEnergy = true;
+		} else if (kinetic > 1e-2f && targetEnergy > potential) {
+			scale = std::sqrt((targetEnergy - potential) / kinetic);
+			for (int i = 0; i < n; i++) {
+				links[i].vel *= scale;
+			}
+		}
+
+		energy = kinetic * scale * scale + potential;
+		if (diagnostics)
+			momentum = angular * scale;
+		return scale;
+	}
+
+	// Poincaré sections of the chain as signed distances with their rates: the first and last links through the
+	// vertical, the tip across the vertical axis and the tip through the pivot's height. The first two are angles.
+	// Each rises as the chain moves right, or for the last, up.
+	int chainSections(int n, const float* sinTheta, const float* cosTheta, float* value, float* rate) const {
+		float tipRateX = 0.f;
+		float tipRateY = 0.f;
+		for (int i = 0; i < n; i++) {
+			tipRateX += links[i].length * cosTheta[i] * links[i].vel;
+			tipRateY -= links[i].length * sinTheta[i] * links[i].vel;
+		}
+		value[0] = links[0].theta;
+		rate[0] = links[0].vel;
+		value[1] = links[n - 1].theta;
+		rate[1] = links[n - 1].vel;
+		value[2] = links[n - 1].x;
+		rate[2] = tipRateX;
+		value[3] = -links[n - 1].y;
+		rate[3] = -tipRateY;
+		return 4;
+	}
+
+	// An attractor's sections are the planes through its centre across each axis.
+	int attractorSections(const float* x, const float* dxdt, float* value, float* rate) const {
+		const AttractorInfo& info = attractorInfo(systemType);
+		for (int i = 0; i < ATTRACTOR_SIZE; i++) {
+			value[i] = x[i] - info.center[i];
+			rate[i] = dxdt[i];
+		}
+		return ATTRACTOR_SIZE;
+	}
+
+	// Sections are tracked for SECTION_TRIG_OUTPUT and for a CHAOS X, which has a jack for them too.
+	bool tracksSections() {
+		return outputs[SECTION_TRIG_OUTPUT].isConnected() || busAttached;
+	}
+
+	// Compares the section values with the last step's, dt earlier, and schedules a trigger for each crossing. The
+	// crossing is located on the cubic Hermite curve through both ends and played out `delay` samples from now plus
+	// its fraction of `span`, the samples that step covers. The first `angles` sections are compared across the seam.
+	void detectSections(int count, int angles, const float* value, const float* rate, float dt, float delay, float span) {
+		if (!sectionsValid || count != sectionCount) {
+			for (int i = 0; i < count; i++) {
+				sections[i].value = value[i];
+				sections[i].rate = rate[i];
+			}
+			sectionCount = count;
+			sectionsValid = true;
+			return;
+		}
+		for (int i = 0; i < count; i++) {
+			SectionTrigger& section = sections[i];
+			float end = value[i];
+			if (i < angles) {
+				const float delta = end - section.value;
+				end = section.value + delta - (float)(PI * 2) * std::round(delta * (float)(0.5 / PI));
+			}
+			const bool rising = section.value < 0.f && end >= 0.f;
+			const bool falling = section.value > 0.f && end <= 0.f;
+			const bool fire = (rising && sectionDirection != SectionDirection::SectionDownward)
+				|| (falling && sectionDirection != SectionDirection::SectionUpward);
+			if (fire && section.pending < 0.f) {
+				HermiteSegment curve;
+				curve.set(section.value, section.rate * dt, end, rate[i] * dt);
+				float before = 0.f;
+				float after = 1.f;
+				for (int k = 0; k < 12; k++) {
+					const float t = 0.5f * (before + after);
+					if ((curve.eval(t) < 0.f) == rising)
+						before = t;
+					else
+						after = t;
+				}
+				section.pending = delay + 0.5f * (before + after) * span;
+			}
+			section.value = value[i];
+			section.rate = rate[i];
+		}
+	}
+
+	// Plays the section triggers out, one per sample. A crossing inside this sample opens its pulse at the fraction of
+	// the sample left after it, so the edge keeps its sub-sample timing rather than snapping to the next sample.
+	void processSections(float sampleTime) {
+		for (int i = 0; i < sectionCount; i++) {
+			SectionTrigger& section = sections[i];
+			float v = section.pulse.process(sampleTime) ? (float)VOLT_MAX : 0.f;
+			if (section.pending >= 1.f) {
+				section.pending -= 1.f;
+			} else if (section.pending >= 0.f) {
+				v = std::max(v, VOLT_MAX * (1.f - section.pending));
+				section.pulse.trigger(SECTION_PULSE);
+				section.pending = -1.f;
+				busSectionEvents |= 1u << i;
+			}
+			outputs[SECTION_TRIG_OUTPUT].setVoltage(v, i);
+		}
+		outputs[SECTION_TRIG_OUTPUT].setChannels(sectionCount);
+	}
+
+	// Steps the shadow trajectory by dt from wherever it is, first placing it SHADOW_SEPARATION from x (the state
+	// before the step) if it has been reset. `mode` should be the integrator the main trajectory just used.
+	template <class System>
+	void stepShadow(const System& system, float dt, IntegrationMode mode, bool secondOrder, const float* x) {
+		const int size = system.size();
+		if (!shadowValid) {
+			const float offset = SHADOW_SEPARATION / std::sqrt((float)size);
+			for (int i = 0; i < size; i++) {
+				shadow[i] = x[i] + offset;
+			}
+			shadowTime = 0.f;
+			shadowValid = true;
+		}
+		if (mode == IntegrationMode::RK4)
+			ode::stepRK4(system, dt, shadow);
+		else if (secondOrder)
+			ode::stepSymplecticEuler(system, dt, shadow);
+		else
+			ode::stepEuler(system, dt, shadow);
+	}
+
+	// Folds the shadow's separation from x (the state after the step) into the finite-time Lyapunov estimate.
+	// The first `angles` variables are angles compared across the +/-PI seam, and the velocities after them get
+	// velocityScale, the energy correction the main trajectory just had. The shadow is pulled back to
+	// SHADOW_SEPARATION once it has grown SHADOW_GROWTH-fold or a main-loop cycle has passed, which keeps the
+	// logarithm well clear of float rounding.
+	void updateLyapunov(const float* x, int size, int angles, float dt, float velocityScale) {
+		float offset[2 * MAX_LINKS];
+		float distance = 0.f;
+		for (int i = 0; i < size; i++) {
+			if (angles > 0 && i >= angles && i < 2 * angles)
+				shadow[i] *= velocityScale;
+			offset[i] = shadow[i] - x[i];
+			if (i < angles) {
+				// Keeps the shadow's angles wrapped alongside the main ones, as the fast sine needs.
+				offset[i] -= (float)(PI * 2) * std::round(offset[i] * (float)(0.5 / PI));
+				shadow[i] = x[i] + offset[i];
+			}
+			distance += offset[i] * offset[i];
+		}
+		distance = std::sqrt(distance);
+		shadowTime += dt;
+
+		const float cycle = 1.f / systemFrequency();
+		if (distance < SHADOW_SEPARATION * SHADOW_GROWTH && shadowTime < cycle)
+			return;
+		if (!(distance > 0.f) || !std::isfinite(distance)) {
+			shadowValid = false;
+			return;
+		}
+		const float exponent = std::log(distance / SHADOW_SEPARATION) / shadowTime;
+		lyapunov += (exponent - lyapunov) * std::min(1.f, shadowTime / (cycle * LYAPUNOV_CYCLES));
+		for (int i = 0; i < size; i++) {
+			shadow[i] = x[i] + offset[i] * (SHADOW_SEPARATION / distance);
+		}
+		shadowTime = 0.f;
+	}
+
+	// Appends the diagnostic channels after the layout's, as many as fit. Energy and angular momentum are scaled by
+	// the chain's total mass, gravity and unit length; the Lyapunov exponent is in nats per main-loop cycle.
+	int appendDiagnostics(int channels, float* value, float* rate, int* angleLink) {
+		if (!diagnostics)
+			return channels;
+		const float g = 9.81f;
+		const float totalMass = 10.f;
+		const float diagnostic[NUM_DIAGNOSTIC_CHANNELS] = {
+			energy / (totalMass * g) * VOLT_FIVE,
+			momentum / (totalMass * std::sqrt(g)) * VOLT_FIVE,
+			clamp(lyapunov / systemFrequency(), -(float)VOLT_MAX, (float)VOLT_MAX)
+		};
+		for (int i = 0; i < NUM_DIAGNOSTIC_CHANNELS && channels < POLY_CHANNELS; i++) {
+			value[channels] = diagnostic[i];
+			if (rate)
+				rate[channels] = 0.f;
+			if (angleLink)
+				angleLink[channels] = -1;
+			channels++;
+		}
+		return channels;
+	}
+
+	// Fills the poly output channels for the current state in the selected layout and returns the channel count.
+	// When rate is given it receives each channel's rate of change per unit of simulation time, and angleLink the link
+	// whose angle a channel carries (-1 otherwise) so angle channels can be interpolated across the +/-PI seam.
+	int computeOutputs(int n, const float* sinTheta, const float* cosTheta, float* value, float* rate, int* angleLink) {
+		if (outputLayout == OutputLayout::AngleLayout) {
+			for (int i = 0; i < n; i++) {
+				value[i] = (links[i].theta / PI) * VOLT_FIVE;
+				value[n + i] = links[i].vel;
+				if (rate) {
+					rate[i] = (links[i].vel / PI) * VOLT_FIVE;
+					rate[n + i] = links[i].acc;
+					angleLink[i] = i;
+					angleLink[n + i] = -1;
+				}
+			}
+			return 2 * n;
+		}
+
+		if (outputLayout == OutputLayout::PositionLayout) {
+			float dx = 0.f;
+			float dy = 0.f;
+			for (int i = 0; i < n; i++) {
+				value[2 * i] = links[i].x * VOLT_FIVE;
+				value[2 * i + 1] = links[i].y * -1.f * VOLT_FIVE;
+				if (rate) {
+					dx += links[i].length * cosTheta[i] * links[i].vel;
+					dy -= links[i].length * sinTheta[i] * links[i].vel;
+					rate[2 * i] = dx * VOLT_FIVE;
+					rate[2 * i + 1] = dy * -1.f * VOLT_FIVE;
+					angleLink[2 * i] = -1;
+					angleLink[2 * i + 1] = -1;
+				}
+			}
+			return 2 * n;
+		}
+
+		const Pendulum& tip = links[n - 1];
+		// distance from center
+		const float dist = std::sqrt(tip.x * tip.x + tip.y * tip.y);
+		value[0] = tip.x * VOLT_FIVE;
+		value[1] = tip.y * -1.f * VOLT_FIVE;
+		value[2] = (links[0].theta / PI) * VOLT_FIVE;
+		value[3] = (links[1].theta / PI) * VOLT_FIVE;
+		value[4] = links[0].vel;
+		value[5] = links[1].vel;
+		value[6] = dist * VOLT_MAX;
+		if (rate) {
+			float dx = 0.f;
+			float dy = 0.f;
+			for (int i = 0; i < n; i++) {
+				dx += links[i].length * cosTheta[i] * links[i].vel;
+				dy -= links[i].length * sinTheta[i] * links[i].vel;
+			}
+			const float ddist = (dist > 1e-6f) ? (tip.x * dx + tip.y * dy) / dist : 0.f;
+			rate[0] = dx * VOLT_FIVE;
+			rate[1] = dy * -1.f * VOLT_FIVE;
+			rate[2] = (links[0].vel / PI) * VOLT_FIVE;
+			rate[3] = (links[1].vel / PI) * VOLT_FIVE;
+			rate[4] = links[0].acc;
+			rate[5] = links[1].acc;
+			rate[6] = ddist * VOLT_MAX;
+			for (int i = 0; i < NUM_CHAOS_CHANNELS; i++) {
+				angleLink[i] = -1;
+			}
+			angleLink[2] = 0;
+			angleLink[3] = 1;
+		}
+		return NUM_CHAOS_CHANNELS;
+	}
+
+	// Steps the chain by one control tick. The second-order chain uses symplectic Euler in place of forward Euler.
+	void stepPendulums(float dt, float damping) {
+		const int n = numLinks;
+		float prevTheta[MAX_LINKS];
+		float x[2 * MAX_LINKS];
+		for (int i = 0; i < n; i++) {
+			prevTheta[i] = links[i].theta;
+			x[i] = links[i].theta;
+			x[n + i] = links[i].vel;
+		}
+
+		const Chain<false> chain = {this, n};
+		if (diagnostics)
+			stepShadow(chain, dt, integrationMode, true, x);
+		if (integrationMode == IntegrationMode::RK4)
+			ode::stepRK4(chain, dt, x);
+		else
+			ode::stepSymplecticEuler(chain, dt, x);
+
+		for (int i = 0; i < n; i++) {
+			links[i].theta = x[i];
+			links[i].vel = x[n + i];
+		}
+
+		// Angle outputs are interpolated along the unwrapped path so a turn past +/-PI doesn't sweep back across the range.
+		float deltaTheta[MAX_LINKS];
+		float sinTheta[MAX_LINKS];
+		float cosTheta[MAX_LINKS];
+		float vel[MAX_LINKS] = {};
+		float acc[MAX_LINKS];
+		for (int i = 0; i < n; i++) {
+			deltaTheta[i] = links[i].theta - prevTheta[i];
+			links[i].theta = eucMod(links[i].theta + (float)PI, (float)(PI * 2)) - (float)PI;
+			sinTheta[i] = std::sin(links[i].theta);
+			cosTheta[i] = std::cos(links[i].theta);
+		}
+		updatePositions(n, sinTheta, cosTheta);
+		const float energyScale = conserveEnergy(n, sinTheta, cosTheta, damping);
+		if (diagnostics) {
+			for (int i = 0; i < n; i++) {
+				x[i] = links[i].theta;
+				x[n + i] = links[i].vel;
+			}
+			updateLyapunov(x, 2 * n, n, dt, energyScale);
+		}
+		if (tracksSections()) {
+			float sectionValue[MAX_SECTIONS];
+			float sectionRate[MAX_SECTIONS];
+			const int count = chainSections(n, sinTheta, cosTheta, sectionValue, sectionRate);
+			detectSections(count, 2, sectionValue, sectionRate, dt, 0.f, (float)tickDivider);
+		}
+
+		// Accelerations at the new state give the velocity outputs their end slopes.
+		for (int i = 0; i < n; i++) {
+			vel[i] = links[i].vel;
+		}
+		Derivative(n, sinTheta, cosTheta, vel, acc);
+		for (int i = 0; i < n; i++) {
+			links[i].acc = acc[i];
+		}
+
+		float value[POLY_CHANNELS];
+		float rate[POLY_CHANNELS];
+		int angleLink[POLY_CHANNELS];
+		int channels = computeOutputs(n, sinTheta, cosTheta, value, rate, angleLink);
+		channels = appendDiagnostics(channels, value, rate, angleLink);
+		for (int i = 0; i < channels; i++) {
+			const float wrapped = value[i];
+			if (angleLink[i] >= 0)
+				value[i] = tickValue[i] + (deltaTheta[angleLink[i]] / PI) * VOLT_FIVE;
+			segments[i].set(tickValue[i], tickRate[i] * dt, value[i], rate[i] * dt);
+			tickValue[i] = wrapped;
+			tickRate[i] = rate[i];
+			tickAngleLink[i] = angleLink[i];
+		}
+		channelCount = channels;
+	}
+
+	// One integrator substep at audio rate using the polynomial trig path.
+	// Writes the outputs of the state going into the step, so symplectic Euler needs a single sine/cosine pair per angle;
+	// the oscillator always integrates that way, as RK4's three further derivatives would cost it most of a sample.
+	// On a sample's first substep, section crossings are found between the last sample's state and this one.
+	int stepAudioRate(float dt, float damping, bool sampleStart, float* out) {
+		const int n = numLinks;
+		float sinTheta[MAX_LINKS] = {};
+		float cosTheta[MAX_LINKS] = {};
+		for (int i = 0; i < n; i++) {
+			fastSinCos(links[i].theta, sinTheta[i], cosTheta[i]);
+		}
+		updatePositions(n, sinTheta, cosTheta);
+		const float energyScale = conserveEnergy(n, sinTheta, cosTheta, damping);
+		int channels = computeOutputs(n, sinTheta, cosTheta, out, NULL, NULL);
+		channels = appendDiagnostics(channels, out, NULL, NULL);
+		if (sampleStart && tracksSections()) {
+			float sectionValue[MAX_SECTIONS];
+			float sectionRate[MAX_SECTIONS];
+			const int count = chainSections(n, sinTheta, cosTheta, sectionValue, sectionRate);
+			detectSections(count, 2, sectionValue, sectionRate, dt * oversample, audioSectionDelay(), 1.f);
+		}
+
+		float x[2 * MAX_LINKS];
+		for (int i = 0; i < n; i++) {
+			x[i] = links[i].theta;
+			x[n + i] = links[i].vel;
+		}
+		const Chain<true> chain = {this, n};
+		if (diagnostics) {
+			// The energy correction just applied to this state applies to the shadow too.
+			if (shadowValid) {
+				for (int i = 0; i < n; i++) {
+					shadow[n + i] *= energyScale;
+				}
+			}
+			stepShadow(chain, dt, IntegrationMode::Euler, true, x);
+		}
+		// The step's one derivative is at this state, so it reuses the sines and cosines already taken for the outputs.
+		float dxdt[2 * MAX_LINKS];
+		for (int i = 0; i < n; i++) {
+			dxdt[i] = x[n + i];
+		}
+		Derivative(n, sinTheta, cosTheta, &x[n], &dxdt[n]);
+		ode::stepSymplecticEuler(chain, dt, x, dxdt);
+
+		for (int i = 0; i < n; i++) {
+			x[i] -= (float)(PI * 2) * std::round(x[i] * (float)(0.5 / PI));
+			links[i].theta = x[i];
+			links[i].vel = x[n + i];
+		}
+		if (diagnostics)
+			updateLyapunov(x, 2 * n, n, dt, 1.f);
+		return channels;
+	}
+
+	// Output channels of an attractor state in the selected layout. When rate is given it receives each channel's
+	// rate of change per unit of simulation time; the velocity channels take theirs from a finite difference along
+	// the flow, which costs one more derivative per control tick.
+	// dxdt receives the derivative at x.
+	template <class System>
+	int computeAttractorOutputs(const System& system, const AttractorInfo& info, const float* x, float* dxdt, float* value, float* rate) {
+		system.derivative(x, dxdt);
+		float velocityRate[ATTRACTOR_SIZE] = {};
+		if (rate && outputLayout != OutputLayout::PositionLayout) {
+			const float h = 1e-3f;
+			float ahead[ATTRACTOR_SIZE];
+			float dxdtAhead[ATTRACTOR_SIZE];
+			for (int i = 0; i < ATTRACTOR_SIZE; i++) {
+				ahead[i] = x[i] + dxdt[i] * h;
+			}
+			system.derivative(ahead, dxdtAhead);
+			for (int i = 0; i < ATTRACTOR_SIZE; i++) {
+				velocityRate[i] = (dxdtAhead[i] - dxdt[i]) / h;
+			}
+		}
+
+		// Velocities are scaled by the main loop's angular frequency so they swing about as far as the positions.
+		const float velocityScale = 1.f / (2.f * (float)PI * info.frequency);
+		float dist = 0.f;
+		float ddist = 0.f;
+		for (int i = 0; i < ATTRACTOR_SIZE; i++) {
+			const float normalised = (x[i] - info.center[i]) / info.scale[i];
+			value[i] = normalised * VOLT_FIVE;
+			value[ATTRACTOR_SIZE + i] = dxdt[i] / info.scale[i] * velocityScale * VOLT_FIVE;
+			dist += normalised * normalised;
+			ddist += normalised * dxdt[i] / info.scale[i];
+			if (rate) {
+				rate[i] = dxdt[i] / info.scale[i] * VOLT_FIVE;
+				rate[ATTRACTOR_SIZE + i] = velocityRate[i] / info.scale[i] * velocityScale * VOLT_FIVE;
+			}
+		}
+		if (outputLayout == OutputLayout::PositionLayout)
+			return ATTRACTOR_SIZE;
+		if (outputLayout == OutputLayout::AngleLayout)
+			return 2 * ATTRACTOR_SIZE;
+
+		// Each normalised variable spans +/-1, so the distance tops out around sqrt(3).
+		dist = std::sqrt(dist);
+		value[2 * ATTRACTOR_SIZE] = dist / std::sqrt(3.f) * VOLT_MAX;
+		if (rate)
+			rate[2 * ATTRACTOR_SIZE] = (dist > 1e-6f) ? ddist / dist / std::sqrt(3.f) * VOLT_MAX : 0.f;
+		return NUM_CHAOS_CHANNELS;
+	}
+
+	// Restarts an attractor that has left its range by far, or overflowed. From outside its double scroll Chua's
+	// circuit either escapes to infinity or settles on a huge outer cycle.
+	void guardAttractor() {
+		const AttractorInfo& info = attractorInfo(systemType);
+		float dist = 0.f;
+		for (int i = 0; i < ATTRACTOR_SIZE; i++) {
+			const float normalised = (attractor[i] - info.center[i]) / info.scale[i];
+			dist += normalised * normalised;
+		}
+		if (!(dist < 16.f))
+			kickAttractor();
+	}
+
+	template <class System>
+	void stepAttractor(const System& system, float dt) {
+		const AttractorInfo& info = attractorInfo(systemType);
+		if (diagnostics)
+			stepShadow(system, dt, integrationMode, false, attractor);
+		if (integrationMode == IntegrationMode::RK4)
+			ode::stepRK4(system, dt, attractor);
+		else
+			ode::stepEuler(system, dt, attractor);
+		guardAttractor();
+		if (diagnostics)
+			updateLyapunov(attractor, ATTRACTOR_SIZE, 0, dt, 1.f);
+
+		float dxdt[ATTRACTOR_SIZE];
+		float value[POLY_CHANNELS];
+		float rate[POLY_CHANNELS];
+		int channels = computeAttractorOutputs(system, info, attractor, dxdt, value, rate);
+		channels = appendDiagnostics(channels, value, rate, NULL);
+		if (tracksSections()) {
+			float sectionValue[MAX_SECTIONS];
+			float sectionRate[MAX_SECTIONS];
+			const int count = attractorSections(attractor, dxdt, sectionValue, sectionRate);
+			detectSections(count, 0, sectionValue, sectionRate, dt, 0.f, (float)tickDivider);
+		}
+		for (int i = 0; i < channels; i++) {
+			segments[i].set(tickValue[i], tickRate[i] * dt, value[i], rate[i] * dt);
+			tickValue[i] = value[i];
+			tickRate[i] = rate[i];
+			tickAngleLink[i] = -1;
+		}
+		channelCount = channels;
+	}
+
+	// One attractor substep at audio rate, writing the outputs of the state going into the step. As for the chain, the
+	// sections are found on a sample's first substep.
+	template <class System>
+	int stepAttractorAudioRate(const System& system, float dt, bool sampleStart, float* out) {
+		float dxdt[ATTRACTOR_SIZE];
+		int channels = computeAttractorOutputs(system, attractorInfo(systemType), attractor, dxdt, out, NULL);
+		channels = appendDiagnostics(channels, out, NULL, NULL);
+		if (sampleStart && tracksSections()) {
+			float sectionValue[MAX_SECTIONS];
+			float sectionRate[MAX_SECTIONS];
+			const int count = attractorSections(attractor, dxdt, sectionValue, sectionRate);
+			detectSections(count, 0, sectionValue, sectionRate, dt * oversample, audioSectionDelay(), 1.f);
+		}
+		if (diagnostics)
+			stepShadow(system, dt, integrationMode, false, attractor);
+		// RK4's first stage is the derivative just taken for the outputs.
+		if (integrationMode == IntegrationMode::RK4)
+			ode::stepRK4(system, dt, attractor, dxdt);
+		else
+			ode::stepEuler(system, dt, attractor, dxdt);
+		if (diagnostics)
+			updateLyapunov(attractor, ATTRACTOR_SIZE, 0, dt, 1.f);
+		return channels;
+	}
+
+	// Reads a batch's ratio and dampen CV, one channel per lane, and rebuilds its lengths as updateLengths does when a
+	// ratio or the link count has changed. Lanes past the last channel of a polyphonic cable read 0V; a monophonic
+	// cable drives every lane.
+	void updateVoiceControls(VoiceBatch& batch, int firstChannel) {
+		simd::float_4 length_ratio = params[LENGTH_RATIO_PARAM].getValue() + inputs[RATIO_IN].getPolyVoltageSimd<simd::float_4>(firstChannel) / VOLT_MAX;
+		length_ratio = simd::clamp(length_ratio, 0.1f, 0.9f);
+		const simd::float_4 damping_in = simd::clamp(params[DAMPING_PARAM].getValue() + inputs[DAMPING_IN].getPolyVoltageSimd<simd::float_4>(firstChannel) / VOLT_MAX, 0.f, 1.f);
+		batch.constants.damping = MAX_DAMPING * damping_in * damping_in;
+
+		const simd::float_4 changed = (length_ratio != batch.ratio);
+		if (!simd::movemask(changed) && batch.numLinks == numLinks)
+			return;
+		// New lengths change a voice's energy, so the lanes that changed take a fresh target.
+		batch.holdEnergy = (batch.numLinks == numLinks) ? (batch.holdEnergy & ~changed) : simd::float_4::zero();
+		batch.ratio = length_ratio;
+		batch.numLinks = numLinks;
+
+		const simd::float_4 taper = (1.0f - length_ratio) / length_ratio;
+		simd::float_4 length[MAX_LINKS];
+		simd::float_4 totalLength = 0.f;
+		for (int i = 0; i < numLinks; i++) {
+			length[i] = 1.f + (taper - 1.f) * ((float)i / (numLinks - 1));
+			totalLength += length[i];
+		}
+		batch.shortestLength = 1.f;
+		for (int i = 0; i < numLinks; i++) {
+			length[i] /= totalLength;
+			batch.constants.length[i] = length[i];
+			batch.constants.invLength[i] = 1.f / length[i];
+			batch.constants.invMass[i] = 1.f / (length[i] * 10.f);
+			batch.shortestLength = simd::fmin(batch.shortestLength, length[i]);
+		}
+	}
+
+	// conserveEnergy's hold for a batch of voices, lane by lane. Returns each lane's factor.
+	simd::float_4 holdVoiceEnergy(VoiceBatch& batch, const simd::float_4* sinTheta, const simd::float_4* cosTheta) {
+		if (!energyHold) {
+			batch.holdEnergy = simd::float_4::zero();
+			return 1.f;
+		}
+		const float g = 9.81f;
+		simd::float_4 kinetic = 0.f;
+		simd::float_4 potential = 0.f;
+		simd::float_4 vx = 0.f;
+		simd::float_4 vy = 0.f;
+		simd::float_4 y = 0.f;
+		for (int i = 0; i < numLinks; i++) {
+			const simd::float_4 length = batch.constants.length[i];
+			const simd::float_4 mass = length * 10.f;
+			y += length * cosTheta[i];
+			vx += length * cosTheta[i] * batch.vel[i];
+			vy -= length * sinTheta[i] * batch.vel[i];
+			kinetic += 0.5f * mass * (vx * vx + vy * vy);
+			potential -= mass * g * y;
+		}
+
+		// Lanes that were holding and still aren't dampened are pulled back to their target; the rest take a fresh one.
+		const simd::float_4 undamped = (batch.constants.damping == 0.f);
+		const simd::float_4 held = batch.holdEnergy & undamped;
+		const simd::float_4 correct = held & (kinetic > 1e-2f) & (batch.targetEnergy > potential);
+		const simd::float_4 scale = simd::ifelse(correct, simd::sqrt(simd::fmax(batch.targetEnergy - potential, 0.f) / simd::fmax(kinetic, 1e-2f)), 1.f);
+		batch.targetEnergy = simd::ifelse(held, batch.targetEnergy, kinetic + potential);
+		batch.holdEnergy = undamped;
+		for (int i = 0; i < numLinks; i++) {
+			batch.vel[i] *= scale;
+		}
+		return scale;
+	}
+
+	// Each voice's output channel for a batch's state. When rate is given it receives the channel's rate of change
+	// per unit of simulation time.
+	simd::float_4 computeVoiceOutput(const VoiceBatch& batch, const simd::float_4* sinTheta, const simd::float_4* cosTheta, simd::float_4* rate) const {
+		const int n = numLinks;
+		if (voiceOutput == VoiceOutput::VoiceFirstAngle || voiceOutput == VoiceOutput::VoiceLastAngle) {
+			const int i = (voiceOutput == VoiceOutput::VoiceFirstAngle) ? 0 : n - 1;
+			if (rate)
+				*rate = (batch.vel[i] / PI) * VOLT_FIVE;
+			return (batch.theta[i] / PI) * VOLT_FIVE;
+		}
+
+		simd::float_4 x = 0.f;
+		simd::float_4 y = 0.f;
+		simd::float_4 dx = 0.f;
+		simd::float_4 dy = 0.f;
+		for (int i = 0; i < n; i++) {
+			const simd::float_4 length = batch.constants.length[i];
+			x += length * sinTheta[i];
+			y += length * cosTheta[i];
+			dx += length * cosTheta[i] * batch.vel[i];
+			dy -= length * sinTheta[i] * batch.vel[i];
+		}
+		if (voiceOutput == VoiceOutput::VoiceTipX) {
+			if (rate)
+				*rate = dx * VOLT_FIVE;
+			return x * VOLT_FIVE;
+		}
+		if (voiceOutput == VoiceOutput::VoiceTipY) {
+			if (rate)
+				*rate = dy * -1.f * VOLT_FIVE;
+			return y * -1.f * VOLT_FIVE;
+		}
+		const simd::float_4 dist = simd::sqrt(x * x + y * y);
+		if (rate)
+			*rate = simd::ifelse(dist > 1e-6f, (x * dx + y * dy) / simd::fmax(dist, 1e-6f), 0.f) * VOLT_MAX;
+		return dist * VOLT_MAX;
+	}
+
+	// Copies the first voice back into the chain, which the display, the flip map and patch storage all read, and
+	// gives the sines and cosines of its angles.
+	void followFirstVoice(float* sinTheta, float* cosTheta) {
+		for (int i = 0; i < numLinks; i++) {
+			links[i].theta = voices[0].theta[i][0];
+			links[i].vel = voices[0].vel[i][0];
+			fastSinCos(links[i].theta, sinTheta[i], cosTheta[i]);
+		}
+		updatePositions(numLinks, sinTheta, cosTheta);
+	}
+
+	// Energy, angular momentum and section crossings follow the first voice once followFirstVoice has copied it into
+	// the chain, which shares its lengths and damping. dt is the voice's own step, after its timescale.
+	void measureFirstVoice(const float* sinTheta, const float* cosTheta, float dt, float sectionDelay, float span) {
+		float kinetic;
+		float potential;
+		float angular;
+		measureEnergy(numLinks, sinTheta, cosTheta, kinetic, potential, angular);
+		energy = kinetic + potential;
+		if (diagnostics)
+			momentum = angular;
+		if (tracksSections()) {
+			float sectionValue[MAX_SECTIONS];
+			float sectionRate[MAX_SECTIONS];
+			const int count = chainSections(numLinks, sinTheta, cosTheta, sectionValue, sectionRate);
+			detectSections(count, 2, sectionValue, sectionRate, dt, sectionDelay, span);
+		}
+	}
+
+	// The first voice's state as the chain's: angles, then angular velocities.
+	void firstVoiceState(float* x) const {
+		for (int i = 0; i < numLinks; i++) {
+			x[i] = voices[0].theta[i][0];
+			x[numLinks + i] = voices[0].vel[i][0];
+		}
+	}
+
+	// Per-voice counterpart of stepPendulums: steps every voice by one control tick and sets its channel's curve.
+	// dt is before each voice's timewarp. The diagnostic channels come after the voices' and follow the first voice.
+	void stepVoices(float dt) {
+		const int n = numLinks;
+		const bool tracking = diagnostics || tracksSections();
+		float before[2 * MAX_LINKS];
+		float energyScale = 1.f;
+		for (int b = 0; b * 4 < numVoices; b++) {
+			VoiceBatch& batch = voices[b];
+			updateVoiceControls(batch, b * 4);
+			const simd::float_4 timewarp = params[GRAVITY_PARAM].getValue() + inputs[GRAVITY_IN].getPolyVoltageSimd<simd::float_4>(b * 4) / VOLT_MAX;
+			batch.timescale = simd::clamp(timewarp, 0.f, 6.f);
+
+			simd::float_4 x[2 * MAX_LINKS];
+			for (int i = 0; i < n; i++) {
+				x[i] = batch.theta[i];
+				x[n + i] = batch.vel[i];
+			}
+			if (b == 0 && diagnostics) {
+				firstVoiceState(before);
+				stepShadow(FirstVoiceChain{&batch, n}, dt, integrationMode, true, before);
+			}
+			const VoiceChain chain = {&batch, n};
+			if (integrationMode == IntegrationMode::RK4)
+				ode::stepRK4(chain, dt, x);
+			else
+				ode::stepSymplecticEuler(chain, dt, x);
+
+			simd::float_4 deltaTheta[MAX_LINKS];
+			simd::float_4 sinTheta[MAX_LINKS];
+			simd::float_4 cosTheta[MAX_LINKS];
+			for (int i = 0; i < n; i++) {
+				deltaTheta[i] = x[i] - batch.theta[i];
+				batch.theta[i] = x[i] - (float)(PI * 2) * simd::round(x[i] * (float)(0.5 / PI));
+				batch.vel[i] = x[n + i];
+				fastSinCos(batch.theta[i], sinTheta[i], cosTheta[i]);
+			}
+			const simd::float_4 scale = holdVoiceEnergy(batch, sinTheta, cosTheta);
+			if (b == 0)
+				energyScale = scale[0];
+
+			// Rates are kept per unit of the shared step, like the chain's, so the curves and the recorder need no timescale.
+			simd::float_4 rate;
+			const simd::float_4 value = computeVoiceOutput(batch, sinTheta, cosTheta, &rate);
+			rate *= batch.timescale;
+			const bool isAngle = (voiceOutput == VoiceOutput::VoiceFirstAngle || voiceOutput == VoiceOutput::VoiceLastAngle);
+			const int link = (voiceOutput == VoiceOutput::VoiceFirstAngle) ? 0 : n - 1;
+			for (int lane = 0; lane < 4 && b * 4 + lane < numVoices; lane++) {
+				const int c = b * 4 + lane;
+				float end = value[lane];
+				if (isAngle)
+					end = tickValue[c] + (deltaTheta[link][lane] / PI) * VOLT_FIVE;
+				segments[c].set(tickValue[c], tickRate[c] * dt, end, rate[lane] * dt);
+				tickValue[c] = value[lane];
+				tickRate[c] = rate[lane];
+				tickAngleLink[c] = isAngle ? link : -1;
+			}
+		}
+
+		float sinTheta[MAX_LINKS];
+		float cosTheta[MAX_LINKS];
+		followFirstVoice(sinTheta, cosTheta);
+		if (tracking) {
+			const float firstDt = dt * voices[0].timescale[0];
+			measureFirstVoice(sinTheta, cosTheta, firstDt, 0.f, (float)tickDivider);
+			if (diagnostics) {
+				float x[2 * MAX_LINKS];
+				firstVoiceState(x);
+				updateLyapunov(x, 2 * n, n, firstDt, energyScale);
+			}
+		}
+
+		float value[POLY_CHANNELS];
+		float rate[POLY_CHANNELS];
+		const int channels = appendDiagnostics(numVoices, value, rate, NULL);
+		for (int c = numVoices; c < channels; c++) {
+			segments[c].set(tickValue[c], tickRate[c] * dt, value[c], rate[c] * dt);
+			tickValue[c] = value[c];
+			tickRate[c] = rate[c];
+			tickAngleLink[c] = -1;
+		}
+		channelCount = channels;
+	}
+
+	// Per-voice counterpart of the chain's oscillator. Each voice's pitch sets its own step, capped where its shortest
+	// link stays stable; a batch integrates at the largest of its four and the other lanes run slower by their timescale.
+	// As with the chain, every voice integrates with symplectic Euler, the diagnostic channels come after the voices' and
+	// the sections are found once a sample, a sample behind; both follow the first voice.
+	void processVoicesAudioRate(const ProcessArgs& args) {
+		const int n = numLinks;
+		const bool tracking = diagnostics || tracksSections();
+		simd::float_4 buffer[POLY_CHANNELS / 4][MAX_OVERSAMPLE];
+		float diagnostic[MAX_OVERSAMPLE][POLY_CHANNELS];
+		int channels = numVoices;
+		for (int b = 0; b * 4 < numVoices; b++) {
+			VoiceBatch& batch = voices[b];
+			updateVoiceControls(batch, b * 4);
+			const simd::float_4 pitch = params[GRAVITY_PARAM].getValue() * dsp::approxExp2_taylor5(inputs[GRAVITY_IN].getPolyVoltageSimd<simd::float_4>(b * 4));
+			simd::float_4 voiceDt = args.sampleTime * (dsp::FREQ_C4 / SMALL_SWING_FREQ) * pitch / oversample;
+			voiceDt = simd::fmin(voiceDt, MAX_AUDIO_DT * simd::sqrt(batch.shortestLength / 0.5f));
+			const float dt = std::max(std::max(voiceDt[0], voiceDt[1]), std::max(voiceDt[2], voiceDt[3]));
+			batch.timescale = voiceDt / dt;
+			const VoiceChain chain = {&batch, n};
+
+			for (int s = 0; s < oversample; s++) {
+				simd::float_4 sinTheta[MAX_LINKS];
+				simd::float_4 cosTheta[MAX_LINKS];
+				for (int i = 0; i < n; i++) {
+					fastSinCos(batch.theta[i], sinTheta[i], cosTheta[i]);
+				}
+				const simd::float_4 energyScale = holdVoiceEnergy(batch, sinTheta, cosTheta);
+				buffer[b][s] = computeVoiceOutput(batch, sinTheta, cosTheta, NULL);
+
+				const float firstDt = dt * batch.timescale[0];
+				if (b == 0 && tracking) {
+					float firstSin[MAX_LINKS];
+					float firstCos[MAX_LINKS];
+					followFirstVoice(firstSin, firstCos);
+					if (s == 0)
+						measureFirstVoice(firstSin, firstCos, firstDt * oversample, audioSectionDelay(), 1.f);
+					channels = appendDiagnostics(numVoices, diagnostic[s], NULL, NULL);
+					if (diagnostics) {
+						// The energy correction just applied to the voice applies to the shadow too.
+						if (shadowValid) {
+							for (int i = 0; i < n; i++) {
+								shadow[n + i] *= energyScale[0];
+							}
+						}
+						float before[2 * MAX_LINKS];
+						firstVoiceState(before);
+						stepShadow(FirstVoiceChain{&batch, n}, dt, IntegrationMode::Euler, true, before);
+					}
+				}
+
+				simd::float_4 x[2 * MAX_LINKS];
+				for (int i = 0; i < n; i++) {
+					x[i] = batch.theta[i];
+					x[n + i] = batch.vel[i];
+				}
+				// As for the chain, the step reuses the sines and cosines just taken for the outputs.
+				simd::float_4 dxdt[2 * MAX_LINKS];
+				chainDerivative(n, batch.constants, sinTheta, cosTheta, &x[n], &dxdt[n]);
+				for (int i = 0; i < n; i++) {
+					dxdt[i] = x[n + i] * batch.timescale;
+					dxdt[n + i] *= batch.timescale;
+				}
+				ode::stepSymplecticEuler(chain, dt, x, dxdt);
+				for (int i = 0; i < n; i++) {
+					batch.theta[i] = x[i] - (float)(PI * 2) * simd::round(x[i] * (float)(0.5 / PI));
+					batch.vel[i] = x[n + i];
+				}
+				if (b == 0 && diagnostics) {
+					float after[2 * MAX_LINKS];
+					firstVoiceState(after);
+					updateLyapunov(after, 2 * n, n, firstDt, 1.f);
+				}
+			}
+
+			// As for the chain, a voice that outran its integrator restarts from rest.
+			simd::float_4 velSum = 0.f;
+			for (int i = 0; i < n; i++) {
+				velSum += batch.vel[i];
+			}
+			for (int lane = 0; lane < 4; lane++) {
+				if (std::isfinite(velSum[lane]))
+					continue;
+				for (int i = 0; i < MAX_LINKS; i++) {
+					batch.theta[i][lane] = 0.f;
+					batch.vel[i][lane] = 0.f;
+				}
+				batch.holdEnergy[lane] = 0.f;
+				if (b == 0 && lane == 0)
+					restartTracking();
+			}
+		}
+		float sinTheta[MAX_LINKS];
+		float cosTheta[MAX_LINKS];
+		followFirstVoice(sinTheta, cosTheta);
+
+		// The diagnostic channels go through the voices' decimators too, the first of them sharing a voice batch's.
+		for (int s = 0; s < oversample; s++) {
+			for (int g = (numVoices + 3) / 4; g * 4 < channels; g++) {
+				buffer[g][s] = 0.f;
+			}
+			for (int c = numVoices; c < channels; c++) {
+				buffer[c / 4][s][c % 4] = diagnostic[s][c];
+			}
+		}
+		for (int g = 0; g * 4 < channels; g++) {
+			simd::float_4 v;
+			switch (oversample) {
+				case 2: v = decimator2[g].process(buffer[g]); break;
+				case 4: v = decimator4[g].process(buffer[g]); break;
+				case 8: v = decimator8[g].process(buffer[g]); break;
+				default: v = buffer[g][0]; break;
+			}
+			for (int c = 0; c < 4 && g * 4 + c < channels; c++) {
+				outputs[POLY_CHAOS_OUTPUT].setVoltage(v[c], g * 4 + c);
+			}
+		}
+		channelCount = channels;
+		outputs[POLY_CHAOS_OUTPUT].setChannels(channels);
+	}
+
+	// Frequency of the selected system's main oscillation in simulation time.
+	float systemFrequency() {
+		if (systemType == PendulumSystem)
+			return SMALL_SWING_FREQ;
+		return attractorInfo(systemType).frequency;
+	}
+
+	// rateDivider counts samples at DIVIDER_SAMPLE_RATE. At other rates the tick spans proportionally more or fewer
+	// samples, so the simulation's CPU cost and its steps stay the same at any sample rate.
+	// A change in the middle of a tick starts the next one at once: the frame count so far could run past the new
+	// tick's end, and the output curves would extrapolate.
+	void updateTickRate(float sampleRate) {
+		tickRateDivider = rateDivider;
+		tickSampleRate = sampleRate;
+		tickDivider = std::max(1, (int)std::round(rateDivider * sampleRate / DIVIDER_SAMPLE_RATE));
+		tickFraction = 1.f / tickDivider;
+		tickSeconds = tickDivider / sampleRate;
+		frame = 0;
+	}
+
+	void onSampleRateChange() override {
+		updateTickRate(APP->engine->getSampleRate());
+	}
+
+	void stepControlRate() {
+		float damping = updateControls();
+		// Simulation time runs at a quarter of real time, so the motion has the same speed for any divider or sample rate.
+		// Attractors are paced so their main loop comes round as often as the pendulum's slow swing.
+		const float timewarp = params[GRAVITY_PARAM].getValue() + (controlVoltage(GRAVITY_IN) / VOLT_MAX);
+		if (timewarp != lastTimewarp || tickSeconds != lastTickSeconds || systemType != lastTickSystem) {
+			lastTimewarp = timewarp;
+			lastTickSeconds = tickSeconds;
+			lastTickSystem = systemType;
+			controlDt = tickSeconds / DEFAULT_RATE_DIVIDER * clamp(timewarp, 0.f, 6.f);
+			controlDt *= SMALL_SWING_FREQ / systemFrequency();
+		}
+		float dt = controlDt;
+
+		if (numVoices > 1) {
+			// Each voice applies its own timewarp.
+			dt = tickSeconds / DEFAULT_RATE_DIVIDER;
+			stepVoices(dt);
+		} else {
+			switch (systemType) {
+				case LorenzSystem: stepAttractor(Lorenz(ratio), dt); break;
+				case RosslerSystem: stepAttractor(Rossler(ratio), dt); break;
+				case ChuaSystem: stepAttractor(Chua(ratio), dt); break;
+				case ThomasSystem: stepAttractor(Thomas(ratio), dt); break;
+				default: stepPendulums(dt, damping); break;
+			}
+		}
+		if (recorderMode == RecorderMode::RecorderRecording)
+			recordTickOutputs(dt, tickSeconds);
+	}
+
+	// Called from the UI thread. Recording keeps the last recordSeconds of the outputs, restarting the take.
+	void armRecorder() {
+		if (recordBuffer.empty())
+			recordBuffer.resize((size_t)(MAX_RECORD_SECONDS * RECORD_RATE) * 2 * NUM_CHAOS_CHANNELS);
+		recorderRequest.store(RecorderMode::RecorderRecording, std::memory_order_release);
+	}
+
+	// Called from the UI thread. Freezes the take and loops it from its oldest frame.
+	void playRecorder() {
+		recorderRequest.store(RecorderMode::RecorderPlaying, std::memory_order_release);
+	}
+
+	// Called from the UI thread. Stops recording or playing; the take is kept.
+	void stopRecorder() {
+		recorderRequest.store(RecorderMode::RecorderOff, std::memory_order_release);
+	}
+
+	// Applies the menu's latest recorder request, if any, before the sample that follows it. As with the link count,
+	// the request is looked at before the exchange that takes it.
+	void updateRecorder() {
+		if (recorderRequest.load(std::memory_order_relaxed) < 0)
+			return;
+		const int request = recorderRequest.exchange(-1, std::memory_order_acquire);
+		switch (request) {
+			case RecorderMode::RecorderRecording:
+				recordRestart = true;
+				recorderMode = RecorderMode::RecorderRecording;
+				break;
+			case RecorderMode::RecorderPlaying:
+				if (recordFrames < 2)
+					break;
+				playPosition = 0.f;
+				playIndex = -1;
+				recorderMode = RecorderMode::RecorderPlaying;
+				break;
+			case RecorderMode::RecorderOff:
+				recorderMode = RecorderMode::RecorderOff;
+				break;
+			default:
+				break;
+		}
+	}
+
+	// Stores the tick's outputs, every recordTicksPerFrame ticks, into the ring. A new take starts when the channels
+	// or the tick length change, since the frames already stored would no longer line up.
+	void recordTickOutputs(float dt, float tickSeconds) {
+		if (recordRestart || channelCount != (uint)recordChannels || tickSeconds != recordTickSeconds) {
+			recordRestart = false;
+			recordChannels = channelCount;
+			recordTickSeconds = tickSeconds;
+			recordTicksPerFrame = std::max(1, (int)std::ceil(1.f / (tickSeconds * RECORD_RATE)));
+			recordFrameSeconds = recordTicksPerFrame * tickSeconds;
+			const int roomFrames = (int)(recordBuffer.size() / (2 * std::max(recordChannels, 1)));
+			recordCapacity = clamp((int)(recordSeconds / recordFrameSeconds), 2, roomFrames);
+			recordWrite = 0;
+			recordFrames = 0;
+			recordTick = 0;
+			for (int i = 0; i < recordChannels; i++) {
+				recordAngleLink[i] = tickAngleLink[i];
+			}
+		}
+		if (++recordTick < recordTicksPerFrame)
+			return;
+		recordTick = 0;
+
+		float* frame = &recordBuffer[(size_t)recordWrite * 2 * recordChannels];
+		for (int i = 0; i < recordChannels; i++) {
+			frame[i] = tickValue[i];
+			frame[recordChannels + i] = tickRate[i] * dt / tickSeconds;
+		}
+		recordWrite = (recordWrite + 1) % recordCapacity;
+		recordFrames = std::min(recordFrames + 1, recordCapacity);
+	}
+
+	// Plays the frozen take instead of simulating: a cubic Hermite curve through each pair of frames, much as the
+	// live outputs are interpolated between ticks. Timewarp sets the speed (1x as recorded, negative runs backwards)
+	// and the scrub input, when patched, picks the position directly, 0V to 10V across the take.
+	void processPlayback(const ProcessArgs& args) {
+		const int frames = recordFrames;
+		float position;
+		if (inputs[SCRUB_IN].isConnected()) {
+			position = clamp(inputs[SCRUB_IN].getVoltage() / VOLT_MAX, 0.f, 1.f) * (frames - 1);
+		} else {
+			const float speed = params[GRAVITY_PARAM].getValue() + (controlVoltage(GRAVITY_IN) / VOLT_MAX);
+			playPosition = eucMod(playPosition + speed * args.sampleTime / recordFrameSeconds, (float)frames);
+			position = playPosition;
+		}
+		const int index = std::min((int)position, frames - 1);
+		const float t = position - index;
+		const int channels = recordChannels;
+
+		if (index != playIndex) {
+			playIndex = index;
+			// Frames are counted from the oldest, which sits at the write index once the ring has wrapped.
+			const int oldest = (recordFrames < recordCapacity) ? 0 : recordWrite;
+			const float* from = &recordBuffer[(size_t)((oldest + index) % recordCapacity) * 2 * channels];
+			const float* to = &recordBuffer[(size_t)((oldest + (index + 1) % frames) % recordCapacity) * 2 * channels];
+			for (int i = 0; i < channels; i++) {
+				float end = to[i];
+				if (recordAngleLink[i] >= 0)
+					end = from[i] + wrapAngleVoltage(end - from[i]);
+				playSegments[i].set(from[i], from[channels + i] * recordFrameSeconds, end, to[channels + i] * recordFrameSeconds);
+			}
+		}
+		for (int i = 0; i < channels; i++) {
+			float v = playSegments[i].eval(t);
+			if (recordAngleLink[i] >= 0)
+				v = wrapAngleVoltage(v);
+			outputs[POLY_CHAOS_OUTPUT].setVoltage(v, i);
+		}
+		outputs[POLY_CHAOS_OUTPUT].setChannels(channels);
+	}
 
-	void Derivative(const Pendulum& p0, const Pendulum& p1, float& out_dxdt0, float& out_dxdt1) {
-		const float g = 9.81f;
-		const float deltaTheta = p0.theta - p1.theta;
-		const float mass_sum = p0.mass + p1.mass;
-		const float shared_denominator = (2.f * mass_sum - p1.mass * std::cos(2.f * p0.theta - 2.f * p1.theta));
-		const float p0_numerator = 
-			-g * (2.f * mass_sum) * std::sin(p0.theta) 
-			- p1.mass * g * std::sin(p0.theta - 2.f * p1.theta) 
-			- 2.f * std::sin(deltaTheta) * p1.mass 
-			* ((p1.vel * p1.vel) * p1.length + (p0.vel * p0.vel) * p0.length * std::cos(deltaTheta));
-		const float p0_denominator = p0.length * shared_denominator;
-		out_dxdt0 = p0_numerator / p0_denominator;
-
-		const float p1_numerator = 
-			2.f * std::sin(deltaTheta) * ((p0.vel * p0.vel) * p0.length * mass_sum 
-			+ g * mass_sum * std::cos(p0.theta) 
-			+ (p1.vel * p1.vel) * p1.length * p1.mass * std::cos(deltaTheta));
-		const float p1_denominator = p1.length * shared_denominator;
-		out_dxdt1 = p1_numerator / p1_denominator;
+	// Samples from now to the start of the span in which the audio rate's section crossings are found, from the last
+	// sample's first substep to this one's. The triggers are held back to line up with the decimated CV: the decimator's
+	// symmetric FIR delays its newest substep by half its length, and crossings come out a sample late, the one they
+	// were found in, so they can land after this sample's start.
+	float audioSectionDelay() const {
+		if (oversample == 1)
+			return 0.f;
+		return (DECIMATOR_QUALITY * oversample - 1) / (2.f * oversample) - (float)(oversample - 1) / oversample;
 	}
 
-	ChaosModule() {
-		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
-		configParam(GRAVITY_PARAM, 0.01f, 6.f, 1.0f, "timewarp", "x");
-		configParam(LENGTH_RATIO_PARAM, 0.1f, 1.0f - 0.1f, 0.5f, "ratio", "");
-		configParam(DAMPING_PARAM, 0.0f, 1.f, 0.0f, "dampen", "");
-		configParam(KICK_PARAM, 0.f, 1.f, 0.f);
-		integrationMode = IntegrationMode::RK4;
-		kickMode = KickMode::ClearVelocity;
+	// Integrates every sample (or oversample times per sample) so the pendulum can run as an oscillator.
+	// Timewarp scales the pitch and the timewarp input tracks V/oct around C4.
+	void processAudioRate(const ProcessArgs& args) {
+		const float damping = updateControls();
+		if (numVoices > 1) {
+			processVoicesAudioRate(args);
+			return;
+		}
+		const float pitch = params[GRAVITY_PARAM].getValue() * dsp::approxExp2_taylor5(inputs[GRAVITY_IN].getVoltage());
+		float dt = args.sampleTime * (dsp::FREQ_C4 / systemFrequency()) * pitch / oversample;
+		// Short links swing faster, so the stable step shrinks with the square root of the shortest one.
+		if (systemType == PendulumSystem)
+			dt = std::min(dt, MAX_AUDIO_DT * std::sqrt(shortestLength / 0.5f));
+		else
+			dt = std::min(dt, attractorInfo(systemType).maxDt);
+
+		// Channels are decimated four at a time.
+		simd::float_4 buffer[POLY_CHANNELS / 4][MAX_OVERSAMPLE];
+		int channels = 0;
+		for (int i = 0; i < oversample; i++) {
+			const bool sampleStart = (i == 0);
+			float out[POLY_CHANNELS] = {};
+			switch (systemType) {
+				case LorenzSystem: channels = stepAttractorAudioRate(Lorenz(ratio), dt, sampleStart, out); break;
+				case RosslerSystem: channels = stepAttractorAudioRate(Rossler(ratio), dt, sampleStart, out); break;
+				case ChuaSystem: channels = stepAttractorAudioRate(Chua(ratio), dt, sampleStart, out); break;
+				case ThomasSystem: channels = stepAttractorAudioRate(Thomas(ratio), dt, sampleStart, out); break;
+				default: channels = stepAudioRate(dt, damping, sampleStart, out); break;
+			}
+			for (int g = 0; g < POLY_CHANNELS / 4; g++) {
+				buffer[g][i] = simd::float_4::load(&out[g * 4]);
+			}
+		}
+
+		// An extreme kick at the highest pitch can still outrun the integrator; restart from rest rather than emit NaNs.
+		float velSum = 0.f;
+		for (int i = 0; i < numLinks; i++) {
+			velSum += links[i].vel;
+		}
+		if (!std::isfinite(velSum)) {
+			for (int i = 0; i < MAX_LINKS; i++) {
+				links[i] = Pendulum{};
+			}
+			updateLengths(ratio);
+			restartTracking();
+		}
+		if (systemType != PendulumSystem)
+			guardAttractor();
+
+		for (int g = 0; g * 4 < channels; g++) {
+			simd::float_4 v;
+			switch (oversample) {
+				case 2: v = decimator2[g].process(buffer[g]); break;
+				case 4: v = decimator4[g].process(buffer[g]); break;
+				case 8: v = decimator8[g].process(buffer[g]); break;
+				default: v = buffer[g][0]; break;
+			}
+			for (int c = 0; c < 4 && g * 4 + c < channels; c++) {
+				outputs[POLY_CHAOS_OUTPUT].setVoltage(v[c], g * 4 + c);
+			}
+		}
+		channelCount = channels;
+		outputs[POLY_CHAOS_OUTPUT].setChannels(channels);
 	}
 
-	void onReset() override {
-		Module::onReset();
-		p0 = Pendulum{};
-		p1 = Pendulum{};
-		integrationMode = IntegrationMode::RK4;
-		kickMode = KickMode::ClearVelocity;
+	void processControlRate(const ProcessArgs& args) {
+		if (frame == 0) {
+			// Also catches a divider picked from the menu, and the first tick before any sample rate change.
+			if (rateDivider != tickRateDivider || args.sampleRate != tickSampleRate)
+				updateTickRate(args.sampleRate);
+			stepControlRate();
+		}
+
+		// Outputs trail the simulation by one tick so every sample can be interpolated between two known states.
+		const float t = frame * tickFraction;
+		for (uint i = 0; i < channelCount; i++) {
+			float v = segments[i].eval(t);
+			if (tickAngleLink[i] >= 0)
+				v = wrapAngleVoltage(v);
+			outputs[POLY_CHAOS_OUTPUT].setVoltage(v, i);
+		}
+		outputs[POLY_CHAOS_OUTPUT].setChannels(channelCount);
+
+		if (++frame >= tickDivider)
+			frame = 0;
 	}
 
-	void onRandomize() override {
-		Module::onRandomize();
-		p0.theta = random::uniform() * PI * 2.f;
-		p1.theta = random::uniform() * PI * 2.f;
-		p0.vel = (random::uniform() - 0.5f) * 5.f;
-		p1.vel = (random::uniform() - 0.5f) * 5.f;
+	// Publishes the current pose for the display. When the display isn't draining (hidden or headless) snapshots are dropped.
+	void pushPose() {
+		if (++poseFrame < POSE_INTERVAL)
+			return;
+		poseFrame = 0;
+		if (poseBuffer.full())
+			return;
+		PendulumPose pose;
+		if (systemType == PendulumSystem) {
+			pose.numLinks = numLinks;
+			pose.isChain = true;
+			for (int i = 0; i < pose.numLinks; i++) {
+				pose.x[i] = links[i].x;
+				pose.y[i] = links[i].y;
+				pose.length[i] = links[i].length;
+				pose.mass[i] = links[i].mass;
+			}
+		} else {
+			const AttractorInfo& info = attractorInfo(systemType);
+			pose.numLinks = 1;
+			pose.isChain = false;
+			pose.x[0] = (attractor[info.axisX] - info.center[info.axisX]) / info.scale[info.axisX];
+			pose.y[0] = -(attractor[info.axisY] - info.center[info.axisY]) / info.scale[info.axisY];
+			pose.length[0] = 0.f;
+			pose.mass[0] = 2.f;
+		}
+		poseBuffer.push(pose);
 	}
 
-	json_t *dataToJson() override {
-		json_t *obj = json_object();
-		json_object_set_new(obj, "mode", json_integer(integrationMode));
-		json_object_set_new(obj, "kick_mode", json_integer(kickMode));
-		json_object_set_new(obj, "p0_theta", json_real(p0.theta));
-		json_object_set_new(obj, "p0_vel", json_real(p0.vel));
-		json_object_set_new(obj, "p1_theta", json_real(p1.theta));
-		json_object_set_new(obj, "p1_vel", json_real(p1.vel));
-		return obj;
+	// Fills a message for the expander bus from the current state. Links that crossed the +/-PI seam since the last
+	// message, other than by a kick, swung over the top.
+	void fillBusMessage(ChaosBusMessage& message) {
+		const float g = 9.81f;
+		const float totalMass = 10.f;
+		message.flipEvents = 0;
+		if (systemType == PendulumSystem) {
+			message.numLinks = numLinks;
+			for (int i = 0; i < numLinks; i++) {
+				const float theta = links[i].theta;
+				const float delta = theta - busTheta[i];
+				const float unwrapped = busTheta[i] + delta - (float)(PI * 2) * std::round(delta * (float)(0.5 / PI));
+				if (!busKicked && std::fabs(unwrapped) > (float)PI)
+					message.flipEvents |= 1u << i;
+				busTheta[i] = theta;
+				message.theta[i] = theta;
+				message.vel[i] = links[i].vel;
+				message.x[i] = links[i].x;
+				message.y[i] = links[i].y;
+			}
+			for (int i = 0; i < ATTRACTOR_SIZE; i++) {
+				message.point[i] = 0.f;
+			}
+			// In per-voice mode this is the first voice's.
+			message.energy = energy / (totalMass * g);
+		} else {
+			const AttractorInfo& info = attractorInfo(systemType);
+			message.numLinks = 0;
+			for (int i = 0; i < ATTRACTOR_SIZE; i++) {
+				message.point[i] = (attractor[i] - info.center[i]) / info.scale[i];
+			}
+			message.energy = 0.f;
+		}
+		message.numSections = sectionsValid ? sectionCount : 0;
+		message.sectionEvents = busSectionEvents;
+		message.kicked = busKicked;
 	}
 
-	void dataFromJson(json_t *rootJ) override {
-		json_t* modeJ = json_object_get(rootJ, "mode");
-		if (modeJ) integrationMode = (IntegrationMode)json_integer_value(modeJ);
+	// Publishes the state to a CHAOS X on either side, writing into its producer buffer and asking Rack to flip it.
+	void publishBus() {
+		Module* right = rightExpander.module;
+		Module* left = leftExpander.module;
+		const bool toRight = right && right->model == modelChaosX;
+		const bool toLeft = left && left->model == modelChaosX;
+		if (!toRight && !toLeft) {
+			busAttached = false;
+			busSectionEvents = 0;
+			busKicked = false;
+			return;
+		}
+		if (!busAttached) {
+			// Nothing was tracked while no expander listened, so start the flip test from here.
+			for (int i = 0; i < numLinks; i++) {
+				busTheta[i] = links[i].theta;
+			}
+			busAttached = true;
+		}
+		if (toRight) {
+			fillBusMessage(*(ChaosBusMessage*)right->leftExpander.producerMessage);
+			right->leftExpander.messageFlipRequested = true;
+		}
+		if (toLeft) {
+			ChaosBusMessage* message = (ChaosBusMessage*)left->rightExpander.producerMessage;
+			if (toRight)
+				*message = *(const ChaosBusMessage*)right->leftExpander.producerMessage;
+			else
+				fillBusMessage(*message);
+			left->rightExpander.messageFlipRequested = true;
+		}
+		busSectionEvents = 0;
+		busKicked = false;
+	}
 
-		json_t* kickmodeJ = json_object_get(rootJ, "kick_mode");
-		if (kickmodeJ) kickMode = (KickMode)json_integer_value(kickmodeJ);
+	void process(const ProcessArgs& args) override {
+        // Audio signals are typically +/-5V
+        // https://vcvrack.com/manual/VoltageStandards.html
+		updateVoiceCount();
+		updateRecorder();
+		if (rateMode == RateMode::AudioRate) {
+			processAudioRate(args);
+		} else if (recorderMode == RecorderMode::RecorderPlaying) {
+			processPlayback(args);
+		} else {
+			processControlRate(args);
+		}
+		if (tracksSections())
+			processSections(args.sampleTime);
+		else
+			sectionsValid = false;
+		pushPose();
+		publishBus();
+	}
+};
+
+// Flip-time map of the chain: for a grid of starting angles (first link across, the rest lined up going up), how long
+// the chain dropped from rest takes before any link swings over the top. Rendered by a small pool of worker threads,
+// four chains per SIMD batch, coarse pixels first so the map sharpens on screen as it fills in.
+struct FlipMap {
+	// Pixels in render order: every MAP_COARSEST-th pixel first, then each halving of the stride.
+	int order[MAP_SIZE * MAP_SIZE];
+	// Flip time in cycles, or -1 for chains that never flip within MAP_MAX_CYCLES. Workers write a chunk's times under
+	// the mutex, and only for the render that is still current.
+	float flipTime[MAP_SIZE * MAP_SIZE];
+	// Generation + 1 of the render that completed each chunk; zero until one has.
+	std::atomic<unsigned> chunkDone[MAP_SIZE * MAP_SIZE / MAP_CHUNK];
 
-		json_t* p0thetaJ = json_object_get(rootJ, "p0_theta");
-		if (p0thetaJ) p0.theta = (float)json_real_value(p0thetaJ);
+	// Only touched by the UI thread.
+	unsigned char pixels[MAP_SIZE * MAP_SIZE * 4];
+	unsigned char paintedStride[MAP_SIZE * MAP_SIZE];
+	bool chunkPainted[MAP_SIZE * MAP_SIZE / MAP_CHUNK];
+	int chunksPainted = 0;
+	bool dirty = false;
 
-		json_t* p0velJ = json_object_get(rootJ, "p0_vel");
-		if (p0velJ) p0.vel = (float)json_real_value(p0velJ);
+	// The links being mapped and the generation of the render they belong to. restart() replaces them under the mutex,
+	// and each worker takes its own copy there along with its next chunk, so restarting never waits for the workers.
+	struct Render {
+		ChaosModule::ChainConstants chain;
+		int numLinks = 0;
+		float dt = 0.f;
+		unsigned generation = 0;
+	};
+	Render render;
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool running = true;
+	// The next chunk to hand out, guarded by the mutex.
+	int nextChunk = MAP_SIZE * MAP_SIZE / MAP_CHUNK;
+	// Written by the UI thread only.
+	unsigned generation = 0;
+	// Lets a worker notice a restart partway through a chunk.
+	std::atomic<unsigned> currentGeneration;
 
-		json_t* p1thetaJ = json_object_get(rootJ, "p1_theta");
-		if (p1thetaJ) p1.theta = (float)json_real_value(p1thetaJ);
+	FlipMap() {
+		int count = 0;
+		for (int stride = MAP_COARSEST; stride >= 1; stride /= 2) {
+			for (int y = 0; y < MAP_SIZE; y += stride) {
+				for (int x = 0; x < MAP_SIZE; x += stride) {
+					if (pixelStride(x, y) == stride)
+						order[count++] = y * MAP_SIZE + x;
+				}
+			}
+		}
+		for (int c = 0; c < MAP_SIZE * MAP_SIZE / MAP_CHUNK; c++) {
+			chunkDone[c] = 0;
+		}
+		currentGeneration = 0;
+		clearPixels();
 
-		json_t* p1velJ = json_object_get(rootJ, "p1_vel");
-		if (p1velJ) p1.vel = (float)json_real_value(p1velJ);
+		const int threads = clamp((int)std::thread::hardware_concurrency() - 1, 1, MAP_THREADS);
+		for (int i = 0; i < threads; i++) {
+			workers.push_back(std::thread(&FlipMap::work, this));
+		}
 	}
 
-	float pixelToVoltage(uchar pixel) {
-		return ((float)pixel / 255) * VOLT_MAX;
+	~FlipMap() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			running = false;
+			currentGeneration = ++generation;
+		}
+		wake.notify_all();
+		for (size_t i = 0; i < workers.size(); i++) {
+			workers[i].join();
+		}
 	}
 
-	void kickPendulums() {
-		p0.theta = (PI*0.5f) + (random::uniform() * PI);
-		p1.theta = 0.0f + (random::uniform() * PI * 2);
-		if (kickMode == KickMode::ClearVelocity) {
-			p0.vel = 0;
-			p1.vel = 0;
-			p0.acc = 0;
-			p1.acc = 0;
+	// The refinement pass a pixel belongs to: the largest power of two, up to MAP_COARSEST, dividing both coordinates.
+	static int pixelStride(int x, int y) {
+		int stride = MAP_COARSEST;
+		while (stride > 1 && (x % stride != 0 || y % stride != 0)) {
+			stride /= 2;
 		}
+		return stride;
 	}
 
-	void process(const ProcessArgs& args) override {
-        // Audio signals are typically +/-5V
-        // https://vcvrack.com/manual/VoltageStandards.html
-		frame++;
-
-		if (frame % 4 == 0) {
-			float length_ratio = params[LENGTH_RATIO_PARAM].getValue() + (inputs[RATIO_IN].getVoltageSum() / VOLT_MAX);
-			clamp(length_ratio, 0.1f , 0.9f);
-			float dt = args.sampleTime * (params[GRAVITY_PARAM].getValue() + (inputs[GRAVITY_IN].getVoltageSum() / VOLT_MAX));
-			clamp(dt, 0.f, 6.f);
-			float damping_in = (params[DAMPING_PARAM].getValue() + inputs[DAMPING_IN].getVoltageSum());
-			float damping = (damping_in > 0.1f) ? 0.99999f : 1.0f;
-
-			if (kickTrigger.process(inputs[KICK_TRIG_IN].getVoltage() + params[KICK_PARAM].getValue()))
-			{
-				kickPendulums();
-			}
-
-			p0.length = length_ratio;
-			p1.length = 1.0f - length_ratio;
-			p0.mass = p0.length * 10.f;
-			p1.mass = p1.length * 10.f;
-			
-			if (integrationMode == IntegrationMode::RK4) {
-				// initial conditions (from last frame)
-				float x[4] = {p0.theta, p0.vel, p1.theta, p1.vel};
-				dsp::stepRK4(0.f, dt, x, 4, [&](float time, float x[4], float dxdt[4]){
-					Pendulum _p0 = p0;
-					_p0.theta = x[0];
-					_p0.vel = x[1];
-					Pendulum _p1 = p1;
-					_p1.theta = x[2];
-					_p1.vel = x[3];
-
-					dxdt[0] = _p0.vel;
-					dxdt[2] = _p1.vel;
-					Derivative(_p0, _p1, dxdt[1], dxdt[3]);
-				});
-				
-				p0.theta = x[0];
-				p0.vel = x[1] * damping;
-				p1.theta = x[2];
-				p1.vel = x[3] * damping;
-			} else if (integrationMode == IntegrationMode::Euler) {
-				Derivative(p0, p1, p0.acc, p1.acc);
-				p0.vel += p0.acc * dt;
-				p1.vel += p1.acc * dt;
-				p0.vel *= damping;
-				p1.vel *= damping;
-				p0.theta += p0.vel * dt;
-				p1.theta += p1.vel * dt;
-			}
-
-			if (p0.theta > PI*2) 
-				p0.theta -= PI*2;
-			if (p0.theta < PI*2)
-				p0.theta += PI*2;
-			if (p1.theta > PI * 2)
-				p1.theta -= PI * 2;
-			if (p1.theta < PI * 2)
-				p1.theta += PI * 2;
-
-			// Output pendulum 1 x position.
-			p0.x = 0.0f + (p0.length * std::sin(p0.theta));
-			p0.y = 0.0f - (p0.length * std::cos(p0.theta)) * -1.0f;
-			p1.x = p0.x + (p1.length * std::sin(p1.theta));
-			p1.y = p0.y - (p1.length * std::cos(p1.theta)) * -1.0f;
-			outputs[POLY_CHAOS_OUTPUT].setVoltage(p1.x * VOLT_FIVE, 0);
-			outputs[POLY_CHAOS_OUTPUT].setVoltage(p1.y * -1.f * VOLT_FIVE, 1);
-
-			float theta1 = std::fmod(p0.theta + PI, PI*2);
-			if (theta1 < 0) theta1 += PI*2;
-			theta1 -= PI;
-
-			float theta2 = std::fmod(p1.theta + PI, PI * 2);
-			if (theta2 < 0)
-				theta2 += PI * 2;
-			theta2 -= PI;
-
-			outputs[POLY_CHAOS_OUTPUT].setVoltage((theta1 / PI) * VOLT_FIVE, 2);
-			outputs[POLY_CHAOS_OUTPUT].setVoltage((theta2 / PI) * VOLT_FIVE, 3);
-			outputs[POLY_CHAOS_OUTPUT].setVoltage(p0.vel, 4);
-			outputs[POLY_CHAOS_OUTPUT].setVoltage(p1.vel, 5);
-
-			// distance from center
-			float dist = std::sqrt(p1.x*p1.x + p1.y*p1.y);
-			outputs[POLY_CHAOS_OUTPUT].setVoltage(dist * VOLT_MAX, 6);
-
-			outputs[POLY_CHAOS_OUTPUT].setChannels(7);
+	void clearPixels() {
+		std::memset(pixels, 0, sizeof(pixels));
+		std::memset(paintedStride, 0xFF, sizeof(paintedStride));
+		std::memset(chunkPainted, 0, sizeof(chunkPainted));
+		chunksPainted = 0;
+		dirty = true;
+	}
+
+	// Whether every chunk of the current render is on screen.
+	bool finished() const {
+		return chunksPainted == MAP_SIZE * MAP_SIZE / MAP_CHUNK;
+	}
+
+	// Starts a fresh render of the given links. Whatever the workers were doing is abandoned after its current batch,
+	// without waiting for them here.
+	void restart(const ChaosModule::Pendulum* links, int n) {
+		float shortest = links[0].length;
+		for (int i = 0; i < n; i++) {
+			shortest = std::min(shortest, links[i].length);
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			currentGeneration = ++generation;
+			render.generation = generation;
+			render.chain.set(links, n);
+			render.numLinks = n;
+			// Short links swing faster, so the step shrinks as in the live oscillator.
+			render.dt = 1.f / (SMALL_SWING_FREQ * MAP_STEPS_PER_CYCLE) * std::sqrt(shortest / 0.5f);
+			nextChunk = 0;
+		}
+		wake.notify_all();
+		clearPixels();
+	}
+
+	void work() {
+		Render current;
+		float times[MAP_CHUNK];
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			wake.wait(lock, [this] { return !running || nextChunk < MAP_SIZE * MAP_SIZE / MAP_CHUNK; });
+			if (!running)
+				return;
+			const int c = nextChunk++;
+			if (current.generation != render.generation)
+				current = render;
+			lock.unlock();
+
+			const bool complete = renderChunk(c, current, times);
+
+			// A chunk a restart overtook is dropped; the new render hands it out again.
+			lock.lock();
+			if (complete && current.generation == render.generation) {
+				for (int k = 0; k < MAP_CHUNK; k++) {
+					flipTime[order[c * MAP_CHUNK + k]] = times[k];
+				}
+				chunkDone[c].store(current.generation + 1, std::memory_order_release);
+			}
+		}
+	}
+
+	// Integrates one chunk's chains four at a time until every lane has flipped or run out of time, writing their
+	// flip times in render order. Returns false if a restart cut it short.
+	bool renderChunk(int chunk, const Render& current, float* times) {
+		const ChaosModule::ChainBatch batch = {&current.chain, current.numLinks};
+		const int n = current.numLinks;
+		const float dt = current.dt;
+		const int steps = (int)(MAP_MAX_CYCLES / (SMALL_SWING_FREQ * dt));
+		for (int first = chunk * MAP_CHUNK; first < (chunk + 1) * MAP_CHUNK; first += 4) {
+			if (currentGeneration.load(std::memory_order_relaxed) != current.generation)
+				return false;
+
+			simd::float_4 theta1;
+			simd::float_4 theta2;
+			for (int lane = 0; lane < 4; lane++) {
+				const int pixel = order[first + lane];
+				theta1[lane] = ((pixel % MAP_SIZE + 0.5f) / MAP_SIZE * 2.f - 1.f) * (float)PI;
+				theta2[lane] = (1.f - (pixel / MAP_SIZE + 0.5f) / MAP_SIZE * 2.f) * (float)PI;
+			}
+			simd::float_4 x[2 * MAX_LINKS];
+			for (int i = 0; i < n; i++) {
+				x[i] = (i == 0) ? theta1 : theta2;
+				x[n + i] = 0.f;
+			}
+
+			simd::float_4 flipped = 0.f;
+			simd::float_4 time = -1.f;
+			for (int step = 1; step <= steps; step++) {
+				ode::stepRK4(batch, dt, x);
+				simd::float_4 over = 0.f;
+				for (int i = 0; i < n; i++) {
+					over = over | (simd::fabs(x[i]) > (float)PI);
+				}
+				time = simd::ifelse(over & ~flipped, step * dt * SMALL_SWING_FREQ, time);
+				flipped = flipped | over;
+				if (simd::movemask(flipped) == 0xF)
+					break;
+			}
+			for (int lane = 0; lane < 4; lane++) {
+				times[first - chunk * MAP_CHUNK + lane] = time[lane];
+			}
+		}
+		return true;
+	}
+
+	// Paints every chunk finished since the last call, each pixel filling the block of its refinement pass that
+	// no finer pixel has claimed yet. Fast flips are red, slow ones blue; chains that never flip stay clear.
+	void paint() {
+		const unsigned done = generation + 1;
+		for (int c = 0; c < MAP_SIZE * MAP_SIZE / MAP_CHUNK; c++) {
+			if (chunkPainted[c] || chunkDone[c].load(std::memory_order_acquire) != done)
+				continue;
+			chunkPainted[c] = true;
+			chunksPainted++;
+			dirty = true;
+			for (int k = c * MAP_CHUNK; k < (c + 1) * MAP_CHUNK; k++) {
+				const int pixel = order[k];
+				const int px = pixel % MAP_SIZE;
+				const int py = pixel / MAP_SIZE;
+				const int stride = pixelStride(px, py);
+				unsigned char rgba[4] = {0, 0, 0, 0};
+				if (flipTime[pixel] >= 0.f) {
+					const float t = std::log2(1.f + flipTime[pixel]) / std::log2(1.f + MAP_MAX_CYCLES);
+					rgba[0] = (unsigned char)(0xED + (0x7E - 0xED) * t);
+					rgba[1] = (unsigned char)(0x1B + (0xD3 - 0x1B) * t);
+					rgba[2] = (unsigned char)(0x31 + (0xEF - 0x31) * t);
+					rgba[3] = 0xC0;
+				}
+				for (int y = py; y < std::min(py + stride, MAP_SIZE); y++) {
+					for (int x = px; x < std::min(px + stride, MAP_SIZE); x++) {
+						if (paintedStride[y * MAP_SIZE + x] <= stride)
+							continue;
+						paintedStride[y * MAP_SIZE + x] = stride;
+						std::memcpy(&pixels[(y * MAP_SIZE + x) * 4], rgba, 4);
+					}
+				}
+			}
 		}
 	}
 };
 
 struct PendulumWidget : OpaqueWidget {
 	ChaosModule* module;
+	// Poses drained from the module, oldest first, kept as a circular history for the trail.
+	ChaosModule::PendulumPose trail[TRAIL_LENGTH];
+	int trailEnd = 0;
+	int trailSize = 0;
+	// Only exists while the map is shown. mapLengths are the link lengths it was last started for, as the audio
+	// thread last posed them; settleLengths are the newest different ones, held for settleFrames frames so far.
+	FlipMap* flipMap = NULL;
+	int mapImage = 0;
+	float mapLengths[MAX_LINKS] = {};
+	int mapNumLinks = 0;
+	float settleLengths[MAX_LINKS] = {};
+	int settleFrames = 0;
+
+	~PendulumWidget() {
+		delete flipMap;
+		if (mapImage)
+			nvgDeleteImage(APP->window->vg, mapImage);
+	}
+
+	void drainPoses() {
+		while (!module->poseBuffer.empty()) {
+			trail[trailEnd] = module->poseBuffer.shift();
+			trailEnd = (trailEnd + 1) % TRAIL_LENGTH;
+			trailSize = std::min(trailSize + 1, TRAIL_LENGTH);
+		}
+	}
+
+	// Follows the chain in the newest pose, so the map never reads the links the audio thread is stepping.
+	void drawMap(const DrawArgs &args) {
+		const ChaosModule::PendulumPose& pose = trail[(trailEnd - 1 + TRAIL_LENGTH) % TRAIL_LENGTH];
+		if (!module->showMap || trailSize == 0 || !pose.isChain) {
+			delete flipMap;
+			flipMap = NULL;
+			return;
+		}
+		if (!flipMap) {
+			flipMap = new FlipMap();
+			mapNumLinks = 0;
+		}
+
+		// A new link count restarts the map straight away. New lengths, which a modulated ratio brings every frame,
+		// restart it once they have held for MAP_SETTLE_FRAMES frames or the map of the old ones has finished, so it
+		// always gets to complete.
+		bool restart = (pose.numLinks != mapNumLinks);
+		if (!restart) {
+			bool changed = false;
+			bool settling = true;
+			for (int i = 0; i < pose.numLinks; i++) {
+				changed = changed || (pose.length[i] != mapLengths[i]);
+				settling = settling && (pose.length[i] == settleLengths[i]);
+			}
+			if (!changed) {
+				settleFrames = 0;
+			} else if (!settling) {
+				std::copy(pose.length, pose.length + pose.numLinks, settleLengths);
+				settleFrames = 0;
+			} else {
+				settleFrames++;
+			}
+			restart = changed && (settleFrames >= MAP_SETTLE_FRAMES || flipMap->finished());
+		}
+		if (restart) {
+			settleFrames = 0;
+			ChaosModule::Pendulum links[MAX_LINKS];
+			mapNumLinks = pose.numLinks;
+			for (int i = 0; i < mapNumLinks; i++) {
+				mapLengths[i] = pose.length[i];
+				links[i].length = pose.length[i];
+				links[i].mass = pose.mass[i];
+			}
+			flipMap->restart(links, mapNumLinks);
+		}
+
+		flipMap->paint();
+		if (!mapImage)
+			mapImage = nvgCreateImageRGBA(args.vg, MAP_SIZE, MAP_SIZE, 0, flipMap->pixels);
+		else if (flipMap->dirty)
+			nvgUpdateImage(args.vg, mapImage, flipMap->pixels);
+		flipMap->dirty = false;
+
+		// Clipped to the display's round window.
+		nvgBeginPath(args.vg);
+		nvgCircle(args.vg, box.size.x / 2, box.size.y / 2, box.size.x / 2);
+		nvgFillPaint(args.vg, nvgImagePattern(args.vg, 0, 0, box.size.x, box.size.y, 0, mapImage, 1.0f));
+		nvgFill(args.vg);
+	}
+
+	// Clicking the map drops the live chain from the angles under the cursor, at the audio thread's next tick.
+	// Clicks beyond the few it hasn't picked up yet are dropped.
+	void onButton(const event::Button &e) override {
+		if (flipMap && e.action == GLFW_PRESS && e.button == GLFW_MOUSE_BUTTON_LEFT && !module->kickRequests.full()) {
+			const float theta1 = (e.pos.x / box.size.x * 2.f - 1.f) * (float)PI;
+			const float theta2 = (1.f - e.pos.y / box.size.y * 2.f) * (float)PI;
+			ChaosModule::KickRequest request = {true, theta1, theta2};
+			module->kickRequests.push(request);
+		}
+		OpaqueWidget::onButton(e);
+	}
 
 	void draw(const DrawArgs &args) override {
 		OpaqueWidget::draw(args);
 		if (module) {
+			drainPoses();
+			drawMap(args);
+			if (trailSize == 0)
+				return;
+
 			const float maxLen = 80.0f;
 			const float center = 105.f;
-			float p0_x = (module->p0.x * maxLen) + center;
-			float p0_y = (module->p0.y * maxLen) + center;
-			float p1_x = (module->p1.x * maxLen) + center;
-			float p1_y = (module->p1.y * maxLen) + center;
 
-			nvgBeginPath(args.vg);
+			// Path of the tip, fading out towards the oldest pose.
 			nvgStrokeWidth(args.vg, 1);
-			nvgStrokeColor(args.vg, nvgRGBA(0xED, 0x1B, 0x31, 0xFF));
-			nvgMoveTo(args.vg, center, center);
-			nvgLineTo(args.vg, p0_x, p0_y);
-			nvgCircle(args.vg, p0_x, p0_y, module->p0.mass);
-			nvgClosePath(args.vg);
-			nvgStroke(args.vg);
-
-			nvgBeginPath(args.vg);
-			nvgStrokeWidth(args.vg, 1);
-			nvgStrokeColor(args.vg, nvgRGBA(0x7E, 0xD3, 0xEF, 0xFF));
-			nvgMoveTo(args.vg, p0_x, p0_y);
-			nvgLineTo(args.vg, p1_x, p1_y);
-			nvgCircle(args.vg, p1_x, p1_y, module->p1.mass);
-			nvgClosePath(args.vg);
-			nvgStroke(args.vg);
+			for (int i = 1; i < trailSize; i++) {
+				const ChaosModule::PendulumPose& from = trail[(trailEnd - trailSize + i - 1 + TRAIL_LENGTH) % TRAIL_LENGTH];
+				const ChaosModule::PendulumPose& to = trail[(trailEnd - trailSize + i + TRAIL_LENGTH) % TRAIL_LENGTH];
+				if (from.numLinks != to.numLinks || from.isChain != to.isChain)
+					continue;
+				const int tip = to.numLinks - 1;
+				nvgBeginPath(args.vg);
+				nvgStrokeColor(args.vg, nvgRGBA(0x7E, 0xD3, 0xEF, (unsigned char)(0xA0 * i / trailSize)));
+				nvgMoveTo(args.vg, (from.x[tip] * maxLen) + center, (from.y[tip] * maxLen) + center);
+				nvgLineTo(args.vg, (to.x[tip] * maxLen) + center, (to.y[tip] * maxLen) + center);
+				nvgStroke(args.vg);
+			}
+
+			const ChaosModule::PendulumPose& pose = trail[(trailEnd - 1 + TRAIL_LENGTH) % TRAIL_LENGTH];
+			if (!pose.isChain) {
+				nvgBeginPath(args.vg);
+				nvgStrokeColor(args.vg, nvgRGBA(0xED, 0x1B, 0x31, 0xFF));
+				nvgCircle(args.vg, (pose.x[0] * maxLen) + center, (pose.y[0] * maxLen) + center, pose.mass[0]);
+				nvgStroke(args.vg);
+				return;
+			}
+
+			// Links alternate red and blue, starting from the pivot.
+			float from_x = center;
+			float from_y = center;
+			for (int i = 0; i < pose.numLinks; i++) {
+				float to_x = (pose.x[i] * maxLen) + center;
+				float to_y = (pose.y[i] * maxLen) + center;
+
+				nvgBeginPath(args.vg);
+				nvgStrokeWidth(args.vg, 1);
+				if (i % 2 == 0)
+					nvgStrokeColor(args.vg, nvgRGBA(0xED, 0x1B, 0x31, 0xFF));
+				else
+					nvgStrokeColor(args.vg, nvgRGBA(0x7E, 0xD3, 0xEF, 0xFF));
+				nvgMoveTo(args.vg, from_x, from_y);
+				nvgLineTo(args.vg, to_x, to_y);
+				nvgCircle(args.vg, to_x, to_y, pose.mass[i]);
+				nvgClosePath(args.vg);
+				nvgStroke(args.vg);
+
+				from_x = to_x;
+				from_y = to_y;
+			}
 		}
 	}
 };
@@ -308,12 +2681,16 @@ struct ChaosWidget : ModuleWidget {
 
 		const float poly_out_x = 187.8;
 		const float poly_out_y = 345.2;
+		const float section_out_x = 150.0;
+		const float section_out_y = 345.2;
+		const float scrub_x = 109.4;
+		const float scrub_y = 345.2;
 
 		const float scope_x = 7.5;
 		const float scope_y = 122.0;
 
 		addParam(createParamCentered<RoundBlackKnob>((Vec(col01_x, row01_y)), module, ChaosModule::GRAVITY_PARAM));
-		addParam(createParamCentered<CKD6>((Vec(col02_x, row01_y)), module, ChaosModule::DAMPING_PARAM));
+		addParam(createParamCentered<RoundBlackKnob>((Vec(col02_x, row01_y)), module, ChaosModule::DAMPING_PARAM));
 		addParam(createParamCentered<RoundBlackKnob>((Vec(col03_x, row01_y)), module, ChaosModule::LENGTH_RATIO_PARAM));
 		addParam(createParamCentered<CKD6>((Vec(kick_btn_x, kick_btn_y)), module, ChaosModule::KICK_PARAM));
 
@@ -321,8 +2698,10 @@ struct ChaosWidget : ModuleWidget {
 		addInput(createInputCentered<PJ301MPort>((Vec(col02_x, row02_y)), module, ChaosModule::DAMPING_IN));
 		addInput(createInputCentered<PJ301MPort>((Vec(col03_x, row02_y)), module, ChaosModule::RATIO_IN));
 		addInput(createInputCentered<PJ301MPort>((Vec(kick_x, kick_y)), module, ChaosModule::KICK_TRIG_IN));
+		addInput(createInputCentered<PJ301MPort>((Vec(scrub_x, scrub_y)), module, ChaosModule::SCRUB_IN));
 
 		addOutput(createOutputCentered<PJ301MPort>((Vec(poly_out_x, poly_out_y)), module, ChaosModule::POLY_CHAOS_OUTPUT));
+		addOutput(createOutputCentered<PJ301MPort>((Vec(section_out_x, section_out_y)), module, ChaosModule::SECTION_TRIG_OUTPUT));
 		
 
 		{
@@ -338,7 +2717,10 @@ struct ChaosWidget : ModuleWidget {
 		ChaosModule *module;
 		void onAction(const event::Action &e) override {
 			MenuItem::onAction(e);
-			module->kickPendulums();
+			if (!module->kickRequests.full()) {
+				ChaosModule::KickRequest request = {false, 0.f, 0.f};
+				module->kickRequests.push(request);
+			}
 		}
 	};
 
@@ -350,6 +2732,184 @@ struct ChaosWidget : ModuleWidget {
 		}
 	};
 
+	struct ChaosRateDividerItem : MenuItem {
+		ChaosModule *module;
+		int rateDivider;
+		void onAction(const event::Action& e) override {
+			module->rateDivider = rateDivider;
+		}
+	};
+
+	struct ChaosRateDividerMenuItem : MenuItem {
+		ChaosModule *module;
+		Menu *createChildMenu() override {
+			Menu *menu = new Menu;
+			for (int divider = 1; divider <= MAX_RATE_DIVIDER; divider *= 2) {
+				ChaosRateDividerItem* item = createMenuItem<ChaosRateDividerItem>(string::f("1/%d", divider));
+				item->rightText = CHECKMARK(module->rateDivider == divider);
+				item->module = module;
+				item->rateDivider = divider;
+				menu->addChild(item);
+			}
+			return menu;
+		}
+	};
+
+	struct ChaosRateModeItem : MenuItem {
+		ChaosModule *module;
+		ChaosModule::RateMode mode;
+		void onAction(const event::Action& e) override {
+			module->rateMode = mode;
+		}
+	};
+
+	struct ChaosOversampleItem : MenuItem {
+		ChaosModule *module;
+		int oversample;
+		void onAction(const event::Action& e) override {
+			module->oversample = oversample;
+		}
+	};
+
+	struct ChaosOversampleMenuItem : MenuItem {
+		ChaosModule *module;
+		Menu *createChildMenu() override {
+			Menu *menu = new Menu;
+			for (int factor = 1; factor <= MAX_OVERSAMPLE; factor *= 2) {
+				ChaosOversampleItem* item = createMenuItem<ChaosOversampleItem>(string::f("%dx", factor));
+				item->rightText = CHECKMARK(module->oversample == factor);
+				item->module = module;
+				item->oversample = factor;
+				menu->addChild(item);
+			}
+			return menu;
+		}
+	};
+
+	struct ChaosLinksItem : MenuItem {
+		ChaosModule *module;
+		int numLinks;
+		void onAction(const event::Action& e) override {
+			module->linksRequest.store(numLinks);
+		}
+	};
+
+	struct ChaosLinksMenuItem : MenuItem {
+		ChaosModule *module;
+		Menu *createChildMenu() override {
+			Menu *menu = new Menu;
+			for (int n = MIN_LINKS; n <= MAX_LINKS; n++) {
+				ChaosLinksItem* item = createMenuItem<ChaosLinksItem>(string::f("%d", n));
+				item->rightText = CHECKMARK(module->numLinks == n);
+				item->module = module;
+				item->numLinks = n;
+				menu->addChild(item);
+			}
+			return menu;
+		}
+	};
+
+	struct ChaosOutputLayoutItem : MenuItem {
+		ChaosModule *module;
+		ChaosModule::OutputLayout layout;
+		void onAction(const event::Action& e) override {
+			module->outputLayout = layout;
+		}
+	};
+
+	struct ChaosSystemItem : MenuItem {
+		ChaosModule *module;
+		ChaosModule::SystemType type;
+		void onAction(const event::Action& e) override {
+			module->systemRequest.store(type);
+		}
+	};
+
+	struct ChaosSectionDirectionItem : MenuItem {
+		ChaosModule *module;
+		ChaosModule::SectionDirection direction;
+		void onAction(const event::Action& e) override {
+			module->sectionDirection = direction;
+		}
+	};
+
+	struct ChaosRecordItem : MenuItem {
+		ChaosModule *module;
+		void onAction(const event::Action& e) override {
+			if (module->recorderMode == ChaosModule::RecorderMode::RecorderRecording)
+				module->stopRecorder();
+			else
+				module->armRecorder();
+		}
+	};
+
+	struct ChaosPlayItem : MenuItem {
+		ChaosModule *module;
+		void onAction(const event::Action& e) override {
+			if (module->recorderMode == ChaosModule::RecorderMode::RecorderPlaying)
+				module->stopRecorder();
+			else
+				module->playRecorder();
+		}
+	};
+
+	struct ChaosRecordSecondsItem : MenuItem {
+		ChaosModule *module;
+		int seconds;
+		void onAction(const event::Action& e) override {
+			module->recordSeconds = seconds;
+			// A take in progress restarts at the new length; any other starts at it when it is armed.
+			if (module->recorderMode == ChaosModule::RecorderMode::RecorderRecording)
+				module->armRecorder();
+		}
+	};
+
+	struct ChaosRecordSecondsMenuItem : MenuItem {
+		ChaosModule *module;
+		Menu *createChildMenu() override {
+			Menu *menu = new Menu;
+			const int seconds[] = {5, 10, 20, 40, MAX_RECORD_SECONDS};
+			for (int i = 0; i < 5; i++) {
+				ChaosRecordSecondsItem* item = createMenuItem<ChaosRecordSecondsItem>(string::f("%d s", seconds[i]));
+				item->rightText = CHECKMARK(module->recordSeconds == seconds[i]);
+				item->module = module;
+				item->seconds = seconds[i];
+				menu->addChild(item);
+			}
+			return menu;
+		}
+	};
+
+	struct ChaosShowMapItem : MenuItem {
+		ChaosModule *module;
+		void onAction(const event::Action& e) override {
+			module->showMap = !module->showMap;
+		}
+	};
+
+	struct ChaosEnergyHoldItem : MenuItem {
+		ChaosModule *module;
+		void onAction(const event::Action& e) override {
+			module->energyHold = !module->energyHold;
+		}
+	};
+
+	struct ChaosDiagnosticsItem : MenuItem {
+		ChaosModule *module;
+		void onAction(const event::Action& e) override {
+			module->shadowValid = false;
+			module->diagnostics = !module->diagnostics;
+		}
+	};
+
+	struct ChaosVoiceOutputItem : MenuItem {
+		ChaosModule *module;
+		ChaosModule::VoiceOutput output;
+		void onAction(const event::Action& e) override {
+			module->voiceOutput = output;
+		}
+	};
+
 	struct ChaosKickModeItem : MenuItem {
 		ChaosModule *module;
 		ChaosModule::KickMode mode;
@@ -390,6 +2950,120 @@ struct ChaosWidget : ModuleWidget {
 		euler_item->module = module;
 		euler_item->mode = ChaosModule::IntegrationMode::Euler;
 		menu->addChild(euler_item);
+
+		ChaosEnergyHoldItem* hold_item = createMenuItem<ChaosEnergyHoldItem>("Hold energy (bends the dynamics)");
+		hold_item->rightText = CHECKMARK(module->energyHold);
+		hold_item->module = module;
+		menu->addChild(hold_item);
+
+		menu->addChild(createMenuLabel("Rate"));
+
+		ChaosRateModeItem* lfo_item = createMenuItem<ChaosRateModeItem>("LFO (control rate)");
+		lfo_item->rightText = CHECKMARK(module->rateMode == ChaosModule::RateMode::ControlRate);
+		lfo_item->module = module;
+		lfo_item->mode = ChaosModule::RateMode::ControlRate;
+		menu->addChild(lfo_item);
+
+		ChaosRateModeItem* osc_item = createMenuItem<ChaosRateModeItem>("Oscillator (audio rate, V/oct)");
+		osc_item->rightText = CHECKMARK(module->rateMode == ChaosModule::RateMode::AudioRate);
+		osc_item->module = module;
+		osc_item->mode = ChaosModule::RateMode::AudioRate;
+		menu->addChild(osc_item);
+
+		ChaosRateDividerMenuItem* divider_item = createMenuItem<ChaosRateDividerMenuItem>("Control rate (at 44.1 kHz)", RIGHT_ARROW);
+		divider_item->module = module;
+		menu->addChild(divider_item);
+
+		ChaosOversampleMenuItem* oversample_item = createMenuItem<ChaosOversampleMenuItem>("Oscillator oversampling", RIGHT_ARROW);
+		oversample_item->module = module;
+		menu->addChild(oversample_item);
+
+		menu->addChild(createMenuLabel("System"));
+
+		const char* systemNames[ChaosModule::NUM_SYSTEMS] = {"Pendulum chain", "Lorenz", "Rössler", "Chua", "Thomas"};
+		for (int i = 0; i < ChaosModule::NUM_SYSTEMS; i++) {
+			ChaosSystemItem* system_item = createMenuItem<ChaosSystemItem>(systemNames[i]);
+			system_item->rightText = CHECKMARK(module->systemType == i);
+			system_item->module = module;
+			system_item->type = (ChaosModule::SystemType)i;
+			menu->addChild(system_item);
+		}
+
+		menu->addChild(createMenuLabel("Chain"));
+
+		ChaosShowMapItem* map_item = createMenuItem<ChaosShowMapItem>("Flip-time map (click to drop the chain)");
+		map_item->rightText = CHECKMARK(module->showMap);
+		map_item->module = module;
+		menu->addChild(map_item);
+
+		ChaosLinksMenuItem* links_item = createMenuItem<ChaosLinksMenuItem>("Links", RIGHT_ARROW);
+		links_item->module = module;
+		menu->addChild(links_item);
+
+		ChaosOutputLayoutItem* classic_item = createMenuItem<ChaosOutputLayoutItem>("Classic outputs");
+		classic_item->rightText = CHECKMARK(module->outputLayout == ChaosModule::OutputLayout::ClassicLayout);
+		classic_item->module = module;
+		classic_item->layout = ChaosModule::OutputLayout::ClassicLayout;
+		menu->addChild(classic_item);
+
+		ChaosOutputLayoutItem* angle_item = createMenuItem<ChaosOutputLayoutItem>("Link angles and velocities");
+		angle_item->rightText = CHECKMARK(module->outputLayout == ChaosModule::OutputLayout::AngleLayout);
+		angle_item->module = module;
+		angle_item->layout = ChaosModule::OutputLayout::AngleLayout;
+		menu->addChild(angle_item);
+
+		ChaosOutputLayoutItem* position_item = createMenuItem<ChaosOutputLayoutItem>("Link positions");
+		position_item->rightText = CHECKMARK(module->outputLayout == ChaosModule::OutputLayout::PositionLayout);
+		position_item->module = module;
+		position_item->layout = ChaosModule::OutputLayout::PositionLayout;
+		menu->addChild(position_item);
+
+		menu->addChild(createMenuLabel("Outputs"));
+
+		ChaosDiagnosticsItem* diagnostics_item = createMenuItem<ChaosDiagnosticsItem>("Energy, momentum and Lyapunov channels");
+		diagnostics_item->rightText = CHECKMARK(module->diagnostics);
+		diagnostics_item->module = module;
+		menu->addChild(diagnostics_item);
+
+		menu->addChild(createMenuLabel("Per-voice output (polyphonic CV)"));
+
+		const char* voiceOutputNames[] = {"Tip x", "Tip y", "Tip distance", "First link angle", "Last link angle"};
+		for (int i = 0; i <= ChaosModule::VoiceOutput::VoiceLastAngle; i++) {
+			ChaosVoiceOutputItem* voice_output_item = createMenuItem<ChaosVoiceOutputItem>(voiceOutputNames[i]);
+			voice_output_item->rightText = CHECKMARK(module->voiceOutput == i);
+			voice_output_item->module = module;
+			voice_output_item->output = (ChaosModule::VoiceOutput)i;
+			menu->addChild(voice_output_item);
+		}
+
+		menu->addChild(createMenuLabel("Recorder (LFO only)"));
+
+		ChaosRecordItem* record_item = createMenuItem<ChaosRecordItem>("Record");
+		record_item->rightText = CHECKMARK(module->recorderMode == ChaosModule::RecorderMode::RecorderRecording);
+		record_item->disabled = (module->rateMode == ChaosModule::RateMode::AudioRate);
+		record_item->module = module;
+		menu->addChild(record_item);
+
+		ChaosPlayItem* play_item = createMenuItem<ChaosPlayItem>("Play back (loop, or scrub by CV)");
+		play_item->rightText = CHECKMARK(module->recorderMode == ChaosModule::RecorderMode::RecorderPlaying);
+		play_item->disabled = (module->rateMode == ChaosModule::RateMode::AudioRate || module->recordFrames < 2);
+		play_item->module = module;
+		menu->addChild(play_item);
+
+		ChaosRecordSecondsMenuItem* record_seconds_item = createMenuItem<ChaosRecordSecondsMenuItem>("Record length", RIGHT_ARROW);
+		record_seconds_item->module = module;
+		menu->addChild(record_seconds_item);
+
+		menu->addChild(createMenuLabel("Section triggers"));
+
+		const char* directionNames[] = {"Rising crossings", "Falling crossings", "Both ways"};
+		for (int i = 0; i <= ChaosModule::SectionDirection::SectionBothWays; i++) {
+			ChaosSectionDirectionItem* direction_item = createMenuItem<ChaosSectionDirectionItem>(directionNames[i]);
+			direction_item->rightText = CHECKMARK(module->sectionDirection == i);
+			direction_item->module = module;
+			direction_item->direction = (ChaosModule::SectionDirection)i;
+			menu->addChild(direction_item);
+		}
 	}
 };
 
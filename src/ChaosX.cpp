@@ -0,0 +1,152 @@
+#include "plugin.hpp"
+#include "chaos.hpp"
+
+#define VOLT_MAX 10.f
+#define VOLT_FIVE 5.f
+#define PI 3.14159265359
+#define TRIGGER_PULSE 1e-3f
+
+// Expander for CHAOS: placed directly either side of it, maps the state CHAOS publishes every sample to a jack per
+// quantity. Nothing is simulated here, so it costs CHAOS no extra integration.
+struct ChaosXModule : Module {
+	enum ParamIds {
+		NUM_PARAMS
+	};
+	enum InputIds {
+		NUM_INPUTS
+	};
+	enum OutputIds {
+		THETA_OUTPUT,
+		VEL_OUTPUT,
+		X_OUTPUT,
+		Y_OUTPUT,
+		ENERGY_OUTPUT,
+		SECTION_TRIG_OUTPUT,
+		FLIP_TRIG_OUTPUT,
+		KICK_TRIG_OUTPUT,
+		NUM_OUTPUTS
+	};
+	enum LightIds {
+		NUM_LIGHTS
+	};
+
+	// Rack's double buffers, one pair per side: CHAOS writes the producer message and Rack swaps the two.
+	ChaosBusMessage leftMessages[2] = {};
+	ChaosBusMessage rightMessages[2] = {};
+
+	dsp::PulseGenerator sectionPulses[MAX_SECTIONS];
+	dsp::PulseGenerator flipPulse;
+	dsp::PulseGenerator kickPulse;
+
+	ChaosXModule() {
+		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+		leftExpander.producerMessage = &leftMessages[0];
+		leftExpander.consumerMessage = &leftMessages[1];
+		rightExpander.producerMessage = &rightMessages[0];
+		rightExpander.consumerMessage = &rightMessages[1];
+	}
+
+	// The message from the CHAOS beside this module, or none.
+	const ChaosBusMessage* busMessage() const {
+		if (leftExpander.module && leftExpander.module->model == modelChaos)
+			return (const ChaosBusMessage*)leftExpander.consumerMessage;
+		if (rightExpander.module && rightExpander.module->model == modelChaos)
+			return (const ChaosBusMessage*)rightExpander.consumerMessage;
+		return NULL;
+	}
+
+	void silence() {
+		for (int i = 0; i < NUM_OUTPUTS; i++) {
+			outputs[i].setVoltage(0.f);
+			outputs[i].setChannels(1);
+		}
+	}
+
+	// Angles and velocities get a channel per link, positions one per bob. An attractor puts its x, y and z on X
+	// and leaves the chain's jacks at 0V.
+	void processState(const ChaosBusMessage& message) {
+		const int n = message.numLinks;
+		if (n == 0) {
+			for (int i = 0; i < ATTRACTOR_SIZE; i++) {
+				outputs[X_OUTPUT].setVoltage(message.point[i] * VOLT_FIVE, i);
+			}
+			outputs[X_OUTPUT].setChannels(ATTRACTOR_SIZE);
+			for (int id : {THETA_OUTPUT, VEL_OUTPUT, Y_OUTPUT, ENERGY_OUTPUT}) {
+				outputs[id].setVoltage(0.f);
+				outputs[id].setChannels(1);
+			}
+			return;
+		}
+		for (int i = 0; i < n; i++) {
+			outputs[THETA_OUTPUT].setVoltage((message.theta[i] / PI) * VOLT_FIVE, i);
+			outputs[VEL_OUTPUT].setVoltage(message.vel[i], i);
+			outputs[X_OUTPUT].setVoltage(message.x[i] * VOLT_FIVE, i);
+			outputs[Y_OUTPUT].setVoltage(message.y[i] * -1.f * VOLT_FIVE, i);
+		}
+		outputs[THETA_OUTPUT].setChannels(n);
+		outputs[VEL_OUTPUT].setChannels(n);
+		outputs[X_OUTPUT].setChannels(n);
+		outputs[Y_OUTPUT].setChannels(n);
+		outputs[ENERGY_OUTPUT].setVoltage(message.energy * VOLT_FIVE);
+	}
+
+	// Section crossings keep a trigger channel each, flips of any link and kicks one each.
+	void processEvents(const ChaosBusMessage& message, float sampleTime) {
+		const int sections = std::min(message.numSections, MAX_SECTIONS);
+		for (int i = 0; i < sections; i++) {
+			if (message.sectionEvents & (1u << i))
+				sectionPulses[i].trigger(TRIGGER_PULSE);
+			outputs[SECTION_TRIG_OUTPUT].setVoltage(sectionPulses[i].process(sampleTime) ? VOLT_MAX : 0.f, i);
+		}
+		outputs[SECTION_TRIG_OUTPUT].setChannels(std::max(sections, 1));
+		if (sections == 0)
+			outputs[SECTION_TRIG_OUTPUT].setVoltage(0.f);
+
+		if (message.flipEvents)
+			flipPulse.trigger(TRIGGER_PULSE);
+		if (message.kicked)
+			kickPulse.trigger(TRIGGER_PULSE);
+		outputs[FLIP_TRIG_OUTPUT].setVoltage(flipPulse.process(sampleTime) ? VOLT_MAX : 0.f);
+		outputs[KICK_TRIG_OUTPUT].setVoltage(kickPulse.process(sampleTime) ? VOLT_MAX : 0.f);
+	}
+
+	void process(const ProcessArgs& args) override {
+		const ChaosBusMessage* message = busMessage();
+		if (!message) {
+			silence();
+			return;
+		}
+		processState(*message);
+		processEvents(*message, args.sampleTime);
+	}
+};
+
+struct ChaosXWidget : ModuleWidget {
+	ChaosXWidget(ChaosXModule* module) {
+		setModule(module);
+		setPanel(APP->window->loadSvg(asset::plugin(pluginInstance, "res/ChaosX.svg")));
+
+		addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, 0)));
+		addChild(createWidget<ScrewSilver>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+
+		const float col01_x = 26.0;
+		const float col02_x = 64.0;
+
+		const float row01_y = 92.0;
+		const float row02_y = 160.0;
+		const float row03_y = 228.0;
+		const float row04_y = 296.0;
+
+		addOutput(createOutputCentered<PJ301MPort>((Vec(col01_x, row01_y)), module, ChaosXModule::THETA_OUTPUT));
+		addOutput(createOutputCentered<PJ301MPort>((Vec(col02_x, row01_y)), module, ChaosXModule::VEL_OUTPUT));
+		addOutput(createOutputCentered<PJ301MPort>((Vec(col01_x, row02_y)), module, ChaosXModule::X_OUTPUT));
+		addOutput(createOutputCentered<PJ301MPort>((Vec(col02_x, row02_y)), module, ChaosXModule::Y_OUTPUT));
+		addOutput(createOutputCentered<PJ301MPort>((Vec(col01_x, row03_y)), module, ChaosXModule::ENERGY_OUTPUT));
+		addOutput(createOutputCentered<PJ301MPort>((Vec(col02_x, row03_y)), module, ChaosXModule::SECTION_TRIG_OUTPUT));
+		addOutput(createOutputCentered<PJ301MPort>((Vec(col01_x, row04_y)), module, ChaosXModule::FLIP_TRIG_OUTPUT));
+		addOutput(createOutputCentered<PJ301MPort>((Vec(col02_x, row04_y)), module, ChaosXModule::KICK_TRIG_OUTPUT));
+	}
+};
+
+
+Model* modelChaosX = createModel<ChaosXModule, ChaosXWidget>("ChaosX");
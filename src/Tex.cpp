@@ -11,11 +11,127 @@
 typedef unsigned int uint;
 typedef unsigned char uchar;
 
+// Memory for lodepng while TEX loads an image. A load takes its buffers one after another from a single block, which
+// is kept for the next load, so loading image after image doesn't go back to the heap for each buffer. What doesn't
+// fit goes to the heap, and when the next load starts the block grows to what the last one used, up to MAX_BLOCK.
+struct DecodeArena {
+	// Each allocation is preceded by its size, padded so the memory after it stays aligned for any type.
+	static const size_t HEADER = 16;
+	static const size_t MAX_BLOCK = 4 << 20;
+
+	uchar* block = nullptr;
+	size_t capacity = 0;
+	size_t used = 0;
+	// The latest allocation in the block, which can grow or be given back in place.
+	uchar* last = nullptr;
+	// Bytes on the heap, and the most the block would have needed to hold everything.
+	size_t heap = 0;
+	size_t peak = 0;
+
+	~DecodeArena() {
+		std::free(block);
+	}
+
+	// Starts a load, after everything the previous one allocated has been freed.
+	void reset() {
+		const size_t wanted = peak < MAX_BLOCK ? peak : MAX_BLOCK;
+		if (wanted > capacity) {
+			std::free(block);
+			block = (uchar*)std::malloc(wanted);
+			capacity = block ? wanted : 0;
+		}
+		used = 0;
+		last = nullptr;
+		heap = 0;
+	}
+
+	LodePNGAllocator allocator() {
+		return {allocate, reallocate, deallocate, this};
+	}
+
+	static size_t footprint(size_t size) {
+		return HEADER + ((size + HEADER - 1) & ~(HEADER - 1));
+	}
+
+	bool owns(const uchar* memory) const {
+		return block && memory >= block && memory < block + capacity;
+	}
+
+	void grew() {
+		peak = std::max(peak, used + heap);
+	}
+
+	static void* allocate(void* user, size_t size) {
+		DecodeArena* arena = (DecodeArena*)user;
+		uchar* memory;
+		if (footprint(size) <= arena->capacity - arena->used) {
+			memory = arena->block + arena->used;
+			arena->used += footprint(size);
+			arena->last = memory;
+		} else {
+			memory = (uchar*)std::malloc(HEADER + size);
+			if (!memory)
+				return nullptr;
+			arena->heap += footprint(size);
+		}
+		*(size_t*)memory = size;
+		arena->grew();
+		return memory + HEADER;
+	}
+
+	static void* reallocate(void* user, void* ptr, size_t size) {
+		DecodeArena* arena = (DecodeArena*)user;
+		if (!ptr)
+			return allocate(user, size);
+		uchar* memory = (uchar*)ptr - HEADER;
+		const size_t oldSize = *(size_t*)memory;
+		if (size <= oldSize)
+			return ptr;
+		if (memory == arena->last && footprint(size) <= arena->capacity - (memory - arena->block)) {
+			arena->used = (memory - arena->block) + footprint(size);
+			*(size_t*)memory = size;
+			arena->grew();
+			return ptr;
+		}
+		if (!arena->owns(memory)) {
+			uchar* moved = (uchar*)std::realloc(memory, HEADER + size);
+			if (!moved)
+				return nullptr;
+			arena->heap += footprint(size) - footprint(oldSize);
+			*(size_t*)moved = size;
+			arena->grew();
+			return moved + HEADER;
+		}
+		void* moved = allocate(user, size);
+		if (!moved)
+			return nullptr;
+		std::memcpy(moved, ptr, oldSize);
+		deallocate(user, ptr);
+		return moved;
+	}
+
+	static void deallocate(void* user, void* ptr) {
+		DecodeArena* arena = (DecodeArena*)user;
+		if (!ptr)
+			return;
+		uchar* memory = (uchar*)ptr - HEADER;
+		if (!arena->owns(memory)) {
+			arena->heap -= footprint(*(size_t*)memory);
+			std::free(memory);
+		} else if (memory == arena->last) {
+			arena->used = memory - arena->block;
+			arena->last = nullptr;
+		}
+	}
+};
+
 struct TexModule : Module {
-	float pixels[IMG_WIDTH * IMG_WIDTH * NUM_IMG_CHANNELS];
-	uint pixelIndex[POLY_CHANNELS];
+	// The image as voltages, one plane per colour channel.
+	float pixels[NUM_IMG_CHANNELS][IMG_WIDTH * IMG_WIDTH];
+	uint pixelIndex[POLY_CHANNELS] = {};
 	std::string lastImagePath;
 	bool bImageLoaded = false;
+	DecodeArena arena;
 	dsp::BooleanTrigger autoMode;
 	dsp::SchmittTrigger autoTrigger;
 	uint frameIndex = 0;
@@ -78,38 +194,59 @@ struct TexModule : Module {
 			bAutoMode = json_integer_value(autoModeJ);
 	}
 
-	float pixelToVoltage(uchar pixel) {
-		return ((float)pixel / 255) * VOLT_MAX;
+	// lodepng's planar output, set to write each channel of a pixel straight into its plane of pixels as a voltage.
+	LodePNGPlanes voltagePlanes() {
+		LodePNGPlanes planes = {};
+		for (uint c = 0; c < NUM_IMG_CHANNELS; c++)
+			planes.planes[c] = pixels[c];
+		planes.floats = 1;
+		planes.scale = VOLT_MAX / 255;
+		planes.stride = IMG_WIDTH;
+		return planes;
+	}
+
+	// Decodes the image's top left IMG_WIDTH square, padding it with black if the image is smaller. Only the rows down
+	// to the square's last are decompressed, and only its columns converted to RGB.
+	static uint decodeCropped(const std::string& path, std::vector<uchar>& image) {
+		std::vector<uchar> region;
+		uint regionWidth;
+		uint regionHeight;
+		uint error = lodepng::decode_region(region, regionWidth, regionHeight, path, 0, 0, IMG_WIDTH, IMG_WIDTH, LCT_RGB);
+		if (error != 0)
+			return error;
+		image.assign(IMG_WIDTH * IMG_WIDTH * NUM_IMG_CHANNELS, 0);
+		for (uint y = 0; y < regionHeight; y++) {
+			std::copy_n(&region[y * regionWidth * NUM_IMG_CHANNELS], regionWidth * NUM_IMG_CHANNELS,
+				&image[y * IMG_WIDTH * NUM_IMG_CHANNELS]);
+		}
+		return 0;
+	}
+
+	uint loadPixels(const std::string& path) {
+		std::vector<uchar> image;
+		uint error = decodeCropped(path, image);
+		if (error != 0)
+			return error;
+		const LodePNGPlanes planes = voltagePlanes();
+		const LodePNGColorMode rgb = lodepng_color_mode_make(LCT_RGB, 8);
+		return lodepng_convert_planar(&planes, image.data(), &rgb, IMG_WIDTH, IMG_WIDTH);
 	}
 
 	void loadImage(std::string path) {
-		std::vector<uchar> uncroppedImage;
-		uint uncroppedImageWidth;
-		uint uncroppedImageHeight;
-		uint error = lodepng::decode(uncroppedImage, uncroppedImageWidth, uncroppedImageHeight, path, LCT_RGB);
+		// Everything lodepng allocates during the load comes from the arena and is freed by the end of loadPixels.
+		arena.reset();
+		const LodePNGAllocator allocator = arena.allocator();
+		const LodePNGAllocator* previous = lodepng_set_allocator(&allocator);
+		uint error = loadPixels(path);
+		lodepng_set_allocator(previous);
 		if (error != 0) {
 			std::cout << "error " << error << ": " << lodepng_error_text(error) << std::endl;
 			lastImagePath = "";
 			bImageLoaded = false;
-		} else {
-			for (uint y = 0; y < IMG_WIDTH; y++) {
-				for (uint x = 0; x < IMG_WIDTH; x++) {
-					const uint croppedIndex = ((y * IMG_WIDTH) + x) * NUM_IMG_CHANNELS;
-					if (x < uncroppedImageWidth && y < uncroppedImageHeight) {
-						const uint uncroppedIndex = ((y * uncroppedImageWidth) + x) * NUM_IMG_CHANNELS;
-						pixels[croppedIndex + 0] = pixelToVoltage(uncroppedImage[uncroppedIndex + 0]);
-						pixels[croppedIndex + 1] = pixelToVoltage(uncroppedImage[uncroppedIndex + 1]);
-						pixels[croppedIndex + 2] = pixelToVoltage(uncroppedImage[uncroppedIndex + 2]);
-					} else {
-						pixels[croppedIndex + 0] = 0.f;
-						pixels[croppedIndex + 1] = 0.f;
-						pixels[croppedIndex + 2] = 0.f;
-					}
-				}
-			}
-			lastImagePath = path;
-			bImageLoaded = true;
+			return;
 		}
+		lastImagePath = path;
+		bImageLoaded = true;
 	}
 
 	void process(const ProcessArgs& args) override {
@@ -136,8 +273,8 @@ struct TexModule : Module {
 				}
 				if (bTrigger) {
 					const uint channel = 0;
-					pixelIndex[channel] = (pixelIndex[channel] + NUM_IMG_CHANNELS) % (IMG_WIDTH*IMG_WIDTH*NUM_IMG_CHANNELS);
-					const uint index1d = (pixelIndex[channel]/NUM_IMG_CHANNELS);
+					pixelIndex[channel] = (pixelIndex[channel] + 1) % (IMG_WIDTH*IMG_WIDTH);
+					const uint index1d = pixelIndex[channel];
 					pixelNormalCoords[channel].x = (index1d % IMG_WIDTH) / (float)IMG_WIDTH;
 					pixelNormalCoords[channel].y = std::floor(index1d / (float)IMG_WIDTH) / (float)IMG_WIDTH;
 				}
@@ -153,14 +290,14 @@ struct TexModule : Module {
 					pixelNormalCoords[channel].y = yParam;
 					uint xCoord = xParam * ((float)IMG_WIDTH);
 					uint yCoord = yParam * ((float)IMG_WIDTH);
-					pixelIndex[channel] = ((yCoord * IMG_WIDTH) + xCoord) * NUM_IMG_CHANNELS;
+					pixelIndex[channel] = (yCoord * IMG_WIDTH) + xCoord;
 				}
 			}
 			
 			for (uint channel = 0; channel < channelCount; channel++) {
-				float red = pixels[pixelIndex[channel] + 0];
-				float green = pixels[pixelIndex[channel] + 1];
-				float blue = pixels[pixelIndex[channel] + 2];
+				float red = pixels[0][pixelIndex[channel]];
+				float green = pixels[1][pixelIndex[channel]];
+				float blue = pixels[2][pixelIndex[channel]];
 				outputs[RED_OUTPUT].setVoltage(red, channel);
 				outputs[GREEN_OUTPUT].setVoltage(green, channel);
 				outputs[BLUE_OUTPUT].setVoltage(blue, channel);
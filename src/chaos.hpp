@@ -0,0 +1,33 @@
+#pragma once
+#include "plugin.hpp"
+
+// Shared by CHAOS and its CHAOS X expander.
+#define MAX_LINKS 8
+#define MAX_SECTIONS 4
+#define ATTRACTOR_SIZE 3
+
+// CHAOS's state as it publishes it to a CHAOS X beside it, once per sample, through Rack's double-buffered expander
+// messages. CHAOS writes straight into the expander's producer buffer and Rack flips it to the consumer side at the
+// end of the engine frame, so the expander reads the sample before's state without a lock or an allocation.
+// Nothing is written while no CHAOS X is attached.
+struct ChaosBusMessage {
+	// Links in the chain, or 0 while CHAOS runs an attractor.
+	int numLinks;
+	// Link angles in radians (0 hanging straight down), angular velocities in radians per second of simulation
+	// time, and bob positions from the pivot with y pointing down, the whole chain being one unit long.
+	float theta[MAX_LINKS];
+	float vel[MAX_LINKS];
+	float x[MAX_LINKS];
+	float y[MAX_LINKS];
+	// The attractor's x, y and z about its centre, scaled to roughly +/-1.
+	float point[ATTRACTOR_SIZE];
+	// The chain's kinetic plus potential energy, in units of its total weight times its length.
+	float energy;
+	// Poincaré sections CHAOS tracks, and a bit for each one that fired this sample.
+	int numSections;
+	uint32_t sectionEvents;
+	// A bit for each link that swung over the top this sample.
+	uint32_t flipEvents;
+	// The system was kicked (by the button, the trigger input or a click on the map) this sample.
+	bool kicked;
+};
@@ -35,6 +35,17 @@ Rename this file to lodepng.cpp to use it for C++, or to lodepng.c to use it for
 #include <stdio.h> /* file handling */
 #endif /* LODEPNG_COMPILE_DISK */
 
+/* lodepng_map_file maps files with mmap on Unix-like systems. Strict ISO C builds, which don't get the POSIX
+declarations, other systems, and builds with LODEPNG_NO_MMAP defined read the file into memory instead. */
+#if defined(LODEPNG_COMPILE_DISK) && !defined(LODEPNG_NO_MMAP) && (defined(__unix__) || defined(__APPLE__)) &&\
+    (defined(__cplusplus) || !defined(__STRICT_ANSI__) || defined(_POSIX_C_SOURCE) || defined(_GNU_SOURCE))
+#define LODEPNG_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #ifdef LODEPNG_COMPILE_ALLOCATORS
 #include <stdlib.h> /* allocations */
 #endif /* LODEPNG_COMPILE_ALLOCATORS */
@@ -71,22 +82,56 @@ lodepng source code. Don't forget to remove "static" if you copypaste them
 from here.*/
 
 #ifdef LODEPNG_COMPILE_ALLOCATORS
-static void* lodepng_malloc(size_t size) {
+/*The allocator set with lodepng_set_allocator is per thread where the compiler has thread-local storage, and
+shared by all threads otherwise.*/
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+#define LODEPNG_THREAD_LOCAL thread_local
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_THREADS__)
+#define LODEPNG_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__)
+#define LODEPNG_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define LODEPNG_THREAD_LOCAL __declspec(thread)
+#else
+#define LODEPNG_THREAD_LOCAL /* not available */
+#endif
+
+static LODEPNG_THREAD_LOCAL const LodePNGAllocator* lodepng_allocator = 0;
+
+/*Buffers grow from inside the inflate loop, which runs measurably slower with these inlined into it.*/
+#if defined(__GNUC__)
+#define LODEPNG_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define LODEPNG_NOINLINE __declspec(noinline)
+#else
+#define LODEPNG_NOINLINE /* not available */
+#endif
+
+const LodePNGAllocator* lodepng_set_allocator(const LodePNGAllocator* allocator) {
+  const LodePNGAllocator* previous = lodepng_allocator;
+  lodepng_allocator = allocator;
+  return previous;
+}
+
+static LODEPNG_NOINLINE void* lodepng_malloc(size_t size) {
 #ifdef LODEPNG_MAX_ALLOC
   if(size > LODEPNG_MAX_ALLOC) return 0;
 #endif
+  if(lodepng_allocator) return lodepng_allocator->allocate(lodepng_allocator->user, size);
   return malloc(size);
 }
 
-static void* lodepng_realloc(void* ptr, size_t new_size) {
+static LODEPNG_NOINLINE void* lodepng_realloc(void* ptr, size_t new_size) {
 #ifdef LODEPNG_MAX_ALLOC
   if(new_size > LODEPNG_MAX_ALLOC) return 0;
 #endif
+  if(lodepng_allocator) return lodepng_allocator->reallocate(lodepng_allocator->user, ptr, new_size);
   return realloc(ptr, new_size);
 }
 
-static void lodepng_free(void* ptr) {
-  free(ptr);
+static LODEPNG_NOINLINE void lodepng_free(void* ptr) {
+  if(lodepng_allocator) lodepng_allocator->deallocate(lodepng_allocator->user, ptr);
+  else free(ptr);
 }
 #else /*LODEPNG_COMPILE_ALLOCATORS*/
 /* TODO: support giving additional void* payload to the custom allocators */
@@ -112,6 +157,52 @@ void lodepng_free(void* ptr);
 #define LODEPNG_RESTRICT /* not available */
 #endif
 
+/* The fast inflate loop keeps its bits in a size_t, so it is only compiled where that has 64 bits.
+Define LODEPNG_NO_BITBUF64 to always use the byte-wise reader. */
+#if !defined(LODEPNG_NO_BITBUF64) && (defined(__x86_64__) || defined(_M_X64) || defined(__aarch64__) ||\
+    defined(_M_ARM64) || defined(__powerpc64__) || (defined(__SIZEOF_SIZE_T__) && __SIZEOF_SIZE_T__ == 8))
+#define LODEPNG_BITBUF64
+#endif
+
+/* Unfiltering whole-byte pixels of 3, 4, 6 or 8 bytes uses SSE2 on x86-64 and NEON on 64-bit ARM. With GCC or Clang,
+x86-64 also gets SSSE3, AVX2 and PCLMULQDQ versions of the unfilters and checksums, compiled for those targets alone
+and picked at runtime. Both SSE2 and NEON split pixels into float planes for lodepng_convert_planar. 64-bit ARM
+computes CRCs with its CRC32 instructions, which are optional before ARMv8.1: when the compiler isn't already
+targeting them, they are compiled for that extension alone and used if Linux reports them (HWCAP_CRC32).
+Define LODEPNG_NO_SIMD to always use the portable code. */
+#if !defined(LODEPNG_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define LODEPNG_SIMD_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#define LODEPNG_SIMD_X86_EXTENSIONS
+#include <immintrin.h>
+#define LODEPNG_TARGET(features) __attribute__((target(features)))
+#endif
+#elif !defined(LODEPNG_NO_SIMD) && defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+#define LODEPNG_SIMD_NEON
+#include <arm_neon.h>
+#if defined(__ARM_FEATURE_CRC32)
+#define LODEPNG_SIMD_ARM_CRC32
+#define LODEPNG_ARM_CRC32_TARGET /* the whole build targets it */
+#include <arm_acle.h>
+#elif defined(__linux__) && defined(__aarch64__) &&\
+    ((defined(__clang__) && __clang_major__ >= 16) || (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 10))
+/*these compilers' arm_acle.h declare the CRC intrinsics for functions targeting the extension*/
+#define LODEPNG_SIMD_ARM_CRC32
+#define LODEPNG_SIMD_ARM_CRC32_DETECT
+#if defined(__clang__)
+#define LODEPNG_ARM_CRC32_TARGET __attribute__((target("crc")))
+#else
+#define LODEPNG_ARM_CRC32_TARGET __attribute__((target("+crc")))
+#endif
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+#endif
+
 /* Replacements for C library functions memcpy and strlen, to support those platforms
 where a full C library is not available. The compiler can recognize them and compile
 to something as fast. */
@@ -122,6 +213,42 @@ static void lodepng_memcpy(void* LODEPNG_RESTRICT dst,
   for(i = 0; i < size; i++) ((char*)dst)[i] = ((const char*)src)[i];
 }
 
+#ifdef LODEPNG_SIMD_X86_EXTENSIONS
+#define LODEPNG_CPU_SSSE3 1
+#define LODEPNG_CPU_AVX2 2
+#define LODEPNG_CPU_PCLMUL 4
+
+/* whether the CPU has all the given LODEPNG_CPU_ features, asked once. Band decoding asks from several threads,
+so the answer is kept with relaxed atomics; racing threads all store the same value. */
+static int lodepng_cpu_has(int features) {
+  static int found = -1;
+  int cached = __atomic_load_n(&found, __ATOMIC_RELAXED);
+  if(cached < 0) {
+    __builtin_cpu_init();
+    cached = (__builtin_cpu_supports("ssse3") ? LODEPNG_CPU_SSSE3 : 0)
+           | (__builtin_cpu_supports("avx2") ? LODEPNG_CPU_AVX2 : 0)
+           | (__builtin_cpu_supports("pclmul") ? LODEPNG_CPU_PCLMUL : 0);
+    __atomic_store_n(&found, cached, __ATOMIC_RELAXED);
+  }
+  return (cached & features) == features;
+}
+#endif /*LODEPNG_SIMD_X86_EXTENSIONS*/
+
+#ifdef LODEPNG_SIMD_ARM_CRC32_DETECT
+/* whether the CPU has the CRC32 instructions, asked once and kept as lodepng_cpu_has keeps its answer */
+static int lodepng_cpu_has_crc32(void) {
+  static int found = -1;
+  int cached = __atomic_load_n(&found, __ATOMIC_RELAXED);
+  if(cached < 0) {
+    cached = (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+    __atomic_store_n(&found, cached, __ATOMIC_RELAXED);
+  }
+  return cached;
+}
+#elif defined(LODEPNG_SIMD_ARM_CRC32)
+#define lodepng_cpu_has_crc32() 1
+#endif /*LODEPNG_SIMD_ARM_CRC32_DETECT*/
+
 /* does not check memory out of bounds, do not use on untrusted data */
 static size_t lodepng_strlen(const char* a) {
   const char* orig = a;
@@ -423,6 +550,55 @@ unsigned lodepng_load_file(unsigned char** out, size_t* outsize, const char* fil
   return lodepng_buffer_file(*out, (size_t)size, filename);
 }
 
+#ifdef LODEPNG_MMAP
+unsigned lodepng_map_file(const unsigned char** out, size_t* outsize, const char* filename) {
+  struct stat st;
+  void* data;
+  int fd;
+  *out = 0;
+  *outsize = 0;
+  fd = open(filename, O_RDONLY);
+  if(fd < 0) return 78;
+  if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (unsigned long long)st.st_size > (size_t)(-1)) {
+    close(fd);
+    return 78;
+  }
+  if(st.st_size == 0) {
+    close(fd);
+    return 0; /*an empty file has nothing to map*/
+  }
+  data = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); /*the mapping keeps the file open*/
+  if(data == MAP_FAILED) return 78;
+  /*a decode reads the file front to back, so the kernel can read ahead of it and drop the pages it has passed*/
+  posix_madvise(data, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+  *out = (const unsigned char*)data;
+  *outsize = (size_t)st.st_size;
+  return 0;
+}
+
+void lodepng_unmap_file(const unsigned char* buffer, size_t buffersize) {
+  if(buffer) munmap((void*)buffer, buffersize);
+}
+#else /*LODEPNG_MMAP*/
+unsigned lodepng_map_file(const unsigned char** out, size_t* outsize, const char* filename) {
+  unsigned char* buffer = 0;
+  unsigned error = lodepng_load_file(&buffer, outsize, filename);
+  if(error) {
+    lodepng_free(buffer);
+    buffer = 0;
+    *outsize = 0;
+  }
+  *out = buffer;
+  return error;
+}
+
+void lodepng_unmap_file(const unsigned char* buffer, size_t buffersize) {
+  (void)buffersize;
+  lodepng_free((void*)buffer);
+}
+#endif /*LODEPNG_MMAP*/
+
 /*write given buffer to the file, overwriting the file, it doesn't append to it.*/
 unsigned lodepng_save_file(const unsigned char* buffer, size_t buffersize, const char* filename) {
   FILE* file;
@@ -1302,10 +1478,240 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
   return error;
 }
 
+#ifdef LODEPNG_BITBUF64
+/*
+Fast path of inflateHuffmanBlock for the bulk of a block. Keeps up to 63 bits in a 64-bit word, refilled with one
+unaligned 8-byte load at the top of each symbol, which leaves at least 56 bits: enough for a whole length/distance
+pair (at most 15 + 5 + 15 + 13 = 48 bits) without refilling again. While at least 8 input bytes remain and the output
+has FASTINFLATE_MARGIN bytes of room, nothing in the loop is bounds checked. Returns with *done set at the end code,
+or not set when the input margin ran out, leaving the rest of the block to the careful loop in inflateHuffmanBlock.
+*/
+#define FASTINFLATE_MARGIN 274u /* the longest match, 258 bytes, plus the overrun of copying in 8-byte words */
+
+static LODEPNG_INLINE size_t lodepng_read64le(const unsigned char* buffer) {
+  return (size_t)buffer[0] | ((size_t)buffer[1] << 8u) | ((size_t)buffer[2] << 16u) | ((size_t)buffer[3] << 24u) |
+         ((size_t)buffer[4] << 32u) | ((size_t)buffer[5] << 40u) | ((size_t)buffer[6] << 48u) |
+         ((size_t)buffer[7] << 56u);
+}
+
+/* as huffmanDecodeSymbol, for the 64-bit bit buffer of inflateHuffmanFast */
+static LODEPNG_INLINE unsigned huffmanDecodeSymbolFast(size_t* bitbuf, unsigned* bitcount, const HuffmanTree* codetree) {
+  unsigned code = (unsigned)(*bitbuf & ((1u << FIRSTBITS) - 1u));
+  unsigned l = codetree->table_len[code];
+  unsigned value = codetree->table_value[code];
+  if(l > FIRSTBITS) {
+    unsigned index2 = value + (unsigned)((*bitbuf >> FIRSTBITS) & ((1u << (l - FIRSTBITS)) - 1u));
+    l = codetree->table_len[index2];
+    value = codetree->table_value[index2];
+  }
+  *bitbuf >>= l;
+  *bitcount -= l;
+  return value;
+}
+
+/*
+Literal/length lookup table of the fast path, indexed by the next FASTLLBITS bits. Unlike the table of HuffmanTree,
+one entry can decode two literals at once when both codes fit in those bits, and a length code's entry holds its
+base length and extra bit count. Each entry is the bits it consumes (the low 6 bits, so the entry itself can be the
+shift amount), a kind, and:
+-FASTLL_LITERALS: the literal in bits 8-15, and with FASTLL_PAIR set a second one in bits 16-23
+-FASTLL_LENGTH: the number of extra bits in bits 8-15 and the base length in bits 16-24
+-FASTLL_SLOW: nothing, decode with huffmanDecodeSymbolFast instead (long codes, the end code, invalid symbols)
+*/
+#define FASTLLBITS 11u
+#define FASTLL_LITERALS 0u
+#define FASTLL_LENGTH 64u
+#define FASTLL_SLOW 128u
+#define FASTLL_KIND 192u
+#define FASTLL_PAIR 16777216u /*1u << 24u*/
+
+/*fills the fast table from the codes rather than index by index: each code's entry repeats every 2^length entries*/
+static void HuffmanTree_makeFastLL(unsigned* fast, const HuffmanTree* tree_ll) {
+  unsigned i, j, k, l;
+  unsigned numshort = 0;
+  /*literals whose codes leave room for a second code, shortest first, with their bit-reversed codes*/
+  unsigned short shortsymbols[256];
+  unsigned shortcodes[256];
+
+  for(i = 0; i != (1u << FASTLLBITS); ++i) fast[i] = FASTLL_SLOW;
+  for(i = 0; i != tree_ll->numcodes; ++i) {
+    unsigned entry, reverse;
+    l = tree_ll->lengths[i];
+    if(l == 0 || l > FASTLLBITS) continue;
+    if(i <= 255) {
+      entry = l | FASTLL_LITERALS | (i << 8u);
+    } else if(i >= FIRST_LENGTH_CODE_INDEX && i <= LAST_LENGTH_CODE_INDEX) {
+      entry = l | FASTLL_LENGTH | (LENGTHEXTRA[i - FIRST_LENGTH_CODE_INDEX] << 8u)
+            | (LENGTHBASE[i - FIRST_LENGTH_CODE_INDEX] << 16u);
+    } else {
+      continue; /*the end code and the unused codes 286 and 287 take the slow path*/
+    }
+    reverse = reverseBits(tree_ll->codes[i], l);
+    for(j = reverse; j < (1u << FASTLLBITS); j += (1u << l)) fast[j] = entry;
+  }
+
+  for(l = 1; l < FASTLLBITS; ++l) {
+    for(i = 0; i != 256; ++i) {
+      if(tree_ll->lengths[i] != l) continue;
+      shortsymbols[numshort] = (unsigned short)i;
+      shortcodes[numshort] = reverseBits(tree_ll->codes[i], l);
+      ++numshort;
+    }
+  }
+  /*every index starting with two literal codes gets both, valid trees being prefix free*/
+  for(i = 0; i != numshort; ++i) {
+    unsigned l1 = tree_ll->lengths[shortsymbols[i]];
+    for(k = 0; k != numshort; ++k) {
+      unsigned l2 = tree_ll->lengths[shortsymbols[k]];
+      unsigned entry;
+      if(l1 + l2 > FASTLLBITS) break;
+      entry = (l1 + l2) | FASTLL_LITERALS | FASTLL_PAIR | ((unsigned)shortsymbols[i] << 8u)
+            | ((unsigned)shortsymbols[k] << 16u);
+      for(j = shortcodes[i] | (shortcodes[k] << l1); j < (1u << FASTLLBITS); j += (1u << (l1 + l2))) fast[j] = entry;
+    }
+  }
+}
+
+/*outputs the one or two literals of a FASTLL_LITERALS entry. The second byte only counts if the entry holds a pair,
+but the margin covers writing it regardless.*/
+#define FASTLL_PUT_LITERALS() {\
+  data[p] = (unsigned char)(entry >> 8u);\
+  data[p + 1] = (unsigned char)(entry >> 16u);\
+  p += 1u + (entry >> 24u);\
+  bitbuf >>= (entry & 63u);\
+  bitcount -= (entry & 63u);\
+}
+
+static unsigned inflateHuffmanFast(ucvector* out, size_t* pos, LodePNGBitReader* reader,
+                                   const HuffmanTree* tree_ll, const HuffmanTree* tree_d, unsigned* done) {
+  unsigned error = 0;
+  const unsigned char* in = reader->data + (reader->bp >> 3u);
+  const unsigned char* inend = reader->data + reader->size;
+  size_t bitbuf = 0;
+  unsigned bitcount = 0;
+  size_t p = *pos;
+  /*the output stays in locals between reallocations: every byte written could otherwise alias them*/
+  unsigned char* data = out->data;
+  size_t allocsize = out->allocsize;
+  unsigned fast_ll[1u << FASTLLBITS];
+  *done = 0;
+  if(inend - in < 8) return 0;
+  HuffmanTree_makeFastLL(fast_ll, tree_ll);
+
+  /*the first refill starts at the byte holding the next bit, so drop the bits of it already read*/
+  bitbuf = lodepng_read64le(in);
+  in += 7;
+  bitcount = 56;
+  bitbuf >>= (reader->bp & 7u);
+  bitcount -= (reader->bp & 7u);
+
+  for(;;) {
+    unsigned entry, code_d, numextrabits;
+    size_t length, distance;
+    unsigned char* dst;
+    const unsigned char* src;
+    if(inend - in < 8) break;
+    bitbuf |= lodepng_read64le(in) << bitcount;
+    in += (63u - bitcount) >> 3u;
+    bitcount |= 56u;
+
+    if(allocsize - p < FASTINFLATE_MARGIN) {
+      if(!ucvector_reserve(out, p + FASTINFLATE_MARGIN)) ERROR_BREAK(83 /*alloc fail*/);
+      data = out->data;
+      allocsize = out->allocsize;
+    }
+
+    entry = fast_ll[bitbuf & ((1u << FASTLLBITS) - 1u)];
+    if((entry & FASTLL_KIND) == FASTLL_LITERALS) {
+      /*a refill holds enough bits for three entries; runs of literals take them without refilling in between*/
+      FASTLL_PUT_LITERALS();
+      entry = fast_ll[bitbuf & ((1u << FASTLLBITS) - 1u)];
+      if((entry & FASTLL_KIND) == FASTLL_LITERALS) {
+        FASTLL_PUT_LITERALS();
+        entry = fast_ll[bitbuf & ((1u << FASTLLBITS) - 1u)];
+        if((entry & FASTLL_KIND) == FASTLL_LITERALS) {
+          FASTLL_PUT_LITERALS();
+        }
+      }
+      continue;
+    } else if((entry & FASTLL_KIND) == FASTLL_LENGTH) {
+      bitbuf >>= (entry & 63u);
+      bitcount -= (entry & 63u);
+      length = entry >> 16u;
+      numextrabits = (entry >> 8u) & 255u;
+    } else {
+      unsigned code_ll = huffmanDecodeSymbolFast(&bitbuf, &bitcount, tree_ll);
+      if(code_ll <= 255) {
+        data[p++] = (unsigned char)code_ll;
+        continue;
+      } else if(code_ll == 256) {
+        *done = 1;
+        break; /*end code, break the loop*/
+      } else if(code_ll > LAST_LENGTH_CODE_INDEX) /*if(code_ll == INVALIDSYMBOL)*/ {
+        ERROR_BREAK(16); /*error: tried to read disallowed huffman symbol*/
+      }
+      length = LENGTHBASE[code_ll - FIRST_LENGTH_CODE_INDEX];
+      numextrabits = LENGTHEXTRA[code_ll - FIRST_LENGTH_CODE_INDEX];
+    }
+
+    {
+      length += (size_t)(bitbuf & ((1u << numextrabits) - 1u));
+      bitbuf >>= numextrabits;
+      bitcount -= numextrabits;
+
+      code_d = huffmanDecodeSymbolFast(&bitbuf, &bitcount, tree_d);
+      if(code_d > 29) {
+        if(code_d <= 31) {
+          ERROR_BREAK(18); /*error: invalid distance code (30-31 are never used)*/
+        } else /* if(code_d == INVALIDSYMBOL) */{
+          ERROR_BREAK(16); /*error: tried to read disallowed huffman symbol*/
+        }
+      }
+      distance = DISTANCEBASE[code_d];
+      numextrabits = DISTANCEEXTRA[code_d];
+      distance += (size_t)(bitbuf & ((1u << numextrabits) - 1u));
+      bitbuf >>= numextrabits;
+      bitcount -= numextrabits;
+
+      if(distance > p) ERROR_BREAK(52); /*too long backward distance*/
+      dst = data + p;
+      src = dst - distance;
+      p += length;
+      /*copied in whole words, up to 7 bytes past the match, and each word's source must lie wholly before its
+      destination. A shorter distance repeats a pattern: lay the first word down bytewise, then copy from the
+      multiple of the distance at least 8 back, which holds the same pattern.*/
+      {
+        unsigned char* dstend = dst + length;
+        if(distance < 8) {
+          size_t period = distance;
+          unsigned i;
+          for(i = 0; i != 8; ++i) dst[i] = src[i];
+          while(period < 8) period += distance;
+          dst += 8;
+          src = dst - period;
+        }
+        while(dst < dstend) {
+          lodepng_memcpy(dst, src, 8);
+          dst += 8;
+          src += 8;
+        }
+      }
+    }
+  }
+
+  /*hand the position back to the careful reader: every bit still in the buffer is unread*/
+  reader->bp = (size_t)(in - reader->data) * 8u - bitcount;
+  out->size = p;
+  *pos = p;
+  return error;
+}
+#endif /*LODEPNG_BITBUF64*/
+
 /*inflate a block with dynamic of fixed Huffman tree. btype must be 1 or 2.*/
 static unsigned inflateHuffmanBlock(ucvector* out, size_t* pos, LodePNGBitReader* reader,
                                     unsigned btype) {
   unsigned error = 0;
+  unsigned done = 0; /*set once the fast path has reached the end code*/
   HuffmanTree tree_ll; /*the huffman tree for literal and length codes*/
   HuffmanTree tree_d; /*the huffman tree for distance codes*/
 
@@ -1315,7 +1721,11 @@ static unsigned inflateHuffmanBlock(ucvector* out, size_t* pos, LodePNGBitReader
   if(btype == 1) getTreeInflateFixed(&tree_ll, &tree_d);
   else /*if(btype == 2)*/ error = getTreeInflateDynamic(&tree_ll, &tree_d, reader);
 
-  while(!error) /*decode all symbols until end reached, breaks at end code*/ {
+#ifdef LODEPNG_BITBUF64
+  if(!error) error = inflateHuffmanFast(out, pos, reader, &tree_ll, &tree_d, &done);
+#endif /*LODEPNG_BITBUF64*/
+
+  while(!error && !done) /*decode all symbols until end reached, breaks at end code*/ {
     /*code_ll is literal, length or end code*/
     unsigned code_ll;
     ensureBits25(reader, 20); /* up to 15 for the huffman symbol, up to 5 for the length extra bits */
@@ -1429,6 +1839,13 @@ static unsigned inflateNoCompression(ucvector* out, size_t* pos,
   return error;
 }
 
+/*room past the end of the output that inflate may want while writing it*/
+#ifdef LODEPNG_BITBUF64
+#define INFLATE_SLACK FASTINFLATE_MARGIN
+#else /*LODEPNG_BITBUF64*/
+#define INFLATE_SLACK 0u
+#endif /*LODEPNG_BITBUF64*/
+
 static unsigned lodepng_inflatev(ucvector* out,
                                  const unsigned char* in, size_t insize,
                                  const LodePNGDecompressSettings* settings) {
@@ -1438,6 +1855,11 @@ static unsigned lodepng_inflatev(ucvector* out,
   unsigned error = LodePNGBitReader_init(&reader, in, insize);
 
   if(error) return error;
+  /*room for all the output expected, and for the fast loop's margin past it, so a stream of the expected size is
+  inflated without reallocating*/
+  if(settings->expected_size && !ucvector_reserve(out, out->size + settings->expected_size + INFLATE_SLACK)) {
+    return 83; /*alloc fail*/
+  }
 
   while(!BFINAL) {
     unsigned BTYPE;
@@ -1450,6 +1872,7 @@ static unsigned lodepng_inflatev(ucvector* out,
     else error = inflateHuffmanBlock(out, &pos, &reader, BTYPE); /*compression, BTYPE 01 or 10*/
 
     if(error) return error;
+    if(settings->needed_size && pos >= settings->needed_size) break; /*the caller has all it wants*/
   }
 
   return error;
@@ -1776,7 +2199,7 @@ static unsigned encodeLZ77(uivector* out, Hash* hash,
 
 /* /////////////////////////////////////////////////////////////////////////// */
 
-static unsigned deflateNoCompression(ucvector* out, const unsigned char* data, size_t datasize) {
+static unsigned deflateNoCompression(ucvector* out, const unsigned char* data, size_t datasize, unsigned final) {
   /*non compressed deflate block data: 1 bit BFINAL,2 bits BTYPE,(5 bits): it jumps to start of next byte,
   2 bytes LEN, 2 bytes NLEN, LEN bytes literal DATA*/
 
@@ -1786,7 +2209,7 @@ static unsigned deflateNoCompression(ucvector* out, const unsigned char* data, s
     unsigned BFINAL, BTYPE, LEN, NLEN;
     unsigned char firstbyte;
 
-    BFINAL = (i == numdeflateblocks - 1);
+    BFINAL = final && (i == numdeflateblocks - 1);
     BTYPE = 0;
 
     firstbyte = (unsigned char)(BFINAL + ((BTYPE & 1u) << 1u) + ((BTYPE & 2u) << 1u));
@@ -2107,8 +2530,10 @@ static unsigned deflateFixed(LodePNGBitWriter* writer, Hash* hash,
   return error;
 }
 
+/*appends the deflate data of in to out. final: whether it ends the deflate stream. If not, the data ends on a byte
+boundary with an empty stored block, as a zlib full flush does, and deflate data compressed on its own may follow.*/
 static unsigned lodepng_deflatev(ucvector* out, const unsigned char* in, size_t insize,
-                                 const LodePNGCompressSettings* settings) {
+                                 const LodePNGCompressSettings* settings, unsigned final) {
   unsigned error = 0;
   size_t i, blocksize, numdeflateblocks;
   Hash hash;
@@ -2117,7 +2542,7 @@ static unsigned lodepng_deflatev(ucvector* out, const unsigned char* in, size_t
   LodePNGBitWriter_init(&writer, out);
 
   if(settings->btype > 2) return 61;
-  else if(settings->btype == 0) return deflateNoCompression(out, in, insize);
+  else if(settings->btype == 0) return deflateNoCompression(out, in, insize, final); /*stored blocks end aligned*/
   else if(settings->btype == 1) blocksize = insize;
   else /*if(settings->btype == 2)*/ {
     /*on PNGs, deflate blocks of 65-262k seem to give most dense encoding*/
@@ -2133,17 +2558,25 @@ static unsigned lodepng_deflatev(ucvector* out, const unsigned char* in, size_t
   if(error) return error;
 
   for(i = 0; i != numdeflateblocks && !error; ++i) {
-    unsigned final = (i == numdeflateblocks - 1);
+    unsigned BFINAL = final && (i == numdeflateblocks - 1);
     size_t start = i * blocksize;
     size_t end = start + blocksize;
     if(end > insize) end = insize;
 
-    if(settings->btype == 1) error = deflateFixed(&writer, &hash, in, start, end, settings, final);
-    else if(settings->btype == 2) error = deflateDynamic(&writer, &hash, in, start, end, settings, final);
+    if(settings->btype == 1) error = deflateFixed(&writer, &hash, in, start, end, settings, BFINAL);
+    else if(settings->btype == 2) error = deflateDynamic(&writer, &hash, in, start, end, settings, BFINAL);
   }
 
   hash_cleanup(&hash);
 
+  if(!error && !final) {
+    writeBits(&writer, 0, 3); /*BFINAL 0, BTYPE 00: the rest of the byte is padding*/
+    ucvector_push_back(out, 0); /*LEN 0 and NLEN 65535*/
+    ucvector_push_back(out, 0);
+    ucvector_push_back(out, 255);
+    ucvector_push_back(out, 255);
+  }
+
   return error;
 }
 
@@ -2153,7 +2586,7 @@ unsigned lodepng_deflate(unsigned char** out, size_t* outsize,
   unsigned error;
   ucvector v;
   ucvector_init_buffer(&v, *out, *outsize);
-  error = lodepng_deflatev(&v, in, insize, settings);
+  error = lodepng_deflatev(&v, in, insize, settings, 1);
   *out = v.data;
   *outsize = v.size;
   return error;
@@ -2175,7 +2608,7 @@ static unsigned deflate(unsigned char** out, size_t* outsize,
 /* / Adler32                                                                / */
 /* ////////////////////////////////////////////////////////////////////////// */
 
-static unsigned update_adler32(unsigned adler, const unsigned char* data, unsigned len) {
+static unsigned update_adler32_portable(unsigned adler, const unsigned char* data, unsigned len) {
   unsigned s1 = adler & 0xffffu;
   unsigned s2 = (adler >> 16u) & 0xffffu;
 
@@ -2195,11 +2628,120 @@ static unsigned update_adler32(unsigned adler, const unsigned char* data, unsign
   return (s2 << 16u) | s1;
 }
 
+#ifdef LODEPNG_SIMD_X86_EXTENSIONS
+/*
+The SIMD Adler-32s take 32 or 64 byte blocks at a time. Within a block, s1 gains the sum of the bytes (psadbw), and
+s2 gains s1 once per byte plus each byte weighted by how many bytes of the block follow it, counting itself
+(pmaddubsw against descending taps). The s1 each block starts with is added up in a vector too and joins s2 times
+the block size at the end of a run. Runs stay within the 5552 bytes after which the sums could overflow. Returns
+the Adler-32 after the whole blocks; the caller does the remaining bytes.
+*/
+LODEPNG_TARGET("ssse3") static unsigned update_adler32_ssse3(unsigned adler, const unsigned char* data,
+                                                             unsigned blocks) {
+  unsigned s1 = adler & 0xffffu;
+  unsigned s2 = (adler >> 16u) & 0xffffu;
+  const __m128i taps1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17);
+  const __m128i taps2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ones = _mm_set1_epi16(1);
+  while(blocks != 0) {
+    unsigned run = blocks > 5552u / 32u ? 5552u / 32u : blocks;
+    __m128i prefix = _mm_cvtsi32_si128((int)(s1 * run));
+    __m128i sum1 = zero;
+    __m128i sum2 = _mm_cvtsi32_si128((int)s2);
+    blocks -= run;
+    for(; run != 0; --run, data += 32) {
+      __m128i bytes1 = _mm_loadu_si128((const __m128i*)data);
+      __m128i bytes2 = _mm_loadu_si128((const __m128i*)(data + 16));
+      prefix = _mm_add_epi32(prefix, sum1);
+      sum1 = _mm_add_epi32(sum1, _mm_add_epi32(_mm_sad_epu8(bytes1, zero), _mm_sad_epu8(bytes2, zero)));
+      sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(_mm_maddubs_epi16(bytes1, taps1), ones));
+      sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(_mm_maddubs_epi16(bytes2, taps2), ones));
+    }
+    sum2 = _mm_add_epi32(sum2, _mm_slli_epi32(prefix, 5));
+    sum1 = _mm_add_epi32(sum1, _mm_shuffle_epi32(sum1, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum2 = _mm_add_epi32(sum2, _mm_shuffle_epi32(sum2, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum2 = _mm_add_epi32(sum2, _mm_shuffle_epi32(sum2, _MM_SHUFFLE(2, 3, 0, 1)));
+    s1 = (s1 + (unsigned)_mm_cvtsi128_si32(sum1)) % 65521u;
+    s2 = (unsigned)_mm_cvtsi128_si32(sum2) % 65521u;
+  }
+  return (s2 << 16u) | s1;
+}
+
+LODEPNG_TARGET("avx2") static unsigned update_adler32_avx2(unsigned adler, const unsigned char* data,
+                                                           unsigned blocks) {
+  unsigned s1 = adler & 0xffffu;
+  unsigned s2 = (adler >> 16u) & 0xffffu;
+  const __m256i taps1 = _mm256_setr_epi8(64, 63, 62, 61, 60, 59, 58, 57, 56, 55, 54, 53, 52, 51, 50, 49,
+                                         48, 47, 46, 45, 44, 43, 42, 41, 40, 39, 38, 37, 36, 35, 34, 33);
+  const __m256i taps2 = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+                                         16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i ones = _mm256_set1_epi16(1);
+  while(blocks != 0) {
+    unsigned run = blocks > 5552u / 64u ? 5552u / 64u : blocks;
+    __m256i prefix = _mm256_setr_epi32((int)(s1 * run), 0, 0, 0, 0, 0, 0, 0);
+    __m256i sum1 = zero;
+    __m256i sum2 = _mm256_setr_epi32((int)s2, 0, 0, 0, 0, 0, 0, 0);
+    __m128i total1, total2;
+    blocks -= run;
+    for(; run != 0; --run, data += 64) {
+      __m256i bytes1 = _mm256_loadu_si256((const __m256i*)data);
+      __m256i bytes2 = _mm256_loadu_si256((const __m256i*)(data + 32));
+      prefix = _mm256_add_epi32(prefix, sum1);
+      sum1 = _mm256_add_epi32(sum1, _mm256_add_epi32(_mm256_sad_epu8(bytes1, zero), _mm256_sad_epu8(bytes2, zero)));
+      sum2 = _mm256_add_epi32(sum2, _mm256_madd_epi16(_mm256_maddubs_epi16(bytes1, taps1), ones));
+      sum2 = _mm256_add_epi32(sum2, _mm256_madd_epi16(_mm256_maddubs_epi16(bytes2, taps2), ones));
+    }
+    sum2 = _mm256_add_epi32(sum2, _mm256_slli_epi32(prefix, 6));
+    total1 = _mm_add_epi32(_mm256_castsi256_si128(sum1), _mm256_extracti128_si256(sum1, 1));
+    total2 = _mm_add_epi32(_mm256_castsi256_si128(sum2), _mm256_extracti128_si256(sum2, 1));
+    total1 = _mm_add_epi32(total1, _mm_shuffle_epi32(total1, _MM_SHUFFLE(1, 0, 3, 2)));
+    total2 = _mm_add_epi32(total2, _mm_shuffle_epi32(total2, _MM_SHUFFLE(1, 0, 3, 2)));
+    total2 = _mm_add_epi32(total2, _mm_shuffle_epi32(total2, _MM_SHUFFLE(2, 3, 0, 1)));
+    s1 = (s1 + (unsigned)_mm_cvtsi128_si32(total1)) % 65521u;
+    s2 = (unsigned)_mm_cvtsi128_si32(total2) % 65521u;
+  }
+  return (s2 << 16u) | s1;
+}
+#endif /*LODEPNG_SIMD_X86_EXTENSIONS*/
+
+static unsigned update_adler32(unsigned adler, const unsigned char* data, unsigned len) {
+#ifdef LODEPNG_SIMD_X86_EXTENSIONS
+  if(len >= 64u && lodepng_cpu_has(LODEPNG_CPU_AVX2)) {
+    adler = update_adler32_avx2(adler, data, len / 64u);
+    data += len & ~63u;
+    len &= 63u;
+  } else if(len >= 32u && lodepng_cpu_has(LODEPNG_CPU_SSSE3)) {
+    adler = update_adler32_ssse3(adler, data, len / 32u);
+    data += len & ~31u;
+    len &= 31u;
+  }
+#endif /*LODEPNG_SIMD_X86_EXTENSIONS*/
+  return update_adler32_portable(adler, data, len);
+}
+
 /*Return the adler32 of the bytes data[0..len-1]*/
 static unsigned adler32(const unsigned char* data, unsigned len) {
   return update_adler32(1u, data, len);
 }
 
+#ifdef LODEPNG_COMPILE_DECODER
+/*Return the adler32 of two pieces of data one after the other, given the adler32 of each and the length of the second*/
+static unsigned adler32_combine(unsigned adler1, unsigned adler2, size_t len2) {
+  unsigned rem = (unsigned)(len2 % 65521u);
+  unsigned s1 = adler1 & 0xffffu;
+  unsigned s2 = (rem * s1) % 65521u;
+  s1 += (adler2 & 0xffffu) + 65521u - 1u;
+  s2 += ((adler1 >> 16u) & 0xffffu) + ((adler2 >> 16u) & 0xffffu) + 65521u - rem;
+  if(s1 >= 65521u) s1 -= 65521u;
+  if(s1 >= 65521u) s1 -= 65521u;
+  if(s2 >= 2u * 65521u) s2 -= 2u * 65521u;
+  if(s2 >= 65521u) s2 -= 65521u;
+  return (s2 << 16u) | s1;
+}
+#endif /*LODEPNG_COMPILE_DECODER*/
+
 /* ////////////////////////////////////////////////////////////////////////// */
 /* / Zlib                                                                   / */
 /* ////////////////////////////////////////////////////////////////////////// */
@@ -2237,7 +2779,7 @@ unsigned lodepng_zlib_decompress(unsigned char** out, size_t* outsize, const uns
   error = inflate(out, outsize, in + 2, insize - 2, settings);
   if(error) return error;
 
-  if(!settings->ignore_adler32) {
+  if(!settings->ignore_adler32 && !settings->needed_size) {
     unsigned ADLER32 = lodepng_read32bitInt(&in[insize - 4]);
     unsigned checksum = adler32(*out, (unsigned)(*outsize));
     if(checksum != ADLER32) return 58; /*error, adler checksum not correct, data must be corrupted*/
@@ -2255,10 +2797,211 @@ static unsigned zlib_decompress(unsigned char** out, size_t* outsize, const unsi
   }
 }
 
+/*
+An inflater of a zlib stream given in pieces: streamInflate decodes as far as the input given so far allows and
+carries on from there when given more. Its last 32K of output are kept for the LZ77 back-references, so the caller
+can deliver the output as it comes and keep none of it. It only starts a step once it holds all the input that step
+could need, so a step never has to be undone.
+*/
+#define STREAM_WINDOWSIZE 32768u
+/*input for any literal, or length and distance, with their extra bits: 15 + 5 + 15 + 13 bits, starting anywhere
+in a byte*/
+#define STREAM_SYMBOL_BYTES 7u
+/*input for any block header: 3 + 14 + 19 * 3 + (286 + 30) * 7 bits, starting anywhere in a byte*/
+#define STREAM_HEADER_BYTES 288u
+
+typedef enum StreamStep {
+  STREAM_ZLIB_HEADER, STREAM_BLOCK_HEADER, STREAM_STORED, STREAM_HUFFMAN, STREAM_ADLER32, STREAM_END
+} StreamStep;
+
+typedef struct LodePNGStreamInflater {
+  ucvector in; /*input not used up yet*/
+  size_t bp; /*bit position in in.data of the next bit to read*/
+  unsigned final; /*set once all input has been given, so running out of it is an error*/
+  StreamStep step;
+  unsigned bfinal; /*the current block is the last*/
+  size_t stored; /*bytes left in the current stored block*/
+  size_t length, distance; /*bytes left to copy of the current back-reference, and how far back they are*/
+  HuffmanTree tree_ll, tree_d;
+  unsigned char* window;
+  size_t total; /*bytes output so far*/
+  unsigned adler;
+  const LodePNGDecompressSettings* settings;
+} LodePNGStreamInflater;
+
+static unsigned LodePNGStreamInflater_init(LodePNGStreamInflater* z, const LodePNGDecompressSettings* settings) {
+  ucvector_init(&z->in);
+  z->bp = 0;
+  z->final = 0;
+  z->step = STREAM_ZLIB_HEADER;
+  z->bfinal = 0;
+  z->stored = z->length = z->distance = 0;
+  HuffmanTree_init(&z->tree_ll);
+  HuffmanTree_init(&z->tree_d);
+  z->total = 0;
+  z->adler = 1u;
+  z->settings = settings;
+  z->window = (unsigned char*)lodepng_malloc(STREAM_WINDOWSIZE);
+  return z->window ? 0 : 83; /*alloc fail*/
+}
+
+static void LodePNGStreamInflater_cleanup(LodePNGStreamInflater* z) {
+  ucvector_cleanup(&z->in);
+  HuffmanTree_cleanup(&z->tree_ll);
+  HuffmanTree_cleanup(&z->tree_d);
+  lodepng_free(z->window);
+}
+
+/*adds more input, keeping only the bytes not used up yet*/
+static unsigned streamInflateInput(LodePNGStreamInflater* z, const unsigned char* in, size_t insize) {
+  size_t used = z->bp >> 3u, keep = z->in.size - used, i;
+  if(used) {
+    for(i = 0; i != keep; ++i) z->in.data[i] = z->in.data[used + i];
+    z->bp &= 7u;
+  }
+  if(!ucvector_resize(&z->in, keep + insize)) return 83; /*alloc fail*/
+  lodepng_memcpy(z->in.data + keep, in, insize);
+  return 0;
+}
+
+/*
+Inflates into out from *outpos until out is full at outsize, the input given so far runs out, or the zlib stream
+ends. Returns an error, which a stream that stops short is only once all input has been given.
+*/
+static unsigned streamInflate(LodePNGStreamInflater* z, unsigned char* out, size_t outsize, size_t* outpos) {
+  LodePNGBitReader reader;
+  size_t start = *outpos;
+  unsigned hungry = 0; /*the next step needs more input than there is*/
+  unsigned error = LodePNGBitReader_init(&reader, z->in.data, z->in.size);
+  reader.bp = z->bp;
+
+  while(!error && !hungry && z->step != STREAM_END) {
+    /*whole bytes left from the one holding the next bit*/
+    size_t avail = reader.size - (reader.bp >> 3u);
+
+    if(z->length != 0) {
+      if(*outpos == outsize) break;
+      do {
+        unsigned char c = z->window[(z->total - z->distance) & (STREAM_WINDOWSIZE - 1u)];
+        out[(*outpos)++] = c;
+        z->window[(z->total++) & (STREAM_WINDOWSIZE - 1u)] = c;
+      } while(--z->length != 0 && *outpos != outsize);
+    } else if(z->step == STREAM_ZLIB_HEADER) {
+      const unsigned char* in = reader.data;
+      if(avail < 2) { hungry = 1; continue; }
+      if((in[0] * 256 + in[1]) % 31 != 0) error = 24; /*FCHECK not a multiple of 31*/
+      else if((in[0] & 15) != 8 || ((in[0] >> 4) & 15) > 7) error = 25; /*only deflate with a window of 32K*/
+      else if((in[1] >> 5) & 1) error = 26; /*a preset dictionary is not allowed in PNG*/
+      reader.bp = 16;
+      z->step = STREAM_BLOCK_HEADER;
+    } else if(z->step == STREAM_BLOCK_HEADER) {
+      unsigned BTYPE;
+      if(z->bfinal) { z->step = STREAM_ADLER32; continue; }
+      if(avail < STREAM_HEADER_BYTES && !z->final) { hungry = 1; continue; }
+      if(!ensureBits9(&reader, 3)) { error = 52; continue; } /*error, bit pointer will jump past memory*/
+      z->bfinal = readBits(&reader, 1);
+      BTYPE = readBits(&reader, 2);
+      if(BTYPE == 3) {
+        error = 20; /*error: invalid BTYPE*/
+      } else if(BTYPE == 0) {
+        size_t bytepos = (reader.bp + 7u) >> 3u;
+        unsigned LEN, NLEN;
+        if(bytepos + 4 > reader.size) { error = 52; continue; } /*error, bit pointer will jump past memory*/
+        LEN = (unsigned)reader.data[bytepos] + ((unsigned)reader.data[bytepos + 1] << 8u);
+        NLEN = (unsigned)reader.data[bytepos + 2] + ((unsigned)reader.data[bytepos + 3] << 8u);
+        if(!z->settings->ignore_nlen && LEN + NLEN != 65535) error = 21; /*error: NLEN is not one's complement of LEN*/
+        reader.bp = (bytepos + 4) << 3u;
+        z->stored = LEN;
+        z->step = STREAM_STORED;
+      } else {
+        HuffmanTree_cleanup(&z->tree_ll);
+        HuffmanTree_cleanup(&z->tree_d);
+        HuffmanTree_init(&z->tree_ll);
+        HuffmanTree_init(&z->tree_d);
+        if(BTYPE == 1) getTreeInflateFixed(&z->tree_ll, &z->tree_d);
+        else error = getTreeInflateDynamic(&z->tree_ll, &z->tree_d, &reader);
+        z->step = STREAM_HUFFMAN;
+      }
+    } else if(z->step == STREAM_STORED) {
+      size_t n = z->stored, i;
+      if(n == 0) { z->step = STREAM_BLOCK_HEADER; continue; }
+      if(avail == 0) { if(z->final) error = 23; else hungry = 1; continue; } /*23: reading outside of in buffer*/
+      if(*outpos == outsize) break;
+      if(n > avail) n = avail;
+      if(n > outsize - *outpos) n = outsize - *outpos;
+      for(i = 0; i != n; ++i) {
+        unsigned char c = reader.data[(reader.bp >> 3u) + i];
+        out[(*outpos)++] = c;
+        z->window[(z->total++) & (STREAM_WINDOWSIZE - 1u)] = c;
+      }
+      reader.bp += n << 3u;
+      z->stored -= n;
+    } else if(z->step == STREAM_HUFFMAN) {
+      unsigned code_ll;
+      if(avail < STREAM_SYMBOL_BYTES && !z->final) { hungry = 1; continue; }
+      if(*outpos == outsize) break;
+      ensureBits25(&reader, 20); /* up to 15 for the huffman symbol, up to 5 for the length extra bits */
+      code_ll = huffmanDecodeSymbol(&reader, &z->tree_ll);
+      if(code_ll <= 255) {
+        out[(*outpos)++] = (unsigned char)code_ll;
+        z->window[(z->total++) & (STREAM_WINDOWSIZE - 1u)] = (unsigned char)code_ll;
+      } else if(code_ll >= FIRST_LENGTH_CODE_INDEX && code_ll <= LAST_LENGTH_CODE_INDEX) {
+        unsigned code_d;
+        z->length = LENGTHBASE[code_ll - FIRST_LENGTH_CODE_INDEX];
+        if(LENGTHEXTRA[code_ll - FIRST_LENGTH_CODE_INDEX] != 0) {
+          z->length += readBits(&reader, LENGTHEXTRA[code_ll - FIRST_LENGTH_CODE_INDEX]);
+        }
+        ensureBits32(&reader, 28); /* up to 15 for the huffman symbol, up to 13 for the extra bits */
+        code_d = huffmanDecodeSymbol(&reader, &z->tree_d);
+        if(code_d > 29) {
+          error = code_d <= 31 ? 18 : 16; /*invalid distance code (30-31 are never used), or disallowed symbol*/
+          continue;
+        }
+        z->distance = DISTANCEBASE[code_d];
+        if(DISTANCEEXTRA[code_d] != 0) z->distance += readBits(&reader, DISTANCEEXTRA[code_d]);
+        if(z->distance > z->total) error = 52; /*too long backward distance*/
+      } else if(code_ll == 256) {
+        z->step = STREAM_BLOCK_HEADER;
+      } else {
+        error = 16; /*error: tried to read disallowed huffman symbol*/
+      }
+      if(!error && reader.bp > reader.bitsize) error = 51; /*error, bit pointer jumps past memory*/
+    } else /*if(z->step == STREAM_ADLER32)*/ {
+      size_t bytepos = (reader.bp + 7u) >> 3u;
+      if(bytepos + 4 > reader.size) { if(z->final) error = 52; else hungry = 1; continue; }
+      if(!z->settings->ignore_adler32) {
+        z->adler = update_adler32(z->adler, out + start, (unsigned)(*outpos - start));
+        start = *outpos;
+        if(z->adler != lodepng_read32bitInt(&reader.data[bytepos])) error = 58; /*error, adler checksum not correct*/
+      }
+      reader.bp = (bytepos + 4) << 3u;
+      z->step = STREAM_END;
+    }
+  }
+
+  if(!z->settings->ignore_adler32) z->adler = update_adler32(z->adler, out + start, (unsigned)(*outpos - start));
+  z->bp = reader.bp;
+  return error;
+}
+
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 #ifdef LODEPNG_COMPILE_ENCODER
 
+/*writes the 2 bytes of zlib header*/
+static void writeZlibHeader(unsigned char* out) {
+  /*zlib data: 1 byte CMF (CM+CINFO), 1 byte FLG, deflate data, 4 byte ADLER32 checksum of the Decompressed data*/
+  unsigned CMF = 120; /*0b01111000: CM 8, CINFO 7. With CINFO 7, any window size up to 32768 can be used.*/
+  unsigned FLEVEL = 0;
+  unsigned FDICT = 0;
+  unsigned CMFFLG = 256 * CMF + FDICT * 32 + FLEVEL * 64;
+  unsigned FCHECK = 31 - CMFFLG % 31;
+  CMFFLG += FCHECK;
+
+  out[0] = (unsigned char)(CMFFLG >> 8);
+  out[1] = (unsigned char)(CMFFLG & 255);
+}
+
 unsigned lodepng_zlib_compress(unsigned char** out, size_t* outsize, const unsigned char* in,
                                size_t insize, const LodePNGCompressSettings* settings) {
   size_t i;
@@ -2278,16 +3021,7 @@ unsigned lodepng_zlib_compress(unsigned char** out, size_t* outsize, const unsig
 
   if(!error) {
     unsigned ADLER32 = adler32(in, (unsigned)insize);
-    /*zlib data: 1 byte CMF (CM+CINFO), 1 byte FLG, deflate data, 4 byte ADLER32 checksum of the Decompressed data*/
-    unsigned CMF = 120; /*0b01111000: CM 8, CINFO 7. With CINFO 7, any window size up to 32768 can be used.*/
-    unsigned FLEVEL = 0;
-    unsigned FDICT = 0;
-    unsigned CMFFLG = 256 * CMF + FDICT * 32 + FLEVEL * 64;
-    unsigned FCHECK = 31 - CMFFLG % 31;
-    CMFFLG += FCHECK;
-
-    (*out)[0] = (unsigned char)(CMFFLG >> 8);
-    (*out)[1] = (unsigned char)(CMFFLG & 255);
+    writeZlibHeader(*out);
     for(i = 0; i != deflatesize; ++i) (*out)[i + 2] = deflatedata[i];
     lodepng_set32bitInt(&(*out)[*outsize - 4], ADLER32);
   }
@@ -2358,13 +3092,15 @@ const LodePNGCompressSettings lodepng_default_compress_settings = {2, 1, DEFAULT
 void lodepng_decompress_settings_init(LodePNGDecompressSettings* settings) {
   settings->ignore_adler32 = 0;
   settings->ignore_nlen = 0;
+  settings->needed_size = 0;
+  settings->expected_size = 0;
 
   settings->custom_zlib = 0;
   settings->custom_inflate = 0;
   settings->custom_context = 0;
 }
 
-const LodePNGDecompressSettings lodepng_default_decompress_settings = {0, 0, 0, 0, 0};
+const LodePNGDecompressSettings lodepng_default_decompress_settings = {0, 0, 0, 0, 0, 0, 0};
 
 #endif /*LODEPNG_COMPILE_DECODER*/
 
@@ -2382,50 +3118,384 @@ const LodePNGDecompressSettings lodepng_default_decompress_settings = {0, 0, 0,
 
 
 #ifndef LODEPNG_NO_COMPILE_CRC
-/* CRC polynomial: 0xedb88320 */
-static unsigned lodepng_crc32_table[256] = {
-           0u, 1996959894u, 3993919788u, 2567524794u,  124634137u, 1886057615u, 3915621685u, 2657392035u,
-   249268274u, 2044508324u, 3772115230u, 2547177864u,  162941995u, 2125561021u, 3887607047u, 2428444049u,
-   498536548u, 1789927666u, 4089016648u, 2227061214u,  450548861u, 1843258603u, 4107580753u, 2211677639u,
-   325883990u, 1684777152u, 4251122042u, 2321926636u,  335633487u, 1661365465u, 4195302755u, 2366115317u,
-   997073096u, 1281953886u, 3579855332u, 2724688242u, 1006888145u, 1258607687u, 3524101629u, 2768942443u,
-   901097722u, 1119000684u, 3686517206u, 2898065728u,  853044451u, 1172266101u, 3705015759u, 2882616665u,
-   651767980u, 1373503546u, 3369554304u, 3218104598u,  565507253u, 1454621731u, 3485111705u, 3099436303u,
-   671266974u, 1594198024u, 3322730930u, 2970347812u,  795835527u, 1483230225u, 3244367275u, 3060149565u,
-  1994146192u,   31158534u, 2563907772u, 4023717930u, 1907459465u,  112637215u, 2680153253u, 3904427059u,
-  2013776290u,  251722036u, 2517215374u, 3775830040u, 2137656763u,  141376813u, 2439277719u, 3865271297u,
-  1802195444u,  476864866u, 2238001368u, 4066508878u, 1812370925u,  453092731u, 2181625025u, 4111451223u,
-  1706088902u,  314042704u, 2344532202u, 4240017532u, 1658658271u,  366619977u, 2362670323u, 4224994405u,
-  1303535960u,  984961486u, 2747007092u, 3569037538u, 1256170817u, 1037604311u, 2765210733u, 3554079995u,
-  1131014506u,  879679996u, 2909243462u, 3663771856u, 1141124467u,  855842277u, 2852801631u, 3708648649u,
-  1342533948u,  654459306u, 3188396048u, 3373015174u, 1466479909u,  544179635u, 3110523913u, 3462522015u,
-  1591671054u,  702138776u, 2966460450u, 3352799412u, 1504918807u,  783551873u, 3082640443u, 3233442989u,
-  3988292384u, 2596254646u,   62317068u, 1957810842u, 3939845945u, 2647816111u,   81470997u, 1943803523u,
-  3814918930u, 2489596804u,  225274430u, 2053790376u, 3826175755u, 2466906013u,  167816743u, 2097651377u,
-  4027552580u, 2265490386u,  503444072u, 1762050814u, 4150417245u, 2154129355u,  426522225u, 1852507879u,
-  4275313526u, 2312317920u,  282753626u, 1742555852u, 4189708143u, 2394877945u,  397917763u, 1622183637u,
-  3604390888u, 2714866558u,  953729732u, 1340076626u, 3518719985u, 2797360999u, 1068828381u, 1219638859u,
-  3624741850u, 2936675148u,  906185462u, 1090812512u, 3747672003u, 2825379669u,  829329135u, 1181335161u,
-  3412177804u, 3160834842u,  628085408u, 1382605366u, 3423369109u, 3138078467u,  570562233u, 1426400815u,
-  3317316542u, 2998733608u,  733239954u, 1555261956u, 3268935591u, 3050360625u,  752459403u, 1541320221u,
-  2607071920u, 3965973030u, 1969922972u,   40735498u, 2617837225u, 3943577151u, 1913087877u,   83908371u,
-  2512341634u, 3803740692u, 2075208622u,  213261112u, 2463272603u, 3855990285u, 2094854071u,  198958881u,
-  2262029012u, 4057260610u, 1759359992u,  534414190u, 2176718541u, 4139329115u, 1873836001u,  414664567u,
-  2282248934u, 4279200368u, 1711684554u,  285281116u, 2405801727u, 4167216745u, 1634467795u,  376229701u,
-  2685067896u, 3608007406u, 1308918612u,  956543938u, 2808555105u, 3495958263u, 1231636301u, 1047427035u,
-  2932959818u, 3654703836u, 1088359270u,  936918000u, 2847714899u, 3736837829u, 1202900863u,  817233897u,
-  3183342108u, 3401237130u, 1404277552u,  615818150u, 3134207493u, 3453421203u, 1423857449u,  601450431u,
-  3009837614u, 3294710456u, 1567103746u,  711928724u, 3020668471u, 3272380065u, 1510334235u,  755167117u
+/* CRC polynomial: 0xedb88320. Table k holds the CRC of each byte followed by k zero bytes, so eight bytes can be
+folded in at once (slicing-by-8). */
+static const unsigned lodepng_crc32_table[8][256] = {
+  {
+             0u, 1996959894u, 3993919788u, 2567524794u,  124634137u, 1886057615u, 3915621685u, 2657392035u,
+     249268274u, 2044508324u, 3772115230u, 2547177864u,  162941995u, 2125561021u, 3887607047u, 2428444049u,
+     498536548u, 1789927666u, 4089016648u, 2227061214u,  450548861u, 1843258603u, 4107580753u, 2211677639u,
+     325883990u, 1684777152u, 4251122042u, 2321926636u,  335633487u, 1661365465u, 4195302755u, 2366115317u,
+     997073096u, 1281953886u, 3579855332u, 2724688242u, 1006888145u, 1258607687u, 3524101629u, 2768942443u,
+     901097722u, 1119000684u, 3686517206u, 2898065728u,  853044451u, 1172266101u, 3705015759u, 2882616665u,
+     651767980u, 1373503546u, 3369554304u, 3218104598u,  565507253u, 1454621731u, 3485111705u, 3099436303u,
+     671266974u, 1594198024u, 3322730930u, 2970347812u,  795835527u, 1483230225u, 3244367275u, 3060149565u,
+    1994146192u,   31158534u, 2563907772u, 4023717930u, 1907459465u,  112637215u, 2680153253u, 3904427059u,
+    2013776290u,  251722036u, 2517215374u, 3775830040u, 2137656763u,  141376813u, 2439277719u, 3865271297u,
+    1802195444u,  476864866u, 2238001368u, 4066508878u, 1812370925u,  453092731u, 2181625025u, 4111451223u,
+    1706088902u,  314042704u, 2344532202u, 4240017532u, 1658658271u,  366619977u, 2362670323u, 4224994405u,
+    1303535960u,  984961486u, 2747007092u, 3569037538u, 1256170817u, 1037604311u, 2765210733u, 3554079995u,
+    1131014506u,  879679996u, 2909243462u, 3663771856u, 1141124467u,  855842277u, 2852801631u, 3708648649u,
+    1342533948u,  654459306u, 3188396048u, 3373015174u, 1466479909u,  544179635u, 3110523913u, 3462522015u,
+    1591671054u,  702138776u, 2966460450u, 3352799412u, 1504918807u,  783551873u, 3082640443u, 3233442989u,
+    3988292384u, 2596254646u,   62317068u, 1957810842u, 3939845945u, 2647816111u,   81470997u, 1943803523u,
+    3814918930u, 2489596804u,  225274430u, 2053790376u, 3826175755u, 2466906013u,  167816743u, 2097651377u,
+    4027552580u, 2265490386u,  503444072u, 1762050814u, 4150417245u, 2154129355u,  426522225u, 1852507879u,
+    4275313526u, 2312317920u,  282753626u, 1742555852u, 4189708143u, 2394877945u,  397917763u, 1622183637u,
+    3604390888u, 2714866558u,  953729732u, 1340076626u, 3518719985u, 2797360999u, 1068828381u, 1219638859u,
+    3624741850u, 2936675148u,  906185462u, 1090812512u, 3747672003u, 2825379669u,  829329135u, 1181335161u,
+    3412177804u, 3160834842u,  628085408u, 1382605366u, 3423369109u, 3138078467u,  570562233u, 1426400815u,
+    3317316542u, 2998733608u,  733239954u, 1555261956u, 3268935591u, 3050360625u,  752459403u, 1541320221u,
+    2607071920u, 3965973030u, 1969922972u,   40735498u, 2617837225u, 3943577151u, 1913087877u,   83908371u,
+    2512341634u, 3803740692u, 2075208622u,  213261112u, 2463272603u, 3855990285u, 2094854071u,  198958881u,
+    2262029012u, 4057260610u, 1759359992u,  534414190u, 2176718541u, 4139329115u, 1873836001u,  414664567u,
+    2282248934u, 4279200368u, 1711684554u,  285281116u, 2405801727u, 4167216745u, 1634467795u,  376229701u,
+    2685067896u, 3608007406u, 1308918612u,  956543938u, 2808555105u, 3495958263u, 1231636301u, 1047427035u,
+    2932959818u, 3654703836u, 1088359270u,  936918000u, 2847714899u, 3736837829u, 1202900863u,  817233897u,
+    3183342108u, 3401237130u, 1404277552u,  615818150u, 3134207493u, 3453421203u, 1423857449u,  601450431u,
+    3009837614u, 3294710456u, 1567103746u,  711928724u, 3020668471u, 3272380065u, 1510334235u,  755167117u
+  },
+  {
+             0u,  421212481u,  842424962u,  724390851u, 1684849924u, 2105013317u, 1448781702u, 1329698503u,
+    3369699848u, 3519200073u, 4210026634u, 3824474571u, 2897563404u, 3048111693u, 2659397006u, 2274893007u,
+    1254232657u, 1406739216u, 2029285587u, 1643069842u,  783210325u,  934667796u,  479770071u,   92505238u,
+    2182846553u, 2600511768u, 2955803355u, 2838940570u, 3866582365u, 4285295644u, 3561045983u, 3445231262u,
+    2508465314u, 2359236067u, 2813478432u, 3198777185u, 4058571174u, 3908292839u, 3286139684u, 3670389349u,
+    1566420650u, 1145479147u, 1869335592u, 1987116393u,  959540142u,  539646703u,  185010476u,  303839341u,
+    3745920755u, 3327985586u, 3983561841u, 4100678960u, 3140154359u, 2721170102u, 2300350837u, 2416418868u,
+     396344571u,  243568058u,  631889529u, 1018359608u, 1945336319u, 1793607870u, 1103436669u, 1490954812u,
+    4034481925u, 3915546180u, 3259968903u, 3679722694u, 2484439553u, 2366552896u, 2787371139u, 3208174018u,
+     950060301u,  565965900u,  177645455u,  328046286u, 1556873225u, 1171730760u, 1861902987u, 2011255754u,
+    3132841300u, 2745199637u, 2290958294u, 2442530455u, 3738671184u, 3352078609u, 3974232786u, 4126854035u,
+    1919080284u, 1803150877u, 1079293406u, 1498383519u,  370020952u,  253043481u,  607678682u, 1025720731u,
+    1711106983u, 2095471334u, 1472923941u, 1322268772u,   26324643u,  411738082u,  866634785u,  717028704u,
+    2904875439u, 3024081134u, 2668790573u, 2248782444u, 3376948395u, 3495106026u, 4219356713u, 3798300520u,
+     792689142u,  908347575u,  487136116u,   68299317u, 1263779058u, 1380486579u, 2036719216u, 1618931505u,
+    3890672638u, 4278043327u, 3587215740u, 3435896893u, 2206873338u, 2593195963u, 2981909624u, 2829542713u,
+     998479947u,  580430090u,  162921161u,  279890824u, 1609522511u, 1190423566u, 1842954189u, 1958874764u,
+    4082766403u, 3930137346u, 3245109441u, 3631694208u, 2536953671u, 2385372678u, 2768287173u, 3155920004u,
+    1900120602u, 1750776667u, 1131931800u, 1517083097u,  355290910u,  204897887u,  656092572u, 1040194781u,
+    3113746450u, 2692952403u, 2343461520u, 2461357009u, 3723805974u, 3304059991u, 4022511508u, 4141455061u,
+    2919742697u, 3072101800u, 2620513899u, 2234183466u, 3396041197u, 3547351212u, 4166851439u, 3779471918u,
+    1725839073u, 2143618976u, 1424512099u, 1307796770u,   45282277u,  464110244u,  813994343u,  698327078u,
+    3838160568u, 4259225593u, 3606301754u, 3488152955u, 2158586812u, 2578602749u, 2996767038u, 2877569151u,
+     740041904u,  889656817u,  506086962u,  120682355u, 1215357364u, 1366020341u, 2051441462u, 1667084919u,
+    3422213966u, 3538019855u, 4190942668u, 3772220557u, 2945847882u, 3062702859u, 2644537544u, 2226864521u,
+      52649286u,  439905287u,  823476164u,  672009861u, 1733269570u, 2119477507u, 1434057408u, 1281543041u,
+    2167981343u, 2552493150u, 3004082077u, 2853541596u, 3847487515u, 4233048410u, 3613549209u, 3464057816u,
+    1239502615u, 1358593622u, 2077699477u, 1657543892u,  764250643u,  882293586u,  532408465u,  111204816u,
+    1585378284u, 1197851309u, 1816695150u, 1968414767u,  974272232u,  587794345u,  136598634u,  289367339u,
+    2527558116u, 2411481253u, 2760973158u, 3179948583u, 4073438432u, 3956313505u, 3237863010u, 3655790371u,
+     347922877u,  229101820u,  646611775u, 1066513022u, 1892689081u, 1774917112u, 1122387515u, 1543337850u,
+    3697634229u, 3313392372u, 3998419255u, 4148705398u, 3087642289u, 2702352368u, 2319436851u, 2468674930u
+  },
+  {
+             0u,   29518391u,   59036782u,   38190681u,  118073564u,  114017003u,   76381362u,   89069189u,
+     236147128u,  265370511u,  228034006u,  206958561u,  152762724u,  148411219u,  178138378u,  190596925u,
+     472294256u,  501532999u,  530741022u,  509615401u,  456068012u,  451764635u,  413917122u,  426358261u,
+     305525448u,  334993663u,  296822438u,  275991697u,  356276756u,  352202787u,  381193850u,  393929805u,
+     944588512u,  965684439u, 1003065998u,  973863097u, 1061482044u, 1049003019u, 1019230802u, 1023561829u,
+     912136024u,  933002607u,  903529270u,  874031361u,  827834244u,  815125939u,  852716522u,  856752605u,
+     611050896u,  631869351u,  669987326u,  640506825u,  593644876u,  580921211u,  551983394u,  556069653u,
+     712553512u,  733666847u,  704405574u,  675154545u,  762387700u,  749958851u,  787859610u,  792175277u,
+    1889177024u, 1901651959u, 1931368878u, 1927033753u, 2006131996u, 1985040171u, 1947726194u, 1976933189u,
+    2122964088u, 2135668303u, 2098006038u, 2093965857u, 2038461604u, 2017599123u, 2047123658u, 2076625661u,
+    1824272048u, 1836991623u, 1866005214u, 1861914857u, 1807058540u, 1786244187u, 1748062722u, 1777547317u,
+    1655668488u, 1668093247u, 1630251878u, 1625932113u, 1705433044u, 1684323811u, 1713505210u, 1742760333u,
+    1222101792u, 1226154263u, 1263738702u, 1251046777u, 1339974652u, 1310460363u, 1281013650u, 1301863845u,
+    1187289752u, 1191637167u, 1161842422u, 1149379777u, 1103966788u, 1074747507u, 1112139306u, 1133218845u,
+    1425107024u, 1429406311u, 1467333694u, 1454888457u, 1408811148u, 1379576507u, 1350309090u, 1371438805u,
+    1524775400u, 1528845279u, 1499917702u, 1487177649u, 1575719220u, 1546255107u, 1584350554u, 1605185389u,
+    3778354048u, 3774312887u, 3803303918u, 3816007129u, 3862737756u, 3892238699u, 3854067506u, 3833203973u,
+    4012263992u, 4007927823u, 3970080342u, 3982554209u, 3895452388u, 3924658387u, 3953866378u, 3932773565u,
+    4245928176u, 4241609415u, 4271336606u, 4283762345u, 4196012076u, 4225268251u, 4187931714u, 4166823541u,
+    4076923208u, 4072833919u, 4035198246u, 4047918865u, 4094247316u, 4123732899u, 4153251322u, 4132437965u,
+    3648544096u, 3636082519u, 3673983246u, 3678331705u, 3732010428u, 3753090955u, 3723829714u, 3694611429u,
+    3614117080u, 3601426159u, 3572488374u, 3576541825u, 3496125444u, 3516976691u, 3555094634u, 3525581405u,
+    3311336976u, 3298595879u, 3336186494u, 3340255305u, 3260503756u, 3281337595u, 3251864226u, 3222399125u,
+    3410866088u, 3398419871u, 3368647622u, 3372945905u, 3427010420u, 3448139075u, 3485520666u, 3456284973u,
+    2444203584u, 2423127159u, 2452308526u, 2481530905u, 2527477404u, 2539934891u, 2502093554u, 2497740997u,
+    2679949304u, 2659102159u, 2620920726u, 2650438049u, 2562027300u, 2574714131u, 2603727690u, 2599670141u,
+    2374579504u, 2353749767u, 2383274334u, 2412743529u, 2323684844u, 2336421851u, 2298759554u, 2294686645u,
+    2207933576u, 2186809023u, 2149495014u, 2178734801u, 2224278612u, 2236720739u, 2266437690u, 2262135309u,
+    2850214048u, 2820717207u, 2858812622u, 2879680249u, 2934667388u, 2938704459u, 2909776914u, 2897069605u,
+    2817622296u, 2788420399u, 2759153014u, 2780249921u, 2700618180u, 2704950259u, 2742877610u, 2730399645u,
+    3049550800u, 3020298727u, 3057690558u, 3078802825u, 2999835404u, 3004150075u, 2974355298u, 2961925461u,
+    3151438440u, 3121956959u, 3092510214u, 3113327665u, 3168701108u, 3172786307u, 3210370778u, 3197646061u
+  },
+  {
+             0u, 3099354981u, 2852767883u,  313896942u, 2405603159u,  937357362u,  627793884u, 2648127673u,
+    3316918511u, 2097696650u, 1874714724u, 3607201537u, 1255587768u, 4067088605u, 3772741427u, 1482887254u,
+    1343838111u, 3903140090u, 4195393300u, 1118632049u, 3749429448u, 1741137837u, 1970407491u, 3452858150u,
+    2511175536u,  756094997u, 1067759611u, 2266550430u,  449832999u, 2725482306u, 2965774508u,  142231497u,
+    2687676222u,  412010587u,  171665333u, 2995192016u,  793786473u, 2548850444u, 2237264098u, 1038456711u,
+    1703315409u, 3711623348u, 3482275674u, 1999841343u, 3940814982u, 1381529571u, 1089329165u, 4166106984u,
+    4029413537u, 1217896388u, 1512189994u, 3802027855u, 2135519222u, 3354724499u, 3577784189u, 1845280792u,
+     899665998u, 2367928107u, 2677414085u,  657096608u, 3137160985u,   37822588u,  284462994u, 2823350519u,
+    2601801789u,  598228824u,  824021174u, 2309093331u,  343330666u, 2898962447u, 3195996129u,  113467524u,
+    1587572946u, 3860600759u, 4104763481u, 1276501820u, 3519211397u, 1769898208u, 2076913422u, 3279374443u,
+    3406630818u, 1941006535u, 1627703081u, 3652755532u, 1148164341u, 4241751952u, 3999682686u, 1457141531u,
+     247015245u, 3053797416u, 2763059142u,  470583459u, 2178658330u,  963106687u,  735213713u, 2473467892u,
+     992409347u, 2207944806u, 2435792776u,  697522413u, 3024379988u,  217581361u,  508405983u, 2800865210u,
+    4271038444u, 1177467017u, 1419450215u, 3962007554u, 1911572667u, 3377213406u, 3690561584u, 1665525589u,
+    1799331996u, 3548628985u, 3241568279u, 2039091058u, 3831314379u, 1558270126u, 1314193216u, 4142438437u,
+    2928380019u,  372764438u,   75645176u, 3158189981u,  568925988u, 2572515393u, 2346768303u,  861712586u,
+    3982079547u, 1441124702u, 1196457648u, 4293663189u, 1648042348u, 3666298377u, 3358779879u, 1888390786u,
+     686661332u, 2421291441u, 2196002399u,  978858298u, 2811169155u,  523464422u,  226935048u, 3040519789u,
+    3175145892u,  100435649u,  390670639u, 2952089162u,  841119475u, 2325614998u, 2553003640u,  546822429u,
+    2029308235u, 3225988654u, 3539796416u, 1782671013u, 4153826844u, 1328167289u, 1570739863u, 3844338162u,
+    1298864389u, 4124540512u, 3882013070u, 1608431339u, 3255406162u, 2058742071u, 1744848601u, 3501990332u,
+    2296328682u,  811816591u,  584513889u, 2590678532u,  129869501u, 3204563416u, 2914283062u,  352848211u,
+     494030490u, 2781751807u, 3078325777u,  264757620u, 2450577869u,  715964072u,  941166918u, 2158327331u,
+    3636881013u, 1618608400u, 1926213374u, 3396585883u, 1470427426u, 4011365959u, 4255988137u, 1158766284u,
+    1984818694u, 3471935843u, 3695453837u, 1693991400u, 4180638033u, 1100160564u, 1395044826u, 3952793279u,
+    3019491049u,  189112716u,  435162722u, 2706139399u, 1016811966u, 2217162459u, 2526189877u,  774831696u,
+     643086745u, 2666061564u, 2354934034u,  887166583u, 2838900430u,  294275499u,   54519365u, 3145957664u,
+    3823145334u, 1532818963u, 1240029693u, 4048895640u, 1820460577u, 3560857924u, 3331051178u, 2117577167u,
+    3598663992u, 1858283101u, 2088143283u, 3301633750u, 1495127663u, 3785470218u, 4078182116u, 1269332353u,
+     332098007u, 2876706482u, 3116540252u,   25085497u, 2628386432u,  605395429u,  916469259u, 2384220526u,
+    2254837415u, 1054503362u,  745528876u, 2496903497u,  151290352u, 2981684885u, 2735556987u,  464596510u,
+    1137851976u, 4218313005u, 3923506883u, 1365741990u, 3434129695u, 1946996346u, 1723425172u, 3724871409u
+  },
+  {
+             0u, 1029712304u, 2059424608u, 1201699536u, 4118849216u, 3370159984u, 2403399072u, 2988497936u,
+     812665793u,  219177585u, 1253054625u, 2010132753u, 3320900865u, 4170237105u, 3207642721u, 2186319825u,
+    1625331586u, 1568718386u,  438355170u,  658566482u, 2506109250u, 2818578674u, 4020265506u, 3535817618u,
+    1351670851u, 1844508147u,  709922595u,  389064339u, 2769320579u, 2557498163u, 3754961379u, 3803185235u,
+    3250663172u, 4238411444u, 3137436772u, 2254525908u,  876710340u,  153198708u, 1317132964u, 1944187668u,
+    4054934725u, 3436268917u, 2339452837u, 3054575125u,   70369797u,  961670069u, 2129760613u, 1133623509u,
+    2703341702u, 2621542710u, 3689016294u, 3867263574u, 1419845190u, 1774270454u,  778128678u,  318858390u,
+    2438067015u, 2888948471u, 3952189479u, 3606153623u, 1691440519u, 1504803895u,  504432359u,  594620247u,
+    1492342857u, 1704161785u,  573770537u,  525542041u, 2910060169u, 2417219385u, 3618876905u, 3939730521u,
+    1753420680u, 1440954936u,  306397416u,  790849880u, 2634265928u, 2690882808u, 3888375336u, 3668168600u,
+     940822475u,   91481723u, 1121164459u, 2142483739u, 3448989963u, 4042473659u, 3075684971u, 2318603227u,
+     140739594u,  889433530u, 1923340138u, 1338244826u, 4259521226u, 3229813626u, 2267247018u, 3124975642u,
+    2570221389u, 2756861693u, 3824297005u, 3734113693u, 1823658381u, 1372780605u,  376603373u,  722643805u,
+    2839690380u, 2485261628u, 3548540908u, 4007806556u, 1556257356u, 1638052860u,  637716780u,  459464860u,
+    4191346895u, 3300051327u, 2199040943u, 3195181599u,  206718479u,  825388991u, 1989285231u, 1274166495u,
+    3382881038u, 4106388158u, 3009607790u, 2382549470u, 1008864718u,   21111934u, 1189240494u, 2072147742u,
+    2984685714u, 2357631266u, 3408323570u, 4131834434u, 1147541074u, 2030452706u, 1051084082u,   63335554u,
+    2174155603u, 3170292451u, 4216760371u, 3325460867u, 1947622803u, 1232499747u,  248909555u,  867575619u,
+    3506841360u, 3966111392u, 2881909872u, 2527485376u,  612794832u,  434546784u, 1581699760u, 1663499008u,
+    3782634705u, 3692447073u, 2612412337u, 2799048193u,  351717905u,  697754529u, 1849071985u, 1398190273u,
+    1881644950u, 1296545318u,  182963446u,  931652934u, 2242328918u, 3100053734u, 4284967478u, 3255255942u,
+    1079497815u, 2100821479u,  983009079u,  133672583u, 3050795671u, 2293717799u, 3474399735u, 4067887175u,
+     281479188u,  765927844u, 1778867060u, 1466397380u, 3846680276u, 3626469220u, 2676489652u, 2733102084u,
+     548881365u,  500656741u, 1517752501u, 1729575173u, 3577210133u, 3898068133u, 2952246901u, 2459410373u,
+    3910527195u, 3564487019u, 2480257979u, 2931134987u,  479546907u,  569730987u, 1716854139u, 1530213579u,
+    3647316762u, 3825568426u, 2745561210u, 2663766474u,  753206746u,  293940330u, 1445287610u, 1799716618u,
+    2314567513u, 3029685993u, 4080348217u, 3461678473u, 2088098201u, 1091956777u,  112560889u, 1003856713u,
+    3112514712u, 2229607720u, 3276105720u, 4263857736u, 1275433560u, 1902492648u,  918929720u,  195422344u,
+     685033439u,  364179055u, 1377080511u, 1869921551u, 3713294623u, 3761522863u, 2811507327u, 2599689167u,
+     413436958u,  633644462u, 1650777982u, 1594160846u, 3978570462u, 3494118254u, 2548332990u, 2860797966u,
+    1211387997u, 1968470509u,  854852413u,  261368461u, 3182753437u, 2161434413u, 3346310653u, 4195650637u,
+    2017729436u, 1160000044u,   42223868u, 1071931724u, 2378480988u, 2963576044u, 4144295484u, 3395602316u
+  },
+  {
+             0u, 3411858341u, 1304994059u, 2257875630u, 2609988118u, 1355649459u, 3596215069u,  486879416u,
+    3964895853u,  655315400u, 2711298918u, 1791488195u, 2009251963u, 3164476382u,  973758832u, 4048990933u,
+      64357019u, 3364540734u, 1310630800u, 2235723829u, 2554806413u, 1394316072u, 3582976390u,  517157411u,
+    4018503926u,  618222419u, 2722963965u, 1762783832u, 1947517664u, 3209171269u,  970744811u, 4068520014u,
+     128714038u, 3438335635u, 1248109629u, 2167961496u, 2621261600u, 1466012805u, 3522553387u,  447296910u,
+    3959392091u,  547575038u, 2788632144u, 1835791861u, 1886307661u, 3140622056u, 1034314822u, 4143626211u,
+      75106221u, 3475428360u, 1236444838u, 2196665603u, 2682996155u, 1421317662u, 3525567664u,  427767573u,
+    3895035328u,  594892389u, 2782995659u, 1857943406u, 1941489622u, 3101955187u, 1047553757u, 4113347960u,
+     257428076u, 3288652233u, 1116777319u, 2311878850u, 2496219258u, 1603640287u, 3640781169u,  308099796u,
+    3809183745u,  676813732u, 2932025610u, 1704983215u, 2023410199u, 3016104370u,  894593820u, 4262377657u,
+     210634999u, 3352484690u, 1095150076u, 2316991065u, 2535410401u, 1547934020u, 3671583722u,  294336591u,
+    3772615322u,  729897279u, 2903845777u, 1716123700u, 2068629644u, 2953845545u,  914647431u, 4258839074u,
+     150212442u, 3282623743u, 1161604689u, 2388688372u, 2472889676u, 1480171241u, 3735940167u,  368132066u,
+    3836185911u,  805002898u, 2842635324u, 1647574937u, 2134298401u, 3026852996u,  855535146u, 4188192143u,
+     186781121u, 3229539940u, 1189784778u, 2377547631u, 2427670487u, 1542429810u, 3715886812u,  371670393u,
+    3882979244u,  741170185u, 2864262823u, 1642462466u, 2095107514u, 3082559007u,  824732849u, 4201955092u,
+     514856152u, 3589064573u, 1400419795u, 2552522358u, 2233554638u, 1316849003u, 3370776517u,   62202976u,
+    4075001525u,  968836368u, 3207280574u, 1954014235u, 1769133219u, 2720925446u,  616199592u, 4024870413u,
+     493229635u, 3594175974u, 1353627464u, 2616354029u, 2264355925u, 1303087088u, 3409966430u,    6498043u,
+    4046820398u,  979978123u, 3170710821u, 2007099008u, 1789187640u, 2717386141u,  661419827u, 3962610838u,
+     421269998u, 3527459403u, 1423225061u, 2676515648u, 2190300152u, 1238466653u, 3477467891u,   68755798u,
+    4115633027u, 1041448998u, 3095868040u, 1943789869u, 1860096405u, 2776760880u,  588673182u, 3897205563u,
+     449450869u, 3516317904u, 1459794558u, 2623431131u, 2170245475u, 1242006214u, 3432247400u,  131015629u,
+    4137259288u, 1036337853u, 3142660115u, 1879958454u, 1829294862u, 2790523051u,  549483013u, 3952910752u,
+     300424884u, 3669282065u, 1545650111u, 2541513754u, 2323209378u, 1092980487u, 3350330793u,  216870412u,
+    4256931033u,  921128828u, 2960342482u, 2066738807u, 1714085583u, 2910195050u,  736264132u, 3770592353u,
+     306060335u, 3647131530u, 1610005796u, 2494197377u, 2309971513u, 1123257756u, 3295149874u,  255536279u,
+    4268596802u,  892423655u, 3013951305u, 2029645036u, 1711070292u, 2929725425u,  674528607u, 3815288570u,
+     373562242u, 3709388839u, 1535949449u, 2429577516u, 2379569556u, 1183418929u, 3223189663u,  188820282u,
+    4195850735u,  827017802u, 3084859620u, 2089020225u, 1636228089u, 2866415708u,  743340786u, 3876759895u,
+     361896217u, 3738094268u, 1482340370u, 2466671543u, 2382584591u, 1163888810u, 3284924932u,  144124321u,
+    4190215028u,  849168593u, 3020503679u, 2136336858u, 1649465698u, 2836138695u,  798521449u, 3838094284u
+  },
+  {
+             0u, 2792819636u, 2543784233u,  837294749u, 4098827283u, 1379413927u, 1674589498u, 3316072078u,
+     871321191u, 2509784531u, 2758827854u,   34034938u, 3349178996u, 1641505216u, 1346337629u, 4131942633u,
+    1742642382u, 3249117050u, 4030828007u, 1446413907u, 2475800797u,  904311657u,   68069876u, 2725880384u,
+    1412551337u, 4064729373u, 3283010432u, 1708771380u, 2692675258u,  101317902u,  937551763u, 2442587175u,
+    3485284764u, 1774858792u, 1478633653u, 4266992385u, 1005723023u, 2642744891u, 2892827814u,  169477906u,
+    4233263099u, 1512406095u, 1808623314u, 3451546982u,  136139752u, 2926205020u, 2676114113u,  972376437u,
+    2825102674u,  236236518u, 1073525883u, 2576072655u, 1546420545u, 4200303349u, 3417542760u, 1841601500u,
+    2609703733u, 1039917185u,  202635804u, 2858742184u, 1875103526u, 3384067218u, 4166835727u, 1579931067u,
+    1141601657u, 3799809741u, 3549717584u, 1977839588u, 2957267306u,  372464350u,  668680259u, 2175552503u,
+    2011446046u, 3516084394u, 3766168119u, 1175200131u, 2209029901u,  635180217u,  338955812u, 2990736784u,
+     601221559u, 2242044419u, 3024812190u,  306049834u, 3617246628u, 1911408144u, 1074125965u, 3866285881u,
+     272279504u, 3058543716u, 2275784441u,  567459149u, 3832906691u, 1107462263u, 1944752874u, 3583875422u,
+    2343980261u,  767641425u,  472473036u, 3126744696u, 2147051766u, 3649987394u, 3899029983u, 1309766251u,
+    3092841090u,  506333494u,  801510315u, 2310084639u, 1276520081u, 3932237093u, 3683203000u, 2113813516u,
+    3966292011u, 1243601823u, 2079834370u, 3716205238u,  405271608u, 3192979340u, 2411259153u,  701492901u,
+    3750207052u, 2045810168u, 1209569125u, 4000285905u,  734575199u, 2378150379u, 3159862134u,  438345922u,
+    2283203314u,  778166598u,  529136603u, 3120492655u, 2086260449u, 3660498261u, 3955679176u, 1303499900u,
+    3153699989u,  495890209u,  744928700u, 2316418568u, 1337360518u, 3921775410u, 3626602927u, 2120129051u,
+    4022892092u, 1237286280u, 2018993941u, 3726666913u,  461853231u, 3186645403u, 2350400262u,  711936178u,
+    3693557851u, 2052076527u, 1270360434u, 3989775046u,  677911624u, 2384402428u, 3220639073u,  427820757u,
+    1202443118u, 3789347034u, 3493118535u, 1984154099u, 3018127229u,  362020041u,  612099668u, 2181885408u,
+    1950653705u, 3526596285u, 3822816288u, 1168934804u, 2148251930u,  645706414u,  395618355u, 2984485767u,
+     544559008u, 2248295444u, 3085590153u,  295523645u, 3560598451u, 1917673479u, 1134918298u, 3855773998u,
+     328860103u, 3052210803u, 2214924526u,  577903450u, 3889505748u, 1101147744u, 1883911421u, 3594338121u,
+    3424493451u, 1785369663u, 1535282850u, 4260726038u,  944946072u, 2653270060u, 2949491377u,  163225861u,
+    4294103532u, 1501944408u, 1752023237u, 3457862513u,  196998655u, 2915761739u, 2619532502u,  978710370u,
+    2881684293u,  229902577u, 1012666988u, 2586515928u, 1603020630u, 4193987810u, 3356702335u, 1852063179u,
+    2553040162u, 1046169238u,  263412747u, 2848217023u, 1818454321u, 3390333573u, 4227627032u, 1569420204u,
+      60859927u, 2782375331u, 2487203646u,  843627658u, 4159668740u, 1368951216u, 1617990445u, 3322386585u,
+     810543216u, 2520310724u, 2815490393u,   27783917u, 3288386659u, 1652017111u, 1402985802u, 4125677310u,
+    1685994201u, 3255382381u, 4091620336u, 1435902020u, 2419138250u,  910562686u,  128847843u, 2715354199u,
+    1469150398u, 4058414858u, 3222168983u, 1719234083u, 2749255853u,   94984985u,  876691844u, 2453031472u
+  },
+  {
+             0u, 3433693342u, 1109723005u, 2391738339u, 2219446010u, 1222643300u, 3329165703u,  180685081u,
+    3555007413u,  525277995u, 2445286600u, 1567235158u, 1471092047u, 2600801745u,  361370162u, 3642757804u,
+    2092642603u, 2953916853u, 1050555990u, 4063508168u, 4176560081u,  878395215u, 3134470316u, 1987983410u,
+    2942184094u, 1676945920u, 3984272867u,  567356797u,  722740324u, 3887998202u, 1764827929u, 2778407815u,
+    4185285206u,  903635656u, 3142804779u, 2012833205u, 2101111980u, 2979425330u, 1058630609u, 4088621903u,
+     714308067u, 3862526333u, 1756790430u, 2753330688u, 2933487385u, 1651734407u, 3975966820u,  542535930u,
+    2244825981u, 1231508451u, 3353891840u,  188896414u,   25648519u, 3442302233u, 1134713594u, 2399689316u,
+    1445480648u, 2592229462u,  336416693u, 3634843435u, 3529655858u,  516441772u, 2420588879u, 1559052753u,
+     698204909u, 3845636723u, 1807271312u, 2803025166u, 2916600855u, 1635634313u, 4025666410u,  593021940u,
+    4202223960u,  919787974u, 3093159461u, 1962401467u, 2117261218u, 2996361020u, 1008193759u, 4038971457u,
+    1428616134u, 2576151384u,  386135227u, 3685348389u, 3513580860u,  499580322u, 2471098945u, 1608776415u,
+    2260985971u, 1248454893u, 3303468814u,  139259792u,   42591881u, 3458459159u, 1085071860u, 2349261162u,
+    3505103035u,  474062885u, 2463016902u, 1583654744u, 1419882049u, 2550902495u,  377792828u, 3660491170u,
+      51297038u, 3483679632u, 1093385331u, 2374089965u, 2269427188u, 1273935210u, 3311514249u,  164344343u,
+    2890961296u, 1627033870u, 4000683757u,  585078387u,  672833386u, 3836780532u, 1782552599u, 2794821769u,
+    2142603813u, 3005188795u, 1032883544u, 4047146438u, 4227826911u,  928351297u, 3118105506u, 1970307900u,
+    1396409818u, 2677114180u,  287212199u, 3719594553u, 3614542624u,  467372990u, 2505346141u, 1509854403u,
+    2162073199u, 1282711281u, 3271268626u,  240228748u,   76845205u, 3359543307u, 1186043880u, 2317064054u,
+     796964081u, 3811226735u, 1839575948u, 2702160658u, 2882189835u, 1734392469u, 3924802934u,  625327592u,
+    4234522436u,  818917338u, 3191908409u, 1927981223u, 2016387518u, 3028656416u,  973776579u, 4137723485u,
+    2857232268u, 1726474002u, 3899187441u,  616751215u,  772270454u, 3803048424u, 1814228491u, 2693328533u,
+    2041117753u, 3036871847u,  999160644u, 4146592730u, 4259508931u,  826864221u, 3217552830u, 1936586016u,
+    3606501031u,  442291769u, 2496909786u, 1484378436u, 1388107869u, 2652297411u,  278519584u, 3694387134u,
+      85183762u, 3384397196u, 1194773103u, 2342308593u, 2170143720u, 1307820918u, 3279733909u,  265733131u,
+    2057717559u, 3054258089u,  948125770u, 4096344276u, 4276898253u,  843467091u, 3167309488u, 1885556270u,
+    2839764098u, 1709792284u, 3949353983u,  667704161u,  755585656u, 3785577190u, 1865176325u, 2743489947u,
+     102594076u, 3401021058u, 1144549729u, 2291298815u, 2186770662u, 1325234296u, 3228729243u,  215514885u,
+    3589828009u,  424832311u, 2547870420u, 1534552650u, 1370645331u, 2635621325u,  328688686u, 3745342640u,
+    2211456353u, 1333405183u, 3254067740u,  224338562u,  127544219u, 3408931589u, 1170156774u, 2299866232u,
+    1345666772u, 2627681866u,  303053225u, 3736746295u, 3565105198u,  416624816u, 2522494803u, 1525692365u,
+    4285207626u,  868291796u, 3176010551u, 1910772649u, 2065767088u, 3079346734u,  956571085u, 4121828691u,
+     747507711u, 3760459617u, 1856702594u, 2717976604u, 2831417605u, 1684930971u, 3940615800u,  642451174u
+  }
 };
 
+static unsigned crc32Slicing(unsigned r, const unsigned char* data, size_t length) {
+  for(; length >= 8; data += 8, length -= 8) {
+    unsigned lo = r ^ (data[0] | ((unsigned)data[1] << 8u) | ((unsigned)data[2] << 16u) | ((unsigned)data[3] << 24u));
+    unsigned hi = data[4] | ((unsigned)data[5] << 8u) | ((unsigned)data[6] << 16u) | ((unsigned)data[7] << 24u);
+    r = lodepng_crc32_table[7][lo & 0xffu] ^ lodepng_crc32_table[6][(lo >> 8u) & 0xffu]
+      ^ lodepng_crc32_table[5][(lo >> 16u) & 0xffu] ^ lodepng_crc32_table[4][lo >> 24u]
+      ^ lodepng_crc32_table[3][hi & 0xffu] ^ lodepng_crc32_table[2][(hi >> 8u) & 0xffu]
+      ^ lodepng_crc32_table[1][(hi >> 16u) & 0xffu] ^ lodepng_crc32_table[0][hi >> 24u];
+  }
+  for(; length != 0; ++data, --length) r = lodepng_crc32_table[0][(r ^ *data) & 0xffu] ^ (r >> 8u);
+  return r;
+}
+
+#ifdef LODEPNG_SIMD_X86_EXTENSIONS
+/*
+Folds the data into the CRC 64 bytes at a time with carry-less multiplies, then reduces it to 32 bits, after Intel's
+"Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction". length must be at least 64 and a
+multiple of 16. r is the CRC register before the data, as in crc32Slicing.
+*/
+LODEPNG_TARGET("pclmul") static unsigned crc32PCLMUL(unsigned r, const unsigned char* data, size_t length) {
+  const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596ll, 0x0154442bd4ll);
+  const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009ell, 0x01751997d0ll);
+  const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124ll);
+  const __m128i poly = _mm_set_epi64x(0x01f7011641ll, 0x01db710641ll);
+  const __m128i low32 = _mm_setr_epi32(-1, 0, -1, 0);
+  __m128i x1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)data), _mm_cvtsi32_si128((int)r));
+  __m128i x2 = _mm_loadu_si128((const __m128i*)(data + 16));
+  __m128i x3 = _mm_loadu_si128((const __m128i*)(data + 32));
+  __m128i x4 = _mm_loadu_si128((const __m128i*)(data + 48));
+  __m128i x5;
+  data += 64;
+  length -= 64;
+
+  /*four lanes of 16 bytes, each folded 64 bytes ahead*/
+  for(; length >= 64; data += 64, length -= 64) {
+    x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k1k2, 0x11), x5),
+                       _mm_loadu_si128((const __m128i*)data));
+    x5 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+    x2 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x2, k1k2, 0x11), x5),
+                       _mm_loadu_si128((const __m128i*)(data + 16)));
+    x5 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+    x3 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x3, k1k2, 0x11), x5),
+                       _mm_loadu_si128((const __m128i*)(data + 32)));
+    x5 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+    x4 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x4, k1k2, 0x11), x5),
+                       _mm_loadu_si128((const __m128i*)(data + 48)));
+  }
+
+  /*the lanes folded into one, then the remaining 16 byte blocks into that*/
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x2), x5);
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x3), x5);
+  x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x4), x5);
+  for(; length >= 16; data += 16, length -= 16) {
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), _mm_loadu_si128((const __m128i*)data)), x5);
+  }
+
+  /*128 bits down to 64, then a Barrett reduction to 32*/
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), _mm_clmulepi64_si128(x1, k3k4, 0x10));
+  x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, low32), k5k0, 0x00), _mm_srli_si128(x1, 4));
+  x5 = _mm_clmulepi64_si128(_mm_and_si128(x1, low32), poly, 0x10);
+  x5 = _mm_clmulepi64_si128(_mm_and_si128(x5, low32), poly, 0x00);
+  return (unsigned)_mm_cvtsi128_si32(_mm_srli_si128(_mm_xor_si128(x1, x5), 4));
+}
+#endif /*LODEPNG_SIMD_X86_EXTENSIONS*/
+
+#ifdef LODEPNG_SIMD_ARM_CRC32
+LODEPNG_ARM_CRC32_TARGET static unsigned crc32ARM(unsigned r, const unsigned char* data, size_t length) {
+  for(; length >= 8; data += 8, length -= 8) {
+    unsigned long long word;
+    lodepng_memcpy(&word, data, 8);
+    r = __crc32d(r, word);
+  }
+  for(; length != 0; ++data, --length) r = __crc32b(r, *data);
+  return r;
+}
+#endif /*LODEPNG_SIMD_ARM_CRC32*/
+
+/*Continue the CRC r, kept without its final inversion, over more bytes*/
+static unsigned crc32Update(unsigned r, const unsigned char* data, size_t length) {
+#if defined(LODEPNG_SIMD_ARM_CRC32)
+  if(lodepng_cpu_has_crc32()) return crc32ARM(r, data, length);
+#endif /*LODEPNG_SIMD_ARM_CRC32*/
+#if defined(LODEPNG_SIMD_X86_EXTENSIONS)
+  if(length >= 64 && lodepng_cpu_has(LODEPNG_CPU_PCLMUL)) {
+    size_t folded = length & ~(size_t)15u;
+    r = crc32PCLMUL(r, data, folded);
+    data += folded;
+    length -= folded;
+  }
+#endif /*LODEPNG_SIMD_X86_EXTENSIONS*/
+  return crc32Slicing(r, data, length);
+}
+
 /*Return the CRC of the bytes buf[0..len-1].*/
 unsigned lodepng_crc32(const unsigned char* data, size_t length) {
-  unsigned r = 0xffffffffu;
-  size_t i;
-  for(i = 0; i < length; ++i) {
-    r = lodepng_crc32_table[(r ^ data[i]) & 0xffu] ^ (r >> 8u);
-  }
-  return r ^ 0xffffffffu;
+  return crc32Update(0xffffffffu, data, length) ^ 0xffffffffu;
 }
 #else /* !LODEPNG_NO_COMPILE_CRC */
 unsigned lodepng_crc32(const unsigned char* data, size_t length);
@@ -3573,6 +4643,73 @@ unsigned lodepng_convert(unsigned char* out, const unsigned char* in,
 }
 
 
+/*pixels taken to RGBA 8-bit at a time on their way to the planes: a multiple of 8, so each batch of pixels smaller
+than a byte starts at a byte*/
+#define PLANAR_BATCH 64u
+
+/*stores each channel of count RGBA 8-bit pixels in its plane, from index on*/
+static void storePlanes(const LodePNGPlanes* out, size_t index, const unsigned char* rgba, size_t count) {
+  unsigned c;
+  size_t i;
+  for(c = 0; c != 4; ++c) {
+    if(!out->planes[c]) continue;
+    if(out->floats) {
+      float* plane = (float*)out->planes[c] + index;
+      i = 0;
+#if defined(LODEPNG_SIMD_SSE2)
+      {
+        /*four pixels' worth of one channel, shifted down to the bottom byte of each 32-bit lane*/
+        const __m128i shift = _mm_cvtsi32_si128((int)(c * 8u));
+        const __m128i mask = _mm_set1_epi32(255);
+        const __m128 scale = _mm_set1_ps(out->scale);
+        for(; i + 4u <= count; i += 4u) {
+          __m128i v = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i*)(rgba + i * 4u)), shift), mask);
+          _mm_storeu_ps(plane + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+        }
+      }
+#elif defined(LODEPNG_SIMD_NEON)
+      {
+        const int32x4_t shift = vdupq_n_s32(-(int)(c * 8u));
+        const uint32x4_t mask = vdupq_n_u32(255);
+        for(; i + 4u <= count; i += 4u) {
+          uint32x4_t v = vandq_u32(vshlq_u32(vreinterpretq_u32_u8(vld1q_u8(rgba + i * 4u)), shift), mask);
+          vst1q_f32(plane + i, vmulq_n_f32(vcvtq_f32_u32(v), out->scale));
+        }
+      }
+#endif /*LODEPNG_SIMD_SSE2*/
+      for(; i != count; ++i) plane[i] = (float)rgba[i * 4u + c] * out->scale;
+    } else {
+      unsigned char* plane = (unsigned char*)out->planes[c] + index;
+      for(i = 0; i != count; ++i) plane[i] = rgba[i * 4u + c];
+    }
+  }
+}
+
+unsigned lodepng_convert_planar(const LodePNGPlanes* out, const unsigned char* in,
+                                const LodePNGColorMode* mode_in, unsigned w, unsigned h) {
+  unsigned char rgba[PLANAR_BATCH * 4u];
+  size_t numpixels = (size_t)w * (size_t)h;
+  size_t bpp = lodepng_get_bpp(mode_in);
+  size_t p, i, n;
+
+  if(mode_in->colortype == LCT_PALETTE && !mode_in->palette) {
+    return 107; /* error: must provide palette if input mode is palette */
+  }
+
+  for(p = 0; p < numpixels; p += n) {
+    n = numpixels - p < PLANAR_BATCH ? numpixels - p : PLANAR_BATCH;
+    getPixelColorsRGBA8(rgba, n, in + p * bpp / 8u, mode_in);
+    /*a batch may run over the end of a row*/
+    for(i = 0; i != n;) {
+      size_t x = (p + i) % w, run = w - x;
+      if(run > n - i) run = n - i;
+      storePlanes(out, (p + i) / w * out->stride + x, rgba + i * 4u, run);
+      i += run;
+    }
+  }
+  return 0;
+}
+
 /* Converts a single rgb color without alpha from one type to another, color bits truncated to
 their bitdepth. In case of single channel (gray or palette), only the r channel is used. Slow
 function, do not use to process all pixels of an image. Alpha channel not supported on purpose:
@@ -4068,6 +5205,271 @@ unsigned lodepng_inspect(unsigned* w, unsigned* h, LodePNGState* state,
   return state->error;
 }
 
+#if defined(LODEPNG_SIMD_SSE2) || defined(LODEPNG_SIMD_NEON)
+/*
+The SIMD unfilters keep one pixel per vector and walk the scanline pixel by pixel, as sub, average and paeth depend
+on the pixel before. They read whole 4 or 8 byte words where the scanline has that many bytes left, and write only
+the pixel's own bytes: recon may lie just before scanline in the same buffer, so writing further could overwrite
+bytes not yet read. length is a multiple of bytewidth, which is 3, 4, 6 or 8. These functions are meant to be
+inlined with a constant bytewidth.
+*/
+#ifdef LODEPNG_SIMD_SSE2
+static LODEPNG_INLINE __m128i loadPixelSSE2(const unsigned char* p, size_t bytewidth, size_t left) {
+  if(bytewidth <= 4 && left >= 4) {
+    int word;
+    lodepng_memcpy(&word, p, 4);
+    return _mm_cvtsi32_si128(word);
+  } else if(left >= 8) {
+    return _mm_loadl_epi64((const __m128i*)p);
+  } else {
+    unsigned char buffer[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    lodepng_memcpy(buffer, p, bytewidth);
+    return _mm_loadl_epi64((const __m128i*)buffer);
+  }
+}
+
+static LODEPNG_INLINE void storePixelSSE2(unsigned char* p, __m128i pixel, size_t bytewidth) {
+  unsigned char buffer[16];
+  _mm_storeu_si128((__m128i*)buffer, pixel);
+  lodepng_memcpy(p, buffer, bytewidth);
+}
+
+static LODEPNG_INLINE void unfilterSubSSE2(unsigned char* recon, const unsigned char* scanline,
+                                           size_t bytewidth, size_t length) {
+  size_t i;
+  __m128i a = _mm_setzero_si128();
+  for(i = 0; i != length; i += bytewidth) {
+    a = _mm_add_epi8(loadPixelSSE2(&scanline[i], bytewidth, length - i), a);
+    storePixelSSE2(&recon[i], a, bytewidth);
+  }
+}
+
+static LODEPNG_INLINE void unfilterAverageSSE2(unsigned char* recon, const unsigned char* scanline,
+                                               const unsigned char* precon, size_t bytewidth, size_t length) {
+  size_t i;
+  __m128i a = _mm_setzero_si128();
+  for(i = 0; i != length; i += bytewidth) {
+    __m128i b = loadPixelSSE2(&precon[i], bytewidth, length - i);
+    /*_mm_avg_epu8 rounds up, PNG's average rounds down: take off the 1 it added when a + b is odd*/
+    __m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+    a = _mm_add_epi8(loadPixelSSE2(&scanline[i], bytewidth, length - i), average);
+    storePixelSSE2(&recon[i], a, bytewidth);
+  }
+}
+
+/*the paeth predictor of the 16-bit lanes a (left), b (up) and c (up left), ABS taking the absolute value of 16-bit
+lanes. Ties go to a, then b, as in paethPredictor.*/
+#define LODEPNG_PAETH_EPI16(predicted, a, b, c, ABS) {\
+  __m128i pa = _mm_sub_epi16(b, c);\
+  __m128i pb = _mm_sub_epi16(a, c);\
+  __m128i pc = ABS(_mm_add_epi16(pa, pb));\
+  __m128i smallest, use_a, use_b;\
+  pa = ABS(pa);\
+  pb = ABS(pb);\
+  smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));\
+  use_a = _mm_cmpeq_epi16(smallest, pa);\
+  use_b = _mm_andnot_si128(use_a, _mm_cmpeq_epi16(smallest, pb));\
+  predicted = _mm_or_si128(_mm_or_si128(_mm_and_si128(use_a, a), _mm_and_si128(use_b, b)),\
+                           _mm_andnot_si128(_mm_or_si128(use_a, use_b), c));\
+}
+
+static LODEPNG_INLINE __m128i lodepng_abs_epi16_sse2(__m128i x) {
+  return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+/*the pixels are widened to 16 bits, and narrowed again to store them. Adding the bytes of values up to 255 leaves
+the high bytes zero.*/
+static LODEPNG_INLINE void unfilterPaethSSE2(unsigned char* recon, const unsigned char* scanline,
+                                             const unsigned char* precon, size_t bytewidth, size_t length) {
+  size_t i;
+  const __m128i zero = _mm_setzero_si128();
+  __m128i a = zero, c = zero;
+  for(i = 0; i != length; i += bytewidth) {
+    __m128i b = _mm_unpacklo_epi8(loadPixelSSE2(&precon[i], bytewidth, length - i), zero);
+    __m128i predicted;
+    LODEPNG_PAETH_EPI16(predicted, a, b, c, lodepng_abs_epi16_sse2);
+    a = _mm_add_epi8(_mm_unpacklo_epi8(loadPixelSSE2(&scanline[i], bytewidth, length - i), zero), predicted);
+    c = b;
+    storePixelSSE2(&recon[i], _mm_packus_epi16(a, a), bytewidth);
+  }
+}
+
+#ifdef LODEPNG_SIMD_X86_EXTENSIONS
+/*as unfilterPaethSSE2, with SSSE3's absolute value*/
+LODEPNG_TARGET("ssse3") static LODEPNG_INLINE void unfilterPaethSSSE3(unsigned char* recon,
+    const unsigned char* scanline, const unsigned char* precon, size_t bytewidth, size_t length) {
+  size_t i;
+  const __m128i zero = _mm_setzero_si128();
+  __m128i a = zero, c = zero;
+  for(i = 0; i != length; i += bytewidth) {
+    __m128i b = _mm_unpacklo_epi8(loadPixelSSE2(&precon[i], bytewidth, length - i), zero);
+    __m128i predicted;
+    LODEPNG_PAETH_EPI16(predicted, a, b, c, _mm_abs_epi16);
+    a = _mm_add_epi8(_mm_unpacklo_epi8(loadPixelSSE2(&scanline[i], bytewidth, length - i), zero), predicted);
+    c = b;
+    storePixelSSE2(&recon[i], _mm_packus_epi16(a, a), bytewidth);
+  }
+}
+
+LODEPNG_TARGET("ssse3") static void unfilterPaethSSSE3_any(unsigned char* recon, const unsigned char* scanline,
+                                                        const unsigned char* precon, size_t bytewidth, size_t length) {
+  switch(bytewidth) {
+    case 3: unfilterPaethSSSE3(recon, scanline, precon, 3, length); break;
+    case 4: unfilterPaethSSSE3(recon, scanline, precon, 4, length); break;
+    case 6: unfilterPaethSSSE3(recon, scanline, precon, 6, length); break;
+    default: unfilterPaethSSSE3(recon, scanline, precon, 8, length); break;
+  }
+}
+#endif /*LODEPNG_SIMD_X86_EXTENSIONS*/
+
+static LODEPNG_INLINE void unfilterUpSIMD(unsigned char* recon, const unsigned char* scanline,
+                                          const unsigned char* precon, size_t length) {
+  size_t i;
+  for(i = 0; i + 16 <= length; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i*)&scanline[i]);
+    _mm_storeu_si128((__m128i*)&recon[i], _mm_add_epi8(x, _mm_loadu_si128((const __m128i*)&precon[i])));
+  }
+  for(; i != length; ++i) recon[i] = scanline[i] + precon[i];
+}
+#endif /*LODEPNG_SIMD_SSE2*/
+
+#ifdef LODEPNG_SIMD_NEON
+static LODEPNG_INLINE uint8x8_t loadPixelNEON(const unsigned char* p, size_t bytewidth, size_t left) {
+  if(bytewidth <= 4 && left >= 4) {
+    unsigned word;
+    lodepng_memcpy(&word, p, 4);
+    return vreinterpret_u8_u32(vdup_n_u32(word));
+  } else if(left >= 8) {
+    return vld1_u8(p);
+  } else {
+    unsigned char buffer[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    lodepng_memcpy(buffer, p, bytewidth);
+    return vld1_u8(buffer);
+  }
+}
+
+static LODEPNG_INLINE void storePixelNEON(unsigned char* p, uint8x8_t pixel, size_t bytewidth) {
+  unsigned char buffer[8];
+  vst1_u8(buffer, pixel);
+  lodepng_memcpy(p, buffer, bytewidth);
+}
+
+static LODEPNG_INLINE void unfilterSubNEON(unsigned char* recon, const unsigned char* scanline,
+                                           size_t bytewidth, size_t length) {
+  size_t i;
+  uint8x8_t a = vdup_n_u8(0);
+  for(i = 0; i != length; i += bytewidth) {
+    a = vadd_u8(loadPixelNEON(&scanline[i], bytewidth, length - i), a);
+    storePixelNEON(&recon[i], a, bytewidth);
+  }
+}
+
+static LODEPNG_INLINE void unfilterAverageNEON(unsigned char* recon, const unsigned char* scanline,
+                                               const unsigned char* precon, size_t bytewidth, size_t length) {
+  size_t i;
+  uint8x8_t a = vdup_n_u8(0);
+  for(i = 0; i != length; i += bytewidth) {
+    uint8x8_t b = loadPixelNEON(&precon[i], bytewidth, length - i);
+    a = vadd_u8(loadPixelNEON(&scanline[i], bytewidth, length - i), vhadd_u8(a, b)); /*vhadd rounds down, as PNG*/
+    storePixelNEON(&recon[i], a, bytewidth);
+  }
+}
+
+/*the differences are taken in 16 bits, where a + b - 2c can't overflow. Ties go to a, then b, as in paethPredictor.*/
+static LODEPNG_INLINE void unfilterPaethNEON(unsigned char* recon, const unsigned char* scanline,
+                                             const unsigned char* precon, size_t bytewidth, size_t length) {
+  size_t i;
+  uint8x8_t a = vdup_n_u8(0), c = vdup_n_u8(0);
+  for(i = 0; i != length; i += bytewidth) {
+    uint8x8_t b = loadPixelNEON(&precon[i], bytewidth, length - i);
+    uint16x8_t pa = vabdl_u8(b, c);
+    uint16x8_t pb = vabdl_u8(a, c);
+    uint16x8_t pc = vabdq_u16(vaddl_u8(a, b), vaddl_u8(c, c));
+    uint8x8_t use_a = vmovn_u16(vandq_u16(vcleq_u16(pa, pb), vcleq_u16(pa, pc)));
+    uint8x8_t use_b = vmovn_u16(vcleq_u16(pb, pc));
+    uint8x8_t predicted = vbsl_u8(use_a, a, vbsl_u8(use_b, b, c));
+    a = vadd_u8(loadPixelNEON(&scanline[i], bytewidth, length - i), predicted);
+    c = b;
+    storePixelNEON(&recon[i], a, bytewidth);
+  }
+}
+
+static LODEPNG_INLINE void unfilterUpSIMD(unsigned char* recon, const unsigned char* scanline,
+                                          const unsigned char* precon, size_t length) {
+  size_t i;
+  for(i = 0; i + 16 <= length; i += 16) vst1q_u8(&recon[i], vaddq_u8(vld1q_u8(&scanline[i]), vld1q_u8(&precon[i])));
+  for(; i != length; ++i) recon[i] = scanline[i] + precon[i];
+}
+#endif /*LODEPNG_SIMD_NEON*/
+
+#ifdef LODEPNG_SIMD_SSE2
+#define LODEPNG_UNFILTER_SIMD(filter) unfilter##filter##SSE2
+#else
+#define LODEPNG_UNFILTER_SIMD(filter) unfilter##filter##NEON
+#endif
+
+/*for bytewidth 3, 4, 6 or 8*/
+static void unfilterSubSIMD(unsigned char* recon, const unsigned char* scanline, size_t bytewidth, size_t length) {
+  switch(bytewidth) {
+    case 3: LODEPNG_UNFILTER_SIMD(Sub)(recon, scanline, 3, length); break;
+    case 4: LODEPNG_UNFILTER_SIMD(Sub)(recon, scanline, 4, length); break;
+    case 6: LODEPNG_UNFILTER_SIMD(Sub)(recon, scanline, 6, length); break;
+    default: LODEPNG_UNFILTER_SIMD(Sub)(recon, scanline, 8, length); break;
+  }
+}
+
+static void unfilterAverageSIMD(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                size_t bytewidth, size_t length) {
+  switch(bytewidth) {
+    case 3: LODEPNG_UNFILTER_SIMD(Average)(recon, scanline, precon, 3, length); break;
+    case 4: LODEPNG_UNFILTER_SIMD(Average)(recon, scanline, precon, 4, length); break;
+    case 6: LODEPNG_UNFILTER_SIMD(Average)(recon, scanline, precon, 6, length); break;
+    default: LODEPNG_UNFILTER_SIMD(Average)(recon, scanline, precon, 8, length); break;
+  }
+}
+
+static void unfilterPaethSIMD(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                              size_t bytewidth, size_t length) {
+#ifdef LODEPNG_SIMD_X86_EXTENSIONS
+  if(lodepng_cpu_has(LODEPNG_CPU_SSSE3)) {
+    unfilterPaethSSSE3_any(recon, scanline, precon, bytewidth, length);
+    return;
+  }
+#endif /*LODEPNG_SIMD_X86_EXTENSIONS*/
+  switch(bytewidth) {
+    case 3: LODEPNG_UNFILTER_SIMD(Paeth)(recon, scanline, precon, 3, length); break;
+    case 4: LODEPNG_UNFILTER_SIMD(Paeth)(recon, scanline, precon, 4, length); break;
+    case 6: LODEPNG_UNFILTER_SIMD(Paeth)(recon, scanline, precon, 6, length); break;
+    default: LODEPNG_UNFILTER_SIMD(Paeth)(recon, scanline, precon, 8, length); break;
+  }
+}
+
+/*unfilters the scanline with SIMD and returns 1, or returns 0 if it's not a case the SIMD code handles*/
+static unsigned unfilterScanlineSIMD(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                     size_t bytewidth, unsigned char filterType, size_t length) {
+  unsigned pixels = bytewidth == 3 || bytewidth == 4 || bytewidth == 6 || bytewidth == 8;
+  switch(filterType) {
+    case 1:
+      if(!pixels) return 0;
+      unfilterSubSIMD(recon, scanline, bytewidth, length);
+      return 1;
+    case 2:
+      if(!precon) return 0;
+      unfilterUpSIMD(recon, scanline, precon, length);
+      return 1;
+    case 3:
+      if(!pixels || !precon) return 0;
+      unfilterAverageSIMD(recon, scanline, precon, bytewidth, length);
+      return 1;
+    case 4:
+      if(!pixels || !precon) return 0;
+      unfilterPaethSIMD(recon, scanline, precon, bytewidth, length);
+      return 1;
+    default: return 0;
+  }
+}
+#endif /*LODEPNG_SIMD_SSE2 || LODEPNG_SIMD_NEON*/
+
 static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
                                  size_t bytewidth, unsigned char filterType, size_t length) {
   /*
@@ -4080,6 +5482,9 @@ static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scan
   */
 
   size_t i;
+#if defined(LODEPNG_SIMD_SSE2) || defined(LODEPNG_SIMD_NEON)
+  if(unfilterScanlineSIMD(recon, scanline, precon, bytewidth, filterType, length)) return 0;
+#endif /*LODEPNG_SIMD_SSE2 || LODEPNG_SIMD_NEON*/
   switch(filterType) {
     case 0:
       for(i = 0; i != length; ++i) recon[i] = scanline[i];
@@ -4165,17 +5570,19 @@ static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scan
   return 0;
 }
 
-static unsigned unfilter(unsigned char* out, const unsigned char* in, unsigned w, unsigned h, unsigned bpp) {
+static unsigned unfilter(unsigned char* out, const unsigned char* in, const unsigned char* precon,
+                         unsigned w, unsigned h, unsigned bpp) {
   /*
   For PNG filter method 0
   this function unfilters a single image (e.g. without interlacing this is called once, with Adam7 seven times)
   out must have enough bytes allocated already, in must have the scanlines + 1 filtertype byte per scanline
   w and h are image dimensions or dimensions of reduced image, bpp is bits per pixel
   in and out are allowed to be the same memory address (but aren't the same size since in has the extra filter bytes)
+  precon is the unfiltered row above the first, or 0 if the first is the top of the image
   */
 
   unsigned y;
-  unsigned char* prevline = 0;
+  const unsigned char* prevline = precon;
 
   /*bytewidth is used for filtering, is 1 when bpp < 8, number of bytes per pixel otherwise*/
   size_t bytewidth = (bpp + 7u) / 8u;
@@ -4285,11 +5692,11 @@ static unsigned postProcessScanlines(unsigned char* out, unsigned char* in,
 
   if(info_png->interlace_method == 0) {
     if(bpp < 8 && w * bpp != ((w * bpp + 7u) / 8u) * 8u) {
-      CERROR_TRY_RETURN(unfilter(in, in, w, h, bpp));
+      CERROR_TRY_RETURN(unfilter(in, in, 0, w, h, bpp));
       removePaddingBits(out, in, w * bpp, ((w * bpp + 7u) / 8u) * 8u, h);
     }
     /*we can immediately filter into the out buffer, no other steps needed*/
-    else CERROR_TRY_RETURN(unfilter(out, in, w, h, bpp));
+    else CERROR_TRY_RETURN(unfilter(out, in, 0, w, h, bpp));
   } else /*interlace_method is 1 (Adam7)*/ {
     unsigned passw[7], passh[7]; size_t filter_passstart[8], padded_passstart[8], passstart[8];
     unsigned i;
@@ -4297,7 +5704,7 @@ static unsigned postProcessScanlines(unsigned char* out, unsigned char* in,
     Adam7_getpassvalues(passw, passh, filter_passstart, padded_passstart, passstart, w, h, bpp);
 
     for(i = 0; i != 7; ++i) {
-      CERROR_TRY_RETURN(unfilter(&in[padded_passstart[i]], &in[filter_passstart[i]], passw[i], passh[i], bpp));
+      CERROR_TRY_RETURN(unfilter(&in[padded_passstart[i]], &in[filter_passstart[i]], 0, passw[i], passh[i], bpp));
       /*TODO: possible efficiency improvement: if in this reduced image the bits fit nicely in 1 scanline,
       move bytes instead of bits or move not at all*/
       if(bpp < 8) {
@@ -4732,17 +6139,185 @@ unsigned lodepng_inspect_chunk(LodePNGState* state, size_t pos,
   return error;
 }
 
+#ifdef LODEPNG_COMPILE_ZLIB
+/*one band of the image data of a PNG with a seGM chunk (see band_rows in LodePNGEncoderSettings)*/
+typedef struct LodePNGBand {
+  const unsigned char* in; /*the band's deflate data*/
+  size_t insize;
+  unsigned y; /*the band's first row*/
+  unsigned rows; /*the band's rows in the image*/
+  unsigned needed; /*the band's rows to decode*/
+  ucvector scanlines;
+  unsigned adler; /*of the whole band's scanlines*/
+  unsigned unfiltered; /*whether the task unfiltered the band, which it can if its first row doesn't use the one above*/
+  unsigned error;
+#ifdef LODEPNG_COMPILE_ALLOCATORS
+  LodePNGAllocator allocator;
+#endif /*LODEPNG_COMPILE_ALLOCATORS*/
+} LodePNGBand;
+
+typedef struct LodePNGBands {
+  LodePNGBand* band;
+  unsigned char* out;
+  unsigned w;
+  unsigned bpp;
+  unsigned check_adler;
+  const LodePNGDecompressSettings* zlibsettings;
+} LodePNGBands;
+
+#ifdef LODEPNG_COMPILE_ALLOCATORS
+/*The band tasks may run on other threads than the decoder, and don't use its allocator, which needn't be thread-safe.
+They allocate from the C library instead, and can't grow the band's scanlines, which the decoder allocated with room
+for the whole band: a band that doesn't fit fails, and the image is then decoded without the seGM chunk.*/
+static void* bandAllocate(void* user, size_t size) {
+  (void)user;
+  return malloc(size);
+}
+
+static void* bandReallocate(void* user, void* ptr, size_t size) {
+  if(ptr && ptr == ((LodePNGBand*)user)->scanlines.data) return 0;
+  return realloc(ptr, size);
+}
+
+static void bandDeallocate(void* user, void* ptr) {
+  (void)user;
+  free(ptr);
+}
+#endif /*LODEPNG_COMPILE_ALLOCATORS*/
+
+/*inflates band index and, unless its first row is filtered with the row above, unfilters it into the output*/
+static void decodeBand(void* task_data, unsigned index) {
+  const LodePNGBands* bands = (const LodePNGBands*)task_data;
+  LodePNGBand* band = &bands->band[index];
+  size_t linebytes = (bands->w * bands->bpp + 7u) / 8u;
+  size_t bandsize = band->rows * (linebytes + 1);
+  LodePNGDecompressSettings zlibsettings = *bands->zlibsettings;
+#ifdef LODEPNG_COMPILE_ALLOCATORS
+  const LodePNGAllocator* previous = lodepng_set_allocator(&band->allocator);
+#endif /*LODEPNG_COMPILE_ALLOCATORS*/
+
+  /*a band other than the last ends with an empty stored block, not with BFINAL: stop at the band's size*/
+  zlibsettings.expected_size = 0;
+  zlibsettings.needed_size = band->needed * (linebytes + 1);
+  band->error = lodepng_inflatev(&band->scanlines, band->in, band->insize, &zlibsettings);
+  if(!band->error) {
+    if(band->needed < band->rows && band->scanlines.size > zlibsettings.needed_size) {
+      band->scanlines.size = zlibsettings.needed_size;
+    }
+    if(band->scanlines.size != zlibsettings.needed_size) band->error = 91; /*doesn't match the image size*/
+  }
+  if(!band->error && bands->check_adler) band->adler = adler32(band->scanlines.data, (unsigned)bandsize);
+  if(!band->error && (band->y == 0 || band->scanlines.data[0] < 2)) {
+    /*with the filter types None and Sub, there is no difference between no row above and any other*/
+    band->error = unfilter(&bands->out[band->y * linebytes], band->scanlines.data, 0,
+                           bands->w, band->needed, bands->bpp);
+    band->unfiltered = 1;
+  }
+#ifdef LODEPNG_COMPILE_ALLOCATORS
+  lodepng_set_allocator(previous);
+#endif /*LODEPNG_COMPILE_ALLOCATORS*/
+}
+
+/*Decodes the first numrows rows of a non-interlaced PNG into out, in the PNG's color type, from the zlib stream of its
+IDAT chunks compressed in the bands that its seGM chunk lists, with parallel_for. Returns an error if the seGM chunk
+doesn't describe the image data, which must then be decoded as a whole.*/
+static unsigned decodeBands(unsigned char* out, unsigned w, unsigned h, unsigned numrows,
+                            const LodePNGDecoderSettings* decoder, const LodePNGColorMode* color,
+                            const unsigned char* index, size_t indexsize,
+                            const unsigned char* zlib, size_t zlibsize) {
+  LodePNGBands bands;
+  size_t linebytes, numbands = indexsize / 8u, i;
+  unsigned count = 0; /*the bands with rows to decode*/
+  unsigned error = 0;
+
+  bands.w = w;
+  bands.bpp = lodepng_get_bpp(color);
+  bands.out = out;
+  bands.zlibsettings = &decoder->zlibsettings;
+  bands.check_adler = numrows == h && !decoder->zlibsettings.ignore_adler32;
+  linebytes = (w * bands.bpp + 7u) / 8u;
+  /*the rows are unfiltered straight into out, which has no room for padding bits*/
+  if(bands.bpp == 0 || (bands.bpp < 8 && w * bands.bpp != linebytes * 8u)) return 111;
+  if(numbands == 0 || indexsize % 8u != 0 || zlibsize < 6) return 111;
+  if((zlib[0] * 256 + zlib[1]) % 31 != 0 || (zlib[0] & 15) != 8 || ((zlib[0] >> 4) & 15) > 7 || (zlib[1] & 32)) {
+    return 111; /*the zlib header lodepng_zlib_decompress checks*/
+  }
+  for(i = 0; i != numbands; ++i) {
+    unsigned y = lodepng_read32bitInt(&index[i * 8]), offset = lodepng_read32bitInt(&index[i * 8 + 4]);
+    if(i == 0 ? (y != 0 || offset != 2) : (y <= lodepng_read32bitInt(&index[i * 8 - 8]) ||
+                                           offset <= lodepng_read32bitInt(&index[i * 8 - 4]))) return 111;
+    if(y >= h || offset >= zlibsize - 4) return 111;
+    if(y < numrows) count = (unsigned)i + 1u;
+  }
+
+  bands.band = (LodePNGBand*)lodepng_malloc(count * sizeof(LodePNGBand));
+  if(!bands.band) return 83; /*alloc fail*/
+  for(i = 0; i != count; ++i) {
+    LodePNGBand* band = &bands.band[i];
+    size_t end = i + 1 < numbands ? lodepng_read32bitInt(&index[i * 8 + 12]) : zlibsize - 4;
+    size_t offset = lodepng_read32bitInt(&index[i * 8 + 4]);
+    band->y = lodepng_read32bitInt(&index[i * 8]);
+    band->rows = (i + 1 < numbands ? lodepng_read32bitInt(&index[i * 8 + 8]) : h) - band->y;
+    band->needed = numrows - band->y < band->rows ? numrows - band->y : band->rows;
+    band->in = &zlib[offset];
+    band->insize = end - offset;
+    band->adler = 1;
+    band->unfiltered = 0;
+    band->error = 0;
+    ucvector_init(&band->scanlines);
+    /*the task can't allocate these itself, and needs them big enough for the whole band and the inflate slack*/
+    if(!error && !ucvector_reserve(&band->scanlines, band->rows * (linebytes + 1) + INFLATE_SLACK)) error = 83;
+#ifdef LODEPNG_COMPILE_ALLOCATORS
+    band->allocator.allocate = bandAllocate;
+    band->allocator.reallocate = bandReallocate;
+    band->allocator.deallocate = bandDeallocate;
+    band->allocator.user = band;
+#endif /*LODEPNG_COMPILE_ALLOCATORS*/
+  }
+
+  if(!error) decoder->parallel_for(decoder->parallel_context, count, decodeBand, &bands);
+
+  /*the bands whose first row is filtered with the row above are unfiltered in order once that row is*/
+  for(i = 0; i != count && !error; ++i) {
+    LodePNGBand* band = &bands.band[i];
+    error = band->error;
+    if(!error && !band->unfiltered) {
+      error = unfilter(&out[band->y * linebytes], band->scanlines.data, &out[(band->y - 1) * linebytes],
+                       w, band->needed, bands.bpp);
+    }
+    if(!error && bands.check_adler && i != 0) {
+      bands.band[0].adler = adler32_combine(bands.band[0].adler, band->adler, band->rows * (linebytes + 1));
+    }
+  }
+  if(!error && bands.check_adler && bands.band[0].adler != lodepng_read32bitInt(&zlib[zlibsize - 4])) {
+    error = 58; /*adler checksum not correct*/
+  }
+
+  for(i = 0; i != count; ++i) ucvector_cleanup(&bands.band[i].scanlines);
+  lodepng_free(bands.band);
+  return error;
+}
+#endif /*LODEPNG_COMPILE_ZLIB*/
+
 /*read a PNG, the result will be in the same color type as the PNG (hence "generic")*/
+/*numrows: if not 0 and the image is not interlaced, only its first numrows rows are decoded into out
+(w and h still receive the size of the whole image), and the zlib data is inflated no further than needed*/
 static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
                           LodePNGState* state,
-                          const unsigned char* in, size_t insize) {
+                          const unsigned char* in, size_t insize, unsigned numrows) {
   unsigned char IEND = 0;
   const unsigned char* chunk;
   size_t i;
-  ucvector idat; /*the data from idat chunks*/
+  ucvector idat; /*the data from idat chunks, once there is more than one*/
+  const unsigned char* idatdata = 0; /*the zlib stream: a lone IDAT chunk's data where it lies, or idat's*/
+  size_t idatsize = 0;
+  unsigned idatjoined = 0;
+  const unsigned char* bandindex = 0; /*the seGM chunk's data*/
+  size_t bandindexsize = 0;
   unsigned char* scanlines = 0;
   size_t scanlines_size = 0, expected_size = 0;
   size_t outsize = 0;
+  LodePNGDecompressSettings zlibsettings;
 
   /*for unknown chunk order*/
   unsigned unknown = 0;
@@ -4795,11 +6370,25 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
 
     /*IDAT chunk, containing compressed image data*/
     if(lodepng_chunk_type_equals(chunk, "IDAT")) {
-      size_t oldsize = idat.size;
       size_t newsize;
-      if(lodepng_addofl(oldsize, chunkLength, &newsize)) CERROR_BREAK(state->error, 95);
-      if(!ucvector_resize(&idat, newsize)) CERROR_BREAK(state->error, 83 /*alloc fail*/);
-      for(i = 0; i != chunkLength; ++i) idat.data[oldsize + i] = data[i];
+      if(lodepng_addofl(idatsize, chunkLength, &newsize)) CERROR_BREAK(state->error, 95);
+      if(!idatdata) {
+        /*a single IDAT chunk is inflated in place, only a second one needs the chunks' data joined*/
+        idatdata = data;
+      } else {
+        if(!idatjoined) {
+          /*the IDAT chunks together are no bigger than the rest of the file, so reserve that once rather than
+          growing the buffer chunk by chunk*/
+          if(!ucvector_reserve(&idat, (size_t)(in + insize - idatdata))) CERROR_BREAK(state->error, 83 /*alloc fail*/);
+          if(!ucvector_resize(&idat, idatsize)) CERROR_BREAK(state->error, 83 /*alloc fail*/);
+          lodepng_memcpy(idat.data, idatdata, idatsize);
+          idatjoined = 1;
+        }
+        if(!ucvector_resize(&idat, newsize)) CERROR_BREAK(state->error, 83 /*alloc fail*/);
+        lodepng_memcpy(idat.data + idatsize, data, chunkLength);
+        idatdata = idat.data;
+      }
+      idatsize = newsize;
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
       critical_pos = 3;
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
@@ -4819,6 +6408,10 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
       affects the alpha channel of pixels. */
       state->error = readChunk_tRNS(&state->info_png.color, data, chunkLength);
       if(state->error) break;
+    } else if(lodepng_chunk_type_equals(chunk, "seGM")) {
+      /*index of the bands the image data is compressed in, which are decoded in parallel if possible*/
+      bandindex = data;
+      bandindexsize = chunkLength;
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
       /*background color chunk (bKGD)*/
     } else if(lodepng_chunk_type_equals(chunk, "bKGD")) {
@@ -4891,8 +6484,9 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
 
   /*predict output size, to allocate exact size for output buffer to avoid more dynamic allocation.
   If the decompressed size does not match the prediction, the image must be corrupt.*/
+  if(numrows == 0 || numrows > *h || state->info_png.interlace_method != 0) numrows = *h;
   if(state->info_png.interlace_method == 0) {
-    expected_size = lodepng_get_raw_size_idat(*w, *h, &state->info_png.color);
+    expected_size = lodepng_get_raw_size_idat(*w, numrows, &state->info_png.color);
   } else {
     /*Adam-7 interlaced: expected size is the sum of the 7 sub-images sizes*/
     const LodePNGColorMode* color = &state->info_png.color;
@@ -4905,40 +6499,48 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
     if(*w > 1) expected_size += lodepng_get_raw_size_idat((*w + 0) >> 1, (*h + 1) >> 1, color);
     expected_size += lodepng_get_raw_size_idat((*w + 0), (*h + 0) >> 1, color);
   }
-  if(!state->error) {
-    /* This allocated data will be realloced by zlib_decompress, initially at
-    smaller size again. But the fact that it's already allocated at full size
-    here speeds the multiple reallocs up. TODO: make zlib_decompress support
-    receiving already allocated buffer with expected size instead. */
-    scanlines = (unsigned char*)lodepng_malloc(expected_size);
-    if(!scanlines) state->error = 83; /*alloc fail*/
-    scanlines_size = 0;
+#ifdef LODEPNG_COMPILE_ZLIB
+  if(!state->error && bandindex && state->decoder.parallel_for && state->info_png.interlace_method == 0 &&
+     !state->decoder.zlibsettings.custom_zlib && !state->decoder.zlibsettings.custom_inflate) {
+    outsize = lodepng_get_raw_size(*w, numrows, &state->info_png.color);
+    *out = (unsigned char*)lodepng_malloc(outsize);
+    if(!*out) state->error = 83; /*alloc fail*/
+    else if(!decodeBands(*out, *w, *h, numrows, &state->decoder, &state->info_png.color,
+                         bandindex, bandindexsize, idatdata, idatsize)) {
+      ucvector_cleanup(&idat);
+      return;
+    }
+    /*the bands couldn't be decoded: decode the image data as a whole, as if there were no seGM chunk*/
+    lodepng_free(*out);
+    *out = 0;
   }
+#endif /*LODEPNG_COMPILE_ZLIB*/
   if(!state->error) {
-    state->error = zlib_decompress(&scanlines, &scanlines_size, idat.data,
-                                   idat.size, &state->decoder.zlibsettings);
+    /*inflate allocates the scanlines at the expected size from the start*/
+    zlibsettings = state->decoder.zlibsettings;
+    zlibsettings.expected_size = expected_size;
+    if(numrows < *h) zlibsettings.needed_size = expected_size;
+    state->error = zlib_decompress(&scanlines, &scanlines_size, idatdata, idatsize, &zlibsettings);
+    /*when stopping early, inflate finishes the deflate block it is in, so there may be more than needed*/
+    if(!state->error && numrows < *h && scanlines_size > expected_size) scanlines_size = expected_size;
     if(!state->error && scanlines_size != expected_size) state->error = 91; /*decompressed size doesn't match prediction*/
   }
   ucvector_cleanup(&idat);
 
   if(!state->error) {
-    outsize = lodepng_get_raw_size(*w, *h, &state->info_png.color);
+    outsize = lodepng_get_raw_size(*w, numrows, &state->info_png.color);
     *out = (unsigned char*)lodepng_malloc(outsize);
     if(!*out) state->error = 83; /*alloc fail*/
   }
   if(!state->error) {
     for(i = 0; i < outsize; i++) (*out)[i] = 0;
-    state->error = postProcessScanlines(*out, scanlines, *w, *h, &state->info_png);
+    state->error = postProcessScanlines(*out, scanlines, *w, numrows, &state->info_png);
   }
   lodepng_free(scanlines);
 }
 
-unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
-                        LodePNGState* state,
-                        const unsigned char* in, size_t insize) {
-  *out = 0;
-  decodeGeneric(out, w, h, state, in, insize);
-  if(state->error) return state->error;
+/*converts the w * h pixels in *out, decoded in the PNG's color type, to state->info_raw, replacing *out*/
+static unsigned convertDecoded(unsigned char** out, unsigned w, unsigned h, LodePNGState* state) {
   if(!state->decoder.color_convert || lodepng_color_mode_equal(&state->info_raw, &state->info_png.color)) {
     /*same color type, no copying or converting of data needed*/
     /*store the info_png color settings on the info_raw so that the info_raw still reflects what colortype
@@ -4958,18 +6560,367 @@ unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
       return 56; /*unsupported color mode conversion*/
     }
 
-    outsize = lodepng_get_raw_size(*w, *h, &state->info_raw);
+    outsize = lodepng_get_raw_size(w, h, &state->info_raw);
     *out = (unsigned char*)lodepng_malloc(outsize);
     if(!(*out)) {
       state->error = 83; /*alloc fail*/
     }
     else state->error = lodepng_convert(*out, data, &state->info_raw,
-                                        &state->info_png.color, *w, *h);
+                                        &state->info_png.color, w, h);
     lodepng_free(data);
   }
   return state->error;
 }
 
+unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
+                        LodePNGState* state,
+                        const unsigned char* in, size_t insize) {
+  *out = 0;
+  decodeGeneric(out, w, h, state, in, insize, 0);
+  if(state->error) return state->error;
+  return convertDecoded(out, *w, *h, state);
+}
+
+/*clips the region to the image and decodes the image's rows down to the region's last, in the PNG's color type.
+*image stays 0 if none of the region is in the image.*/
+static unsigned decodeRegionRows(unsigned char** image, unsigned* imagew, LodePNGState* state,
+                                 const unsigned char* in, size_t insize,
+                                 unsigned x, unsigned y, unsigned* region_w, unsigned* region_h) {
+  unsigned imageh;
+  *image = 0;
+  state->error = lodepng_inspect(imagew, &imageh, state, in, insize);
+  if(state->error) return state->error;
+  if(x >= *imagew || y >= imageh || *region_w == 0 || *region_h == 0) {
+    *region_w = *region_h = 0; /*nothing of the image is wanted*/
+    return 0;
+  }
+  if(*region_w > *imagew - x) *region_w = *imagew - x;
+  if(*region_h > imageh - y) *region_h = imageh - y;
+  decodeGeneric(image, imagew, &imageh, state, in, insize, y + *region_h);
+  return state->error;
+}
+
+unsigned lodepng_decode_region(unsigned char** out, unsigned* w, unsigned* h,
+                               LodePNGState* state,
+                               const unsigned char* in, size_t insize,
+                               unsigned x, unsigned y, unsigned region_w, unsigned region_h) {
+  unsigned char* image = 0;
+  unsigned imagew, bpp, row;
+  size_t regionsize;
+
+  *out = 0;
+  *w = *h = 0;
+  if(decodeRegionRows(&image, &imagew, state, in, insize, x, y, &region_w, &region_h)) return state->error;
+  if(!image) return 0;
+
+  /*copy the region out of the decoded rows, still in the PNG's color type, so only its pixels get converted*/
+  bpp = lodepng_get_bpp(&state->info_png.color);
+  regionsize = lodepng_get_raw_size(region_w, region_h, &state->info_png.color);
+  *out = (unsigned char*)lodepng_malloc(regionsize);
+  if(!*out) state->error = 83; /*alloc fail*/
+  if(!state->error && bpp % 8u == 0) {
+    size_t linebytes = (size_t)region_w * (bpp / 8u);
+    for(row = 0; row != region_h; ++row) {
+      lodepng_memcpy(*out + row * linebytes, image + ((size_t)(y + row) * imagew + x) * (bpp / 8u), linebytes);
+    }
+  } else if(!state->error) {
+    /*pixels smaller than a byte: the rows of the region don't start at byte boundaries of the image*/
+    size_t obp = 0, ibp, i;
+    (*out)[regionsize - 1] = 0; /*the padding bits at the end*/
+    for(row = 0; row != region_h; ++row) {
+      ibp = ((size_t)(y + row) * imagew + x) * bpp;
+      for(i = 0; i != (size_t)region_w * bpp; ++i) {
+        setBitOfReversedStream(&obp, *out, readBitFromReversedStream(&ibp, image));
+      }
+    }
+  }
+  lodepng_free(image);
+  if(state->error) {
+    lodepng_free(*out);
+    *out = 0;
+    return state->error;
+  }
+
+  *w = region_w;
+  *h = region_h;
+  return convertDecoded(out, *w, *h, state);
+}
+
+unsigned lodepng_decode_planar(const LodePNGPlanes* out, unsigned* w, unsigned* h,
+                               LodePNGState* state,
+                               const unsigned char* in, size_t insize,
+                               unsigned x, unsigned y, unsigned region_w, unsigned region_h) {
+  unsigned char* image = 0;
+  unsigned char* subbyte = 0; /*a row of the region, for pixels smaller than a byte*/
+  unsigned imagew, bpp, row, c;
+  LodePNGPlanes rowplanes = *out;
+  size_t valuesize = out->floats ? sizeof(float) : 1;
+
+  *w = *h = 0;
+  if(decodeRegionRows(&image, &imagew, state, in, insize, x, y, &region_w, &region_h)) return state->error;
+  if(!image) return 0;
+
+  bpp = lodepng_get_bpp(&state->info_png.color);
+  if(bpp % 8u != 0) {
+    subbyte = (unsigned char*)lodepng_malloc(((size_t)region_w * bpp + 7u) / 8u);
+    if(!subbyte) state->error = 83; /*alloc fail*/
+  }
+  for(row = 0; !state->error && row != region_h; ++row) {
+    const unsigned char* pixels = image + ((size_t)(y + row) * imagew + x) * bpp / 8u;
+    if(subbyte) {
+      size_t obp = 0, ibp = ((size_t)(y + row) * imagew + x) * bpp, i;
+      for(i = 0; i != (size_t)region_w * bpp; ++i) {
+        setBitOfReversedStream(&obp, subbyte, readBitFromReversedStream(&ibp, image));
+      }
+      pixels = subbyte;
+    }
+    for(c = 0; c != 4; ++c) {
+      if(out->planes[c]) rowplanes.planes[c] = (unsigned char*)out->planes[c] + row * out->stride * valuesize;
+    }
+    state->error = lodepng_convert_planar(&rowplanes, pixels, &state->info_png.color, region_w, 1);
+  }
+  lodepng_free(subbyte);
+  lodepng_free(image);
+  if(state->error) return state->error;
+
+  *w = region_w;
+  *h = region_h;
+  return 0;
+}
+
+#ifdef LODEPNG_COMPILE_ZLIB
+typedef enum StreamPhase {
+  STREAM_PNG_HEADER, /*the signature and IHDR*/
+  STREAM_CHUNK_HEADER, /*the length and type of the next chunk*/
+  STREAM_CHUNK, /*a chunk other than IDAT, kept whole until it is read*/
+  STREAM_IDAT, /*IDAT data, which goes straight to the inflater*/
+  STREAM_IDAT_CRC,
+  STREAM_PNG_END /*after IEND*/
+} StreamPhase;
+
+struct LodePNGStreamDecoder {
+  LodePNGState* state;
+  LodePNGRowCallback callback;
+  void* user;
+  StreamPhase phase;
+  ucvector chunk; /*the part of the header, chunk or CRC being read*/
+  size_t chunksize; /*bytes of it needed*/
+  size_t idatleft; /*bytes of data left in the current IDAT chunk*/
+  unsigned crc; /*of the current IDAT chunk so far*/
+  unsigned idat; /*IDAT chunks have begun*/
+  unsigned stopped; /*by the callback*/
+  unsigned w, h, y;
+  size_t bytewidth, linebytes;
+  unsigned char* lines; /*two scanlines, taking turns to be the one arriving and the one above it*/
+  unsigned current; /*which of the two lines the arriving scanline is in*/
+  size_t linepos; /*bytes of the arriving scanline, with its filter type, received*/
+  unsigned char* converted; /*a row in info_raw's color type, if it differs from the PNG's*/
+  LodePNGStreamInflater z;
+};
+
+LodePNGStreamDecoder* lodepng_stream_decoder_new(LodePNGState* state, LodePNGRowCallback callback, void* user) {
+  LodePNGStreamDecoder* decoder = (LodePNGStreamDecoder*)lodepng_malloc(sizeof(LodePNGStreamDecoder));
+  if(!decoder) return 0;
+  decoder->state = state;
+  decoder->callback = callback;
+  decoder->user = user;
+  decoder->phase = STREAM_PNG_HEADER;
+  ucvector_init(&decoder->chunk);
+  decoder->chunksize = 33;
+  decoder->idatleft = 0;
+  decoder->crc = 0;
+  decoder->idat = 0;
+  decoder->stopped = 0;
+  decoder->w = decoder->h = decoder->y = 0;
+  decoder->bytewidth = decoder->linebytes = decoder->linepos = 0;
+  decoder->lines = decoder->converted = 0;
+  decoder->current = 0;
+  state->error = LodePNGStreamInflater_init(&decoder->z, &state->decoder.zlibsettings);
+  return decoder;
+}
+
+void lodepng_stream_decoder_delete(LodePNGStreamDecoder* decoder) {
+  if(!decoder) return;
+  ucvector_cleanup(&decoder->chunk);
+  lodepng_free(decoder->lines);
+  lodepng_free(decoder->converted);
+  LodePNGStreamInflater_cleanup(&decoder->z);
+  lodepng_free(decoder);
+}
+
+/*reads the IHDR and sets up the scanline buffers and color conversion*/
+static unsigned streamStartImage(LodePNGStreamDecoder* decoder) {
+  LodePNGState* state = decoder->state;
+  unsigned bpp;
+  CERROR_TRY_RETURN(lodepng_inspect(&decoder->w, &decoder->h, state, decoder->chunk.data, decoder->chunk.size));
+  if(state->info_png.interlace_method != 0) return 109; /*Adam7 can't be decoded row by row*/
+  if(lodepng_pixel_overflow(decoder->w, decoder->h, &state->info_png.color, &state->info_raw)) return 92;
+
+  bpp = lodepng_get_bpp(&state->info_png.color);
+  decoder->bytewidth = (bpp + 7u) / 8u;
+  decoder->linebytes = ((size_t)decoder->w * bpp + 7u) / 8u;
+  decoder->lines = (unsigned char*)lodepng_malloc(2 * (decoder->linebytes + 1));
+  if(!decoder->lines) return 83; /*alloc fail*/
+
+  if(!state->decoder.color_convert) {
+    CERROR_TRY_RETURN(lodepng_color_mode_copy(&state->info_raw, &state->info_png.color));
+  } else if(!lodepng_color_mode_equal(&state->info_raw, &state->info_png.color)) {
+    if(!(state->info_raw.colortype == LCT_RGB || state->info_raw.colortype == LCT_RGBA)
+       && !(state->info_raw.bitdepth == 8)) {
+      return 56; /*unsupported color mode conversion*/
+    }
+    decoder->converted = (unsigned char*)lodepng_malloc(lodepng_get_raw_size(decoder->w, 1, &state->info_raw));
+    if(!decoder->converted) return 83; /*alloc fail*/
+  }
+  return 0;
+}
+
+/*inflates the IDAT data given so far, handing each scanline to the callback once it is complete*/
+static unsigned streamDecodeRows(LodePNGStreamDecoder* decoder) {
+  LodePNGState* state = decoder->state;
+  while(!decoder->stopped) {
+    /*the row arrives after its filter type byte and is unfiltered one byte further back, in place like the Adam7
+    passes are*/
+    unsigned char* line = decoder->lines + decoder->current * (decoder->linebytes + 1);
+    unsigned char* above = decoder->lines + (decoder->current ^ 1u) * (decoder->linebytes + 1);
+    if(decoder->y == decoder->h) {
+      /*all rows are out: the zlib stream may only end, and check its Adler32, now*/
+      unsigned char extra;
+      size_t n = 0;
+      CERROR_TRY_RETURN(streamInflate(&decoder->z, &extra, 1, &n));
+      return n ? 91 : 0; /*decompressed size doesn't match prediction*/
+    }
+    CERROR_TRY_RETURN(streamInflate(&decoder->z, line, decoder->linebytes + 1, &decoder->linepos));
+    if(decoder->linepos != decoder->linebytes + 1) return 0; /*wants more input*/
+
+    CERROR_TRY_RETURN(unfilterScanline(line, line + 1, decoder->y ? above : 0,
+                                       decoder->bytewidth, line[0], decoder->linebytes));
+    if(decoder->converted) {
+      CERROR_TRY_RETURN(lodepng_convert(decoder->converted, line, &state->info_raw, &state->info_png.color,
+                                        decoder->w, 1));
+    }
+    if(decoder->callback(decoder->user, decoder->converted ? decoder->converted : line,
+                         decoder->y, decoder->w, decoder->h)) {
+      decoder->stopped = 1;
+    }
+    decoder->current ^= 1u;
+    decoder->linepos = 0;
+    ++decoder->y;
+  }
+  return 0;
+}
+
+/*the zlib stream ends with the last IDAT chunk*/
+static unsigned streamEndIdat(LodePNGStreamDecoder* decoder) {
+  if(!decoder->idat || decoder->z.final) return 0;
+  decoder->z.final = 1;
+  return streamDecodeRows(decoder);
+}
+
+static unsigned streamReadChunk(LodePNGStreamDecoder* decoder) {
+  LodePNGState* state = decoder->state;
+  const unsigned char* chunk = decoder->chunk.data;
+  if(lodepng_chunk_type_equals(chunk, "IEND")) {
+    if(!state->decoder.ignore_crc && lodepng_chunk_check_crc(chunk)) return 57; /*invalid CRC*/
+    decoder->phase = STREAM_PNG_END;
+    return streamEndIdat(decoder);
+  }
+  if(!lodepng_chunk_type_equals(chunk, "IHDR")) {
+    CERROR_TRY_RETURN(lodepng_inspect_chunk(state, 0, chunk, decoder->chunk.size));
+  }
+  return 0;
+}
+
+unsigned lodepng_stream_decoder_feed(LodePNGStreamDecoder* decoder, const unsigned char* in, size_t insize) {
+  LodePNGState* state = decoder->state;
+  size_t pos = 0;
+  while(!state->error && !decoder->stopped && decoder->phase != STREAM_PNG_END && pos != insize) {
+    size_t n = insize - pos;
+    if(decoder->phase == STREAM_IDAT) {
+      if(n > decoder->idatleft) n = decoder->idatleft;
+#ifndef LODEPNG_NO_COMPILE_CRC
+      decoder->crc = crc32Update(decoder->crc, in + pos, n);
+#endif /*LODEPNG_NO_COMPILE_CRC*/
+      state->error = streamInflateInput(&decoder->z, in + pos, n);
+      if(!state->error) state->error = streamDecodeRows(decoder);
+      pos += n;
+      decoder->idatleft -= n;
+      if(decoder->idatleft == 0) {
+        decoder->phase = STREAM_IDAT_CRC;
+        decoder->chunksize = 4;
+      }
+      continue;
+    }
+
+    /*the other phases gather a whole header, chunk or CRC before reading it*/
+    if(n > decoder->chunksize - decoder->chunk.size) n = decoder->chunksize - decoder->chunk.size;
+    if(!ucvector_resize(&decoder->chunk, decoder->chunk.size + n)) CERROR_BREAK(state->error, 83 /*alloc fail*/);
+    lodepng_memcpy(decoder->chunk.data + decoder->chunk.size - n, in + pos, n);
+    pos += n;
+    if(decoder->chunk.size != decoder->chunksize) continue;
+
+    if(decoder->phase == STREAM_PNG_HEADER) {
+      state->error = streamStartImage(decoder);
+      decoder->phase = STREAM_CHUNK_HEADER;
+    } else if(decoder->phase == STREAM_CHUNK_HEADER) {
+      const unsigned char* chunk = decoder->chunk.data;
+      unsigned length = lodepng_chunk_length(chunk);
+      if(length > 2147483647) CERROR_BREAK(state->error, 63); /*chunk length larger than the max PNG chunk size*/
+      if(lodepng_chunk_type_equals(chunk, "IDAT")) {
+        if(state->info_png.color.colortype == LCT_PALETTE && !state->info_png.color.palette) {
+          CERROR_BREAK(state->error, 106); /*PNG file must have PLTE chunk if color type is palette*/
+        }
+        decoder->idat = 1;
+        decoder->idatleft = length;
+#ifndef LODEPNG_NO_COMPILE_CRC
+        decoder->crc = crc32Update(0xffffffffu, chunk + 4, 4);
+#endif /*LODEPNG_NO_COMPILE_CRC*/
+        decoder->phase = length ? STREAM_IDAT : STREAM_IDAT_CRC;
+      } else {
+        state->error = streamEndIdat(decoder);
+        if(state->error) break;
+        if(!state->decoder.ignore_critical && !lodepng_chunk_ancillary(chunk)
+           && !lodepng_chunk_type_equals(chunk, "PLTE") && !lodepng_chunk_type_equals(chunk, "IEND")) {
+          CERROR_BREAK(state->error, 69); /*unknown critical chunk*/
+        }
+        decoder->phase = STREAM_CHUNK;
+        decoder->chunksize = (size_t)length + 12;
+        continue; /*the header stays at the start of the chunk*/
+      }
+    } else if(decoder->phase == STREAM_CHUNK) {
+      state->error = streamReadChunk(decoder);
+      if(decoder->phase == STREAM_CHUNK) decoder->phase = STREAM_CHUNK_HEADER;
+    } else /*if(decoder->phase == STREAM_IDAT_CRC)*/ {
+#ifndef LODEPNG_NO_COMPILE_CRC
+      if(!state->decoder.ignore_crc && (decoder->crc ^ 0xffffffffu) != lodepng_read32bitInt(decoder->chunk.data)) {
+        CERROR_BREAK(state->error, 57); /*invalid CRC*/
+      }
+#endif /*LODEPNG_NO_COMPILE_CRC*/
+      decoder->phase = STREAM_CHUNK_HEADER;
+    }
+    decoder->chunk.size = 0;
+    decoder->chunksize = decoder->phase == STREAM_IDAT_CRC ? 4 : 8;
+  }
+  return state->error;
+}
+
+unsigned lodepng_stream_decoder_done(const LodePNGStreamDecoder* decoder) {
+  return decoder->stopped || decoder->phase == STREAM_PNG_END;
+}
+
+unsigned lodepng_stream_decoder_finish(LodePNGStreamDecoder* decoder) {
+  LodePNGState* state = decoder->state;
+  if(state->error || decoder->stopped) return state->error;
+  if(decoder->phase != STREAM_PNG_END) {
+    if(!state->decoder.ignore_end) CERROR_RETURN_ERROR(state->error, 110);
+    state->error = streamEndIdat(decoder);
+    if(state->error) return state->error;
+  }
+  if(decoder->y != decoder->h) CERROR_RETURN_ERROR(state->error, 110);
+  return 0;
+}
+#endif /*LODEPNG_COMPILE_ZLIB*/
+
 unsigned lodepng_decode_memory(unsigned char** out, unsigned* w, unsigned* h, const unsigned char* in,
                                size_t insize, LodePNGColorType colortype, unsigned bitdepth) {
   unsigned error;
@@ -5023,6 +6974,8 @@ void lodepng_decoder_settings_init(LodePNGDecoderSettings* settings) {
   settings->ignore_crc = 0;
   settings->ignore_critical = 0;
   settings->ignore_end = 0;
+  settings->parallel_for = 0;
+  settings->parallel_context = 0;
   lodepng_decompress_settings_init(&settings->zlibsettings);
 }
 
@@ -5163,6 +7116,40 @@ static unsigned addChunk_IDAT(ucvector* out, const unsigned char* data, size_t d
   return error;
 }
 
+#ifdef LODEPNG_COMPILE_ZLIB
+/*adds an IDAT chunk holding the filtered scanlines compressed in bands of band_rows rows, and before it the seGM chunk
+that indexes them. Each band is deflated on its own and ends on a byte boundary, so inflating can start at any band.
+The seGM chunk has two 4-byte values per band: its first row and the offset of its deflate data in the zlib stream.*/
+static unsigned addChunks_seGM_IDAT(ucvector* out, const unsigned char* data, unsigned h, size_t linebytes,
+                                    unsigned band_rows, const LodePNGCompressSettings* zlibsettings) {
+  ucvector zlibdata, index;
+  unsigned error = 0;
+  unsigned y;
+
+  ucvector_init(&zlibdata);
+  ucvector_init(&index);
+  if(!ucvector_resize(&zlibdata, 2)) error = 83; /*alloc fail*/
+  else writeZlibHeader(zlibdata.data);
+  for(y = 0; y < h && !error; y += band_rows) {
+    unsigned rows = h - y < band_rows ? h - y : band_rows;
+    if(!ucvector_resize(&index, index.size + 8)) ERROR_BREAK(83); /*alloc fail*/
+    lodepng_set32bitInt(&index.data[index.size - 8], y);
+    lodepng_set32bitInt(&index.data[index.size - 4], (unsigned)zlibdata.size);
+    error = lodepng_deflatev(&zlibdata, &data[y * linebytes], rows * linebytes, zlibsettings, y + rows == h);
+  }
+  if(!error) {
+    if(!ucvector_resize(&zlibdata, zlibdata.size + 4)) error = 83; /*alloc fail*/
+    else lodepng_set32bitInt(&zlibdata.data[zlibdata.size - 4], adler32(data, (unsigned)(h * linebytes)));
+  }
+  if(!error) error = addChunk(out, "seGM", index.data, index.size);
+  if(!error) error = addChunk(out, "IDAT", zlibdata.data, zlibdata.size);
+  ucvector_cleanup(&zlibdata);
+  ucvector_cleanup(&index);
+
+  return error;
+}
+#endif /*LODEPNG_COMPILE_ZLIB*/
+
 static unsigned addChunk_IEND(ucvector* out) {
   unsigned error = 0;
   error = addChunk(out, "IEND", 0, 0);
@@ -5659,6 +7646,45 @@ static void Adam7_interlace(unsigned char* out, const unsigned char* in, unsigne
   }
 }
 
+/*the rows per band the image data is compressed in (see band_rows), or 0 if it is compressed as a whole*/
+static unsigned getBandRows(unsigned h, const LodePNGInfo* info_png, const LodePNGEncoderSettings* settings) {
+#ifdef LODEPNG_COMPILE_ZLIB
+  if(settings->band_rows && settings->band_rows < h && info_png->interlace_method == 0 &&
+     !settings->zlibsettings.custom_zlib && !settings->zlibsettings.custom_deflate) {
+    return settings->band_rows;
+  }
+#endif /*LODEPNG_COMPILE_ZLIB*/
+  (void)h; (void)info_png; (void)settings;
+  return 0;
+}
+
+/*filters the image in bands of band_rows rows, or as a whole if band_rows is 0. The first row of each band is filtered
+as if it were the image's first and must not depend on the row above for other decoders either: of the filter types
+chosen that way, Up is the same as None and Paeth the same as Sub, and Average is replaced by Sub.*/
+static unsigned filterBands(unsigned char* out, const unsigned char* in, unsigned w, unsigned h,
+                            const LodePNGColorMode* info, const LodePNGEncoderSettings* settings, unsigned band_rows) {
+  unsigned bpp = lodepng_get_bpp(info);
+  size_t linebytes = (w * bpp + 7u) / 8u;
+  size_t bytewidth = (bpp + 7u) / 8u;
+  LodePNGEncoderSettings bandsettings = *settings;
+  unsigned y;
+
+  if(!band_rows) return filter(out, in, w, h, info, settings);
+  for(y = 0; y < h; y += band_rows) {
+    unsigned rows = h - y < band_rows ? h - y : band_rows;
+    unsigned char* line = &out[y * (linebytes + 1)];
+    if(settings->predefined_filters) bandsettings.predefined_filters = &settings->predefined_filters[y];
+    CERROR_TRY_RETURN(filter(line, &in[y * linebytes], w, rows, info, &bandsettings));
+    if(line[0] == 2) line[0] = 0;
+    else if(line[0] == 4) line[0] = 1;
+    else if(line[0] == 3) {
+      line[0] = 1;
+      filterScanline(&line[1], &in[y * linebytes], 0, linebytes, bytewidth, 1);
+    }
+  }
+  return 0;
+}
+
 /*out must be buffer big enough to contain uncompressed IDAT chunk data, and in must contain the full image.
 return value is error**/
 static unsigned preProcessScanlines(unsigned char** out, size_t* outsize, const unsigned char* in,
@@ -5673,6 +7699,7 @@ static unsigned preProcessScanlines(unsigned char** out, size_t* outsize, const
   unsigned error = 0;
 
   if(info_png->interlace_method == 0) {
+    unsigned band_rows = getBandRows(h, info_png, settings);
     *outsize = h + (h * ((w * bpp + 7u) / 8u)); /*image size plus an extra byte per scanline + possible padding bits*/
     *out = (unsigned char*)lodepng_malloc(*outsize);
     if(!(*out) && (*outsize)) error = 83; /*alloc fail*/
@@ -5684,12 +7711,12 @@ static unsigned preProcessScanlines(unsigned char** out, size_t* outsize, const
         if(!padded) error = 83; /*alloc fail*/
         if(!error) {
           addPaddingBits(padded, in, ((w * bpp + 7u) / 8u) * 8u, w * bpp, h);
-          error = filter(*out, padded, w, h, &info_png->color, settings);
+          error = filterBands(*out, padded, w, h, &info_png->color, settings, band_rows);
         }
         lodepng_free(padded);
       } else {
         /*we can immediately filter into the out buffer, no other steps needed*/
-        error = filter(*out, in, w, h, &info_png->color, settings);
+        error = filterBands(*out, in, w, h, &info_png->color, settings, band_rows);
       }
     }
   } else /*interlace_method is 1 (Adam7)*/ {
@@ -5947,7 +7974,13 @@ unsigned lodepng_encode(unsigned char** out, size_t* outsize,
       if(state->error) goto cleanup;
     }
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
-    /*IDAT (multiple IDAT chunks must be consecutive)*/
+    /*IDAT (multiple IDAT chunks must be consecutive), compressed in bands after their index if asked to*/
+#ifdef LODEPNG_COMPILE_ZLIB
+    if(getBandRows(h, &info, &state->encoder)) {
+      state->error = addChunks_seGM_IDAT(&outv, data, h, datasize / h, getBandRows(h, &info, &state->encoder),
+                                         &state->encoder.zlibsettings);
+    } else
+#endif /*LODEPNG_COMPILE_ZLIB*/
     state->error = addChunk_IDAT(&outv, data, datasize, &state->encoder.zlibsettings);
     if(state->error) goto cleanup;
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
@@ -6070,6 +8103,7 @@ void lodepng_encoder_settings_init(LodePNGEncoderSettings* settings) {
   settings->auto_convert = 1;
   settings->force_palette = 0;
   settings->predefined_filters = 0;
+  settings->band_rows = 0;
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
   settings->add_id = 0;
   settings->text_compression = 1;
@@ -6196,6 +8230,10 @@ const char* lodepng_error_text(unsigned code) {
     case 106: return "PNG file must have PLTE chunk if color type is palette";
     case 107: return "color convert from palette mode requested without setting the palette data in it";
     case 108: return "tried to add more than 256 values to a palette";
+    case 109: return "the streaming decoder can't decode interlaced PNGs";
+    case 110: return "the PNG data ended before the whole image was decoded";
+    /*decodeBands falls back to decoding the image data as a whole on this error, so it is not returned*/
+    case 111: return "the seGM chunk doesn't describe bands of the image data that can be decoded on their own";
   }
   return "unknown error code";
 }
@@ -6326,6 +8364,27 @@ unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
   return decode(out, w, h, state, in.empty() ? 0 : &in[0], in.size());
 }
 
+unsigned decode_region(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
+                       State& state,
+                       const unsigned char* in, size_t insize,
+                       unsigned x, unsigned y, unsigned region_w, unsigned region_h) {
+  unsigned char* buffer = NULL;
+  unsigned error = lodepng_decode_region(&buffer, &w, &h, &state, in, insize, x, y, region_w, region_h);
+  if(buffer && !error) {
+    size_t buffersize = lodepng_get_raw_size(w, h, &state.info_raw);
+    out.insert(out.end(), &buffer[0], &buffer[buffersize]);
+  }
+  lodepng_free(buffer);
+  return error;
+}
+
+unsigned decode_region(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
+                       State& state,
+                       const std::vector<unsigned char>& in,
+                       unsigned x, unsigned y, unsigned region_w, unsigned region_h) {
+  return decode_region(out, w, h, state, in.empty() ? 0 : &in[0], in.size(), x, y, region_w, region_h);
+}
+
 #ifdef LODEPNG_COMPILE_DISK
 unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h, const std::string& filename,
                 LodePNGColorType colortype, unsigned bitdepth) {
@@ -6336,6 +8395,21 @@ unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h, const
   if(error) return error;
   return decode(out, w, h, buffer, colortype, bitdepth);
 }
+
+unsigned decode_region(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
+                       const std::string& filename,
+                       unsigned x, unsigned y, unsigned region_w, unsigned region_h,
+                       LodePNGColorType colortype, unsigned bitdepth) {
+  std::vector<unsigned char> buffer;
+  State state;
+  state.info_raw.colortype = colortype;
+  state.info_raw.bitdepth = bitdepth;
+  /* safe output values in case error happens */
+  w = h = 0;
+  unsigned error = load_file(buffer, filename);
+  if(error) return error;
+  return decode_region(out, w, h, state, buffer, x, y, region_w, region_h);
+}
 #endif /* LODEPNG_COMPILE_DECODER */
 #endif /* LODEPNG_COMPILE_DISK */
 
@@ -227,6 +227,11 @@ Same as the other decode functions, but instead takes a filename as input.
 unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
                 const std::string& filename,
                 LodePNGColorType colortype = LCT_RGBA, unsigned bitdepth = 8);
+/*Same as lodepng_decode_region, but from a PNG file on disk and to an std::vector.*/
+unsigned decode_region(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
+                       const std::string& filename,
+                       unsigned x, unsigned y, unsigned region_w, unsigned region_h,
+                       LodePNGColorType colortype = LCT_RGBA, unsigned bitdepth = 8);
 #endif /* LODEPNG_COMPILE_DISK */
 #endif /* LODEPNG_COMPILE_DECODER */
 
@@ -262,6 +267,24 @@ unsigned encode(const std::string& filename,
 const char* lodepng_error_text(unsigned code);
 #endif /*LODEPNG_COMPILE_ERROR_TEXT*/
 
+#ifdef LODEPNG_COMPILE_ALLOCATORS
+/*Functions the built-in lodepng_malloc, lodepng_realloc and lodepng_free call instead of C's malloc, realloc and
+free, each getting user as its first argument. reallocate and deallocate are only given null or pointers that this
+allocator's own functions returned.*/
+typedef struct LodePNGAllocator {
+  void* (*allocate)(void* user, size_t size);
+  void* (*reallocate)(void* user, void* ptr, size_t new_size);
+  void (*deallocate)(void* user, void* ptr);
+  void* user;
+} LodePNGAllocator;
+
+/*Sends everything lodepng allocates on the calling thread to allocator, or back to C's functions if it is null, and
+returns the allocator that was set before so it can be restored. Whatever lodepng allocated must be freed under the
+allocator that allocated it, including memory held by a LodePNGState or LodePNGInfo: clean those up before switching.
+Where the compiler has no thread-local storage, the allocator applies to all threads.*/
+const LodePNGAllocator* lodepng_set_allocator(const LodePNGAllocator* allocator);
+#endif /*LODEPNG_COMPILE_ALLOCATORS*/
+
 #ifdef LODEPNG_COMPILE_DECODER
 /*Settings for zlib decompression*/
 typedef struct LodePNGDecompressSettings LodePNGDecompressSettings;
@@ -269,6 +292,12 @@ struct LodePNGDecompressSettings {
   /* Check LodePNGDecoderSettings for more ignorable errors such as ignore_crc */
   unsigned ignore_adler32; /*if 1, continue and don't give an error message if the Adler32 checksum is corrupted*/
   unsigned ignore_nlen; /*ignore complement of len checksum in uncompressed blocks*/
+  /*if not 0, only the first needed_size bytes of output are wanted: inflate stops at the end of the first deflate
+  block that reaches them, and the Adler32 is not checked since it covers the whole stream (default: 0)*/
+  size_t needed_size;
+  /*if not 0, the output is allocated for this many bytes before inflating, so a stream that inflates to it needs
+  no reallocation on the way. The PNG decoder sets it from the image's header (default: 0)*/
+  size_t expected_size;
 
   /*use custom zlib decoder instead of built in one (default: null)*/
   unsigned (*custom_zlib)(unsigned char**, size_t*,
@@ -618,6 +647,25 @@ unsigned lodepng_convert(unsigned char* out, const unsigned char* in,
                          const LodePNGColorMode* mode_out, const LodePNGColorMode* mode_in,
                          unsigned w, unsigned h);
 
+/*
+Output buffers of lodepng_convert_planar and lodepng_decode_planar: the red, green, blue
+and alpha channels of the image each go to their own buffer ("plane"), rather than being
+interleaved pixel by pixel. Channels are taken to 8 bits as for RGBA 8-bit output (so
+16-bit channels keep their high byte), and stored as unsigned chars or, if floats is set,
+as floats of that value times scale. Rows of w values start stride values apart in every
+plane. A channel whose plane is 0 isn't output.
+*/
+typedef struct LodePNGPlanes {
+  void* planes[4]; /*red, green, blue and alpha: unsigned char* or float*, depending on floats*/
+  unsigned floats;
+  float scale; /*for floats: 1.0f / 255.0f gives 0 to 1*/
+  size_t stride;
+} LodePNGPlanes;
+
+/*Converts a raw buffer of w * h pixels in the color type mode_in into planes.*/
+unsigned lodepng_convert_planar(const LodePNGPlanes* out, const unsigned char* in,
+                                const LodePNGColorMode* mode_in, unsigned w, unsigned h);
+
 #ifdef LODEPNG_COMPILE_DECODER
 /*
 Settings for the decoder. This contains settings for the PNG and the Zlib
@@ -637,6 +685,13 @@ typedef struct LodePNGDecoderSettings {
 
   unsigned color_convert; /*whether to convert the PNG to the color type you want. Default: yes*/
 
+  /*If set, decodes the bands of PNGs whose image data is compressed in bands (see band_rows in
+  LodePNGEncoderSettings) in parallel: it must call task(task_data, index) once for each index from 0 to count - 1,
+  on any threads and in any order, and return once all have finished. The tasks don't allocate through an allocator
+  given to lodepng_set_allocator, which needn't be thread-safe. Default: 0, PNGs are decoded on the calling thread*/
+  void (*parallel_for)(void* context, unsigned count, void (*task)(void* task_data, unsigned index), void* task_data);
+  void* parallel_context; /*passed to parallel_for*/
+
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
   unsigned read_text_chunks; /*if false but remember_unknown_chunks is true, they're stored in the unknown chunks*/
   /*store all bytes from unknown chunks in the LodePNGInfo (off by default, useful for a png editor)*/
@@ -718,6 +773,13 @@ typedef struct LodePNGEncoderSettings {
   must be set to 0 to ensure this is also used on palette or low bitdepth images.*/
   const unsigned char* predefined_filters;
 
+  /*if not 0, the image data is compressed in independent bands of this many rows and the private seGM chunk before
+  IDAT indexes them, so that a decoder can inflate and unfilter the bands on several threads (see parallel_for in
+  LodePNGDecoderSettings). Other decoders read the PNG as usual. Each band's first row is filtered without the row
+  above it and its data is deflated without the bands before it, which makes the PNG a little larger. Not used for
+  interlaced PNGs or with a custom zlib or deflate function. Default: 0*/
+  unsigned band_rows;
+
   /*force creating a PLTE chunk if colortype is 2 or 6 (= a suggested palette).
   If colortype is 3, PLTE is _always_ created.*/
   unsigned force_palette;
@@ -770,6 +832,59 @@ information is placed in the info_png field of the LodePNGState.
 unsigned lodepng_inspect(unsigned* w, unsigned* h,
                          LodePNGState* state,
                          const unsigned char* in, size_t insize);
+
+/*
+Same as lodepng_decode, but outputs only the region_w by region_h pixels whose top
+left corner is at column x and row y, clipped to the image. w and h receive the size
+of the region after clipping, and may be 0 if it lies outside the image.
+Decoding stops at the deflate block holding the region's last scanline, so the
+rows below it cost nothing but their chunk CRCs, and only the region's columns are
+color converted. Adam7 spreads every row over the whole zlib stream, so interlaced
+images are inflated and unfiltered in full. Whenever decoding stops early, the
+Adler32 of the zlib stream is not checked.
+*/
+unsigned lodepng_decode_region(unsigned char** out, unsigned* w, unsigned* h,
+                               LodePNGState* state,
+                               const unsigned char* in, size_t insize,
+                               unsigned x, unsigned y, unsigned region_w, unsigned region_h);
+
+/*
+Same as lodepng_decode_region, but stores the region's pixels in out's planes, each of
+which must have room for region_h rows of region_w values at out->stride apart. The
+pixels are converted from the PNG straight into the planes, a row at a time, so no
+interleaved copy of the region is made. state->info_raw is not used.
+*/
+unsigned lodepng_decode_planar(const LodePNGPlanes* out, unsigned* w, unsigned* h,
+                               LodePNGState* state,
+                               const unsigned char* in, size_t insize,
+                               unsigned x, unsigned y, unsigned region_w, unsigned region_h);
+
+#ifdef LODEPNG_COMPILE_ZLIB
+/*
+Decoding a PNG given in pieces, one scanline at a time: the decoder is fed the file's
+bytes in chunks of any size, and calls back with each row of the image as soon as it
+is reconstructed, in state->info_raw's color type (or the PNG's own if
+state->decoder.color_convert is off). It holds two scanlines, the 32K deflate window
+and whichever metadata chunk is being read, rather than the whole file and image.
+The callback returns 0 to carry on, or anything else to stop decoding: later feeds
+are then ignored. Interlaced PNGs can't be decoded this way (error 109), since every
+Adam7 pass touches the last row.
+The state is read as the PNG arrives, so info_png is complete once decoding is done.
+*/
+typedef unsigned (*LodePNGRowCallback)(void* user, const unsigned char* row, unsigned y, unsigned w, unsigned h);
+typedef struct LodePNGStreamDecoder LodePNGStreamDecoder;
+
+/*returns 0 if out of memory. The state must outlive the decoder.*/
+LodePNGStreamDecoder* lodepng_stream_decoder_new(LodePNGState* state, LodePNGRowCallback callback, void* user);
+void lodepng_stream_decoder_delete(LodePNGStreamDecoder* decoder);
+/*decodes all it can of the next insize bytes of the PNG. Once it returns an error, it returns that error again.*/
+unsigned lodepng_stream_decoder_feed(LodePNGStreamDecoder* decoder, const unsigned char* in, size_t insize);
+/*1 once the decoder wants no more input: the IEND chunk has been read or the callback stopped it*/
+unsigned lodepng_stream_decoder_done(const LodePNGStreamDecoder* decoder);
+/*call after the last feed: returns an error if the PNG ended before all of its rows did (or before IEND, unless
+state->decoder.ignore_end is set)*/
+unsigned lodepng_stream_decoder_finish(LodePNGStreamDecoder* decoder);
+#endif /*LODEPNG_COMPILE_ZLIB*/
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 /*
@@ -952,6 +1067,23 @@ return value: error code (0 means ok)
 */
 unsigned lodepng_load_file(unsigned char** out, size_t* outsize, const char* filename);
 
+/*
+Gives read-only access to a file's bytes without copying them into a buffer first. On Unix-like systems the file is
+mapped into memory, so its pages are only read from disk when something touches them, and the system is told it
+will be read front to back. Elsewhere the file is loaded as with lodepng_load_file.
+Only map files the program controls, such as ones it wrote itself: if a mapped file is truncated or its network
+share goes away while it is read, the process gets SIGBUS rather than an error. The file decoders therefore read
+into a buffer with lodepng_load_file.
+out: output parameter, the file's bytes (null for an empty file), valid until lodepng_unmap_file
+outsize: output parameter, the size of the file
+filename: the path to the file to map
+return value: error code (0 means ok)
+*/
+unsigned lodepng_map_file(const unsigned char** out, size_t* outsize, const char* filename);
+
+/*Releases the bytes given by lodepng_map_file, which must be passed with the size it gave.*/
+void lodepng_unmap_file(const unsigned char* buffer, size_t buffersize);
+
 /*
 Save a file from buffer to disk. Warning, if it exists, this function overwrites
 the file without warning!
@@ -983,6 +1115,15 @@ unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
 unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
                 State& state,
                 const std::vector<unsigned char>& in);
+/* Same as lodepng_decode_region, but decodes to an std::vector. */
+unsigned decode_region(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
+                       State& state,
+                       const unsigned char* in, size_t insize,
+                       unsigned x, unsigned y, unsigned region_w, unsigned region_h);
+unsigned decode_region(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
+                       State& state,
+                       const std::vector<unsigned char>& in,
+                       unsigned x, unsigned y, unsigned region_w, unsigned region_h);
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 #ifdef LODEPNG_COMPILE_ENCODER
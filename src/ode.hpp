@@ -0,0 +1,87 @@
+#pragma once
+
+// Fixed-step integrators for small ODE systems, shared by the CHAOS simulations.
+//
+// A system is any type with
+//     static const int MAX_SIZE;                  // largest state it can have
+//     int size() const;                           // current state size
+//     void derivative(const T* x, T* dxdt) const; // dx/dt at x
+// Everything is templated on the system, so the derivative inlines into the stepper and the per-component loops can
+// vectorise; nothing is virtual. Systems whose size is a constant get fully unrolled. The state's element type T is
+// usually float, or simd::float_4 to step four copies of a system side by side.
+namespace ode {
+
+// Forward Euler from a derivative the caller already has at x, e.g. from computing outputs for the same state.
+template <class System, typename T>
+inline void stepEuler(const System& system, float dt, T* x, const T* dxdt) {
+	const int n = system.size();
+	for (int i = 0; i < n; i++) {
+		x[i] += dxdt[i] * dt;
+	}
+}
+
+// Forward Euler: one derivative evaluation per step.
+template <class System, typename T>
+inline void stepEuler(const System& system, float dt, T* x) {
+	T dxdt[System::MAX_SIZE];
+	system.derivative(x, dxdt);
+	stepEuler(system, dt, x, dxdt);
+}
+
+// Semi-implicit (symplectic) Euler for second-order systems whose state is positions followed by velocities:
+// the velocities step first and the positions move with the new ones. Far better than forward Euler at keeping
+// oscillators from gaining energy, for the same single derivative evaluation.
+template <class System, typename T>
+inline void stepSymplecticEuler(const System& system, float dt, T* x, const T* dxdt) {
+	const int half = system.size() / 2;
+	for (int i = 0; i < half; i++) {
+		x[half + i] += dxdt[half + i] * dt;
+	}
+	for (int i = 0; i < half; i++) {
+		x[i] += x[half + i] * dt;
+	}
+}
+
+template <class System, typename T>
+inline void stepSymplecticEuler(const System& system, float dt, T* x) {
+	T dxdt[System::MAX_SIZE];
+	system.derivative(x, dxdt);
+	stepSymplecticEuler(system, dt, x, dxdt);
+}
+
+// Classic fourth-order Runge-Kutta from a first stage (the derivative at x) the caller already has, so three more
+// derivative evaluations per step.
+template <class System, typename T>
+inline void stepRK4(const System& system, float dt, T* x, const T* k1) {
+	const int n = system.size();
+	T k2[System::MAX_SIZE];
+	T k3[System::MAX_SIZE];
+	T k4[System::MAX_SIZE];
+	T y[System::MAX_SIZE] = {};
+
+	for (int i = 0; i < n; i++) {
+		y[i] = x[i] + k1[i] * (dt / 2.f);
+	}
+	system.derivative(y, k2);
+	for (int i = 0; i < n; i++) {
+		y[i] = x[i] + k2[i] * (dt / 2.f);
+	}
+	system.derivative(y, k3);
+	for (int i = 0; i < n; i++) {
+		y[i] = x[i] + k3[i] * dt;
+	}
+	system.derivative(y, k4);
+	for (int i = 0; i < n; i++) {
+		x[i] += (k1[i] + 2.f * k2[i] + 2.f * k3[i] + k4[i]) * (dt / 6.f);
+	}
+}
+
+// Classic fourth-order Runge-Kutta: four derivative evaluations per step.
+template <class System, typename T>
+inline void stepRK4(const System& system, float dt, T* x) {
+	T k1[System::MAX_SIZE];
+	system.derivative(x, k1);
+	stepRK4(system, dt, x, k1);
+}
+
+} // namespace ode
@@ -8,6 +8,7 @@ void init(Plugin* p) {
 	// Add modules here
 	p->addModel(modelTex);
 	p->addModel(modelChaos);
+	p->addModel(modelChaosX);
 
 	// Any other plugin initialization may go here.
 	// As an alternative, consider lazy-loading assets and lookup tables when your module is created to reduce startup times of Rack.